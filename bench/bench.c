@@ -0,0 +1,360 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../game/awale.h"
+#include "../game/ai.h"
+#include "../game/mcts.h"
+#include "../game/awale_batch.h"
+#include "../game/nn.h"
+
+/* Engine microbenchmarks.
+ * Usage: awale_bench [-q] [-o file]
+ *
+ * Writes one JSON object with a result per benchmark (count, seconds, rate)
+ * so runs from two commits can be diffed; a readable summary goes to stderr.
+ * Timed loops are repeated and the best pass is kept. Perft and search node
+ * counts are deterministic and double as a check that the rules did not move
+ * (except with several search threads, whose trees depend on timing). The
+ * batch playout kernels are checked against awale_play_move before they are
+ * timed, and the run fails if they disagree. */
+
+#define BENCH_POSITIONS 4096
+#define BENCH_PASSES 3
+#define BENCH_SEARCH_POSITIONS 4
+#define BENCH_MAX_THREADS 8
+#define BENCH_MCTS_NODES (1 << 22)
+#define BENCH_BATCH_LANES 4096
+#define BENCH_BATCH_MAX_PLIES 300
+
+typedef struct {
+    const char *name;
+    const char *unit;
+    int depth;                      /* -1 when it does not apply */
+    double count;
+    double seconds;
+    int threads;                    /* 0 when it does not apply */
+    double speedup;                 /* over the same benchmark on one thread */
+} bench_result_t;
+
+static bench_result_t results[48];
+static int num_results = 0;
+static volatile uint64_t sink;      /* keeps timed work from being optimized away */
+
+/* Sample positions from random games, each with one legal move */
+static awale_game_t positions[BENCH_POSITIONS];
+static int position_moves[BENCH_POSITIONS];
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static unsigned int next_random(unsigned int *state)
+{
+    *state = *state * 1103515245u + 12345u;
+    return *state >> 16;
+}
+
+static int random_move(const awale_game_t *game, unsigned int *rng)
+{
+    int moves[HOLES_PER_PLAYER], n = 0;
+    for (int i = 0; i < HOLES_PER_PLAYER; i++) {
+        int hole = game->current_player * HOLES_PER_PLAYER + i;
+        if (awale_is_valid_move(game, hole)) moves[n++] = hole;
+    }
+    return n ? moves[next_random(rng) % n] : -1;
+}
+
+static void make_positions(void)
+{
+    unsigned int rng = 2024;
+    awale_game_t game;
+    awale_reset(&game);
+    for (int i = 0; i < BENCH_POSITIONS; i++) {
+        int move = random_move(&game, &rng);
+        if (move < 0) {
+            awale_reset(&game);
+            move = random_move(&game, &rng);
+        }
+        positions[i] = game;
+        position_moves[i] = move;
+        awale_play_move(&game, move);
+    }
+}
+
+static bench_result_t *add_result(const char *name, const char *unit, int depth, double count, double seconds)
+{
+    bench_result_t *r = &results[num_results++];
+    r->name = name;
+    r->unit = unit;
+    r->depth = depth;
+    r->count = count;
+    r->seconds = seconds;
+    r->threads = 0;
+    r->speedup = 0.0;
+    fprintf(stderr, "%-20s", name);
+    if (depth >= 0) fprintf(stderr, " depth %2d", depth);
+    else fprintf(stderr, "         ");
+    fprintf(stderr, " %14.0f %-6s %8.3f s %14.0f %s/s\n", count, unit, seconds, count / seconds, unit);
+    return r;
+}
+
+// Record the thread count of a result and its speedup over one thread.
+static void set_threads(bench_result_t *r, int threads, double speedup)
+{
+    r->threads = threads;
+    r->speedup = speedup;
+    fprintf(stderr, "%-20s %2d thread(s)  speedup %.2fx\n", "", threads, r->speedup);
+}
+
+static void bench_play_move(int reps)
+{
+    double best = 1e30;
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        uint64_t acc = 0;
+        double start = now_seconds();
+        for (int r = 0; r < reps; r++) {
+            for (int i = 0; i < BENCH_POSITIONS; i++) {
+                awale_game_t g = positions[i];
+                awale_play_move(&g, position_moves[i]);
+                acc += (uint64_t)g.scores[0] + (uint64_t)g.holes[r % TOTAL_HOLES];
+            }
+        }
+        double elapsed = now_seconds() - start;
+        sink += acc;
+        if (elapsed < best) best = elapsed;
+    }
+    add_result("play_move", "moves", -1, (double)reps * BENCH_POSITIONS, best);
+}
+
+static void bench_is_valid_move(int reps)
+{
+    double best = 1e30;
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        uint64_t acc = 0;
+        double start = now_seconds();
+        for (int r = 0; r < reps; r++) {
+            for (int i = 0; i < BENCH_POSITIONS; i++) {
+                for (int hole = 0; hole < TOTAL_HOLES; hole++) {
+                    acc += (uint64_t)awale_is_valid_move(&positions[i], hole);
+                }
+            }
+        }
+        double elapsed = now_seconds() - start;
+        sink += acc;
+        if (elapsed < best) best = elapsed;
+    }
+    add_result("is_valid_move", "calls", -1, (double)reps * BENCH_POSITIONS * TOTAL_HOLES, best);
+}
+
+static void bench_print_to_buffer(int reps)
+{
+    char buffer[1024];
+    double best = 1e30;
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        uint64_t acc = 0;
+        double start = now_seconds();
+        for (int r = 0; r < reps; r++) {
+            for (int i = 0; i < BENCH_POSITIONS; i++) {
+                awale_print_to_buffer(&positions[i], buffer, sizeof(buffer), "alice", "bob");
+                acc += (uint64_t)buffer[r % 64];
+            }
+        }
+        double elapsed = now_seconds() - start;
+        sink += acc;
+        if (elapsed < best) best = elapsed;
+    }
+    add_result("print_to_buffer", "calls", -1, (double)reps * BENCH_POSITIONS, best);
+}
+
+static void bench_perft(int max_depth)
+{
+    awale_game_t game;
+    awale_reset(&game);
+    for (int depth = 1; depth <= max_depth; depth++) {
+        double start = now_seconds();
+        uint64_t nodes = awale_perft(&game, depth);
+        add_result("perft", "nodes", depth, (double)nodes, now_seconds() - start);
+    }
+}
+
+// Batched random playouts (continuous self-play) on the scalar or AVX2 kernel.
+static void bench_batch(const char *name, int simd, int steps)
+{
+    awale_batch_t *batch = awale_batch_create(BENCH_BATCH_LANES, 2024);
+    if (!batch) return;
+    awale_batch_set_simd(batch, simd);
+    awale_game_t start;
+    awale_reset(&start);
+
+    double best = 1e30, moves = 0.0;
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        awale_batch_stats_t stats;
+        memset(&stats, 0, sizeof(stats));
+        double t0 = now_seconds();
+        awale_batch_run(batch, &start, steps, BENCH_BATCH_MAX_PLIES, &stats);
+        double elapsed = now_seconds() - t0;
+        sink += (uint64_t)stats.games;
+        if (elapsed < best) {
+            best = elapsed;
+            moves = (double)stats.moves;
+        }
+    }
+    awale_batch_free(batch);
+    add_result(name, "moves", -1, moves, best);
+}
+
+// Check both batch kernels against awale_play_move, then time them.
+// Returns -1 if a kernel disagrees with the reference rules.
+static int bench_batch_kernels(int steps)
+{
+    long long mismatches = awale_batch_verify(1024, BENCH_BATCH_MAX_PLIES, 99);
+    if (mismatches != 0) {
+        fprintf(stderr, "batch kernels disagree with awale_play_move (%lld mismatches)\n", mismatches);
+        return -1;
+    }
+    bench_batch("batch_scalar", 0, steps);
+    if (awale_batch_simd_available()) bench_batch("batch_avx2", 1, steps);
+    return 0;
+}
+
+// Fixed-depth searches of a few sample positions on `threads` threads; the
+// time is the time to depth, summed over the positions.
+static bench_result_t *bench_search(const char *name, int depth, int use_nn, int threads)
+{
+    ai_config_t cfg;
+    ai_config_default(&cfg);
+    cfg.threads = threads;
+    cfg.max_depth = depth;
+    cfg.use_nn = use_nn;
+
+    double nodes = 0.0, seconds = 0.0;
+    for (int i = 0; i < BENCH_SEARCH_POSITIONS; i++) {
+        const awale_game_t *game = &positions[i * 101];
+        ai_result_t result;
+        ai_clear();
+        double start = now_seconds();
+        ai_search(game, &cfg, &result);
+        seconds += now_seconds() - start;
+        nodes += (double)result.nodes;
+    }
+    return add_result(name, "nodes", depth, nodes, seconds);
+}
+
+// Lazy SMP scaling: the same searches on 1, 2, 4 and 8 threads.
+static void bench_search_smp(int depth)
+{
+    double base = 0.0;
+    for (int threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2) {
+        bench_result_t *r = bench_search("search_smp", depth, 0, threads);
+        if (threads == 1) base = r->seconds;
+        set_threads(r, threads, r->seconds > 0.0 ? base / r->seconds : 0.0);
+    }
+}
+
+// Monte Carlo playouts/sec from the start position, one tree reused for every
+// thread count; the speedup is in playout throughput.
+static void bench_mcts(unsigned long long playouts)
+{
+    mcts_tree_t *tree = mcts_create(BENCH_MCTS_NODES);
+    if (!tree) return;
+    awale_game_t game;
+    awale_reset(&game);
+    mcts_config_t cfg;
+    mcts_config_default(&cfg);
+    cfg.time_ms = 0;
+    cfg.max_playouts = playouts;
+    mcts_result_t result;
+    mcts_search(tree, &game, &cfg, &result);    /* untimed: fault the arena in */
+
+    double base = 0.0;
+    for (int threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2) {
+        cfg.threads = threads;
+        mcts_search(tree, &game, &cfg, &result);
+        bench_result_t *r = add_result("mcts", "playouts", -1, (double)result.playouts,
+                                       result.elapsed_ms / 1000.0);
+        double rate = r->seconds > 0.0 ? r->count / r->seconds : 0.0;
+        if (threads == 1) base = rate;
+        set_threads(r, threads, base > 0.0 ? rate / base : 0.0);
+    }
+    mcts_free(tree);
+}
+
+static void write_json(FILE *out)
+{
+    fprintf(out, "{\n  \"benchmark\": \"awale\",\n  \"version\": 1,\n  \"results\": [\n");
+    for (int i = 0; i < num_results; i++) {
+        const bench_result_t *r = &results[i];
+        fprintf(out, "    {\"name\": \"%s\", ", r->name);
+        if (r->depth >= 0) fprintf(out, "\"depth\": %d, ", r->depth);
+        if (r->threads > 0) fprintf(out, "\"threads\": %d, \"speedup\": %.3f, ", r->threads, r->speedup);
+        fprintf(out, "\"unit\": \"%s\", \"count\": %.0f, \"seconds\": %.6f, \"per_sec\": %.0f}%s\n",
+                r->unit, r->count, r->seconds, r->seconds > 0.0 ? r->count / r->seconds : 0.0,
+                i + 1 < num_results ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-q] [-o file]\n", prog);
+    fprintf(stderr, "  -q  quick run (smaller loops and depths)\n");
+    fprintf(stderr, "  -o  write the JSON results to a file (default stdout)\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    int quick = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) {
+            quick = 1;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (ai_init(0) != 0) return EXIT_FAILURE;
+    make_positions();
+
+    int reps = quick ? 100 : 1000;
+    bench_play_move(reps);
+    bench_is_valid_move(reps);
+    bench_print_to_buffer(reps / 10);
+    bench_perft(quick ? 8 : 10);
+    int status = bench_batch_kernels(quick ? 200 : 2000) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    int depth = quick ? 12 : 16;
+    bench_search("search", depth, 0, 1);
+    bench_search_smp(depth + 2);
+    bench_mcts(quick ? 50000 : 500000);
+    if (nn_load(NN_DEFAULT_FILE) == 0) {
+        /* Shallower: the network search explores a larger tree and the scalar path is slow */
+        bench_search("search_nn", depth - 3, 1, 1);
+        nn_use_simd(0);
+        bench_search("search_nn_scalar", depth - 3, 1, 1);
+        nn_unload();
+    }
+    ai_cleanup();
+
+    FILE *out = path ? fopen(path, "w") : stdout;
+    if (!out) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    write_json(out);
+    if (path && fclose(out) != 0) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    return status;
+}
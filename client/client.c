@@ -14,6 +14,15 @@ static int in_game = 0;
 static char saved_server_host[128];
 static int saved_server_port = 0;
 static int last_error_invalid_password = 0;
+static int logged_in = 0;       /* commands wait for the login answer and its encoding */
+
+/* Recent commands by request ID, to tell which one an error answers */
+#define REQUEST_HISTORY 16
+static uint32_t last_request_id = 0;
+static struct {
+    uint32_t id;
+    char command[40];
+} requests[REQUEST_HISTORY];
 
 // Function prototypes (small helpers used in this file)
 static void init_client(void);
@@ -21,8 +30,10 @@ static void cleanup_client(void);
 static int connect_to_server(const char *host, int port);
 static void run_client_loop(void);
 static void handle_user_input(void);
-static void handle_server_message(void);
+static void handle_server_input(void);
+static void handle_server_message(message_view_t msg);
 static void print_help(void);
+static const char *request_command(uint32_t id);
 
 //main
 int main(int argc, char **argv)
@@ -52,7 +63,11 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
     
-    printf("Connected to server at %s:%d\n", server_host, server_port);
+    if (strchr(server_host, '/')) {
+        printf("Connected to server at %s\n", server_host);
+    } else {
+        printf("Connected to server at %s:%d\n", server_host, server_port);
+    }
     
     /* Prompt for username and password, then send login to server */
     printf("Enter your username: ");
@@ -70,6 +85,13 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
+    /* Longer names do not fit the sender field; the server refuses them too */
+    if (strlen(username) > PROTOCOL_NAME_MAX) {
+        fprintf(stderr, "Username cannot be longer than %d characters\n", PROTOCOL_NAME_MAX);
+        cleanup_client();
+        return EXIT_FAILURE;
+    }
+
     // Disallow spaces in username for simplicity
     if (strchr(username, ' ') != NULL) {
         fprintf(stderr, "Username cannot contain spaces\n");
@@ -84,9 +106,7 @@ int main(int argc, char **argv)
     password[strcspn(password, "\n")] = '\0';
 
     /* Send login message (password is sent in the message data field) */
-    message_t login_msg;
-    protocol_create_login(&login_msg, username, password);
-    if (protocol_send_message(server_sock, &login_msg) < 0) {
+    if (protocol_send_login(server_sock, username, password) < 0) {
         fprintf(stderr, "Failed to send login message\n");
         cleanup_client();
         return EXIT_FAILURE;
@@ -109,21 +129,36 @@ static void init_client(void)
 static void cleanup_client(void)
 {
     if (server_sock != INVALID_SOCKET) {
-        net_close(server_sock);
+        protocol_close(server_sock);
     }
     net_cleanup();
 }
 
+// Connect over TCP, or over a Unix domain socket when `host` is a path (it
+// contains a '/'), for a server on this host started with --unix.
 static int connect_to_server(const char *host, int port)
 {
-    server_sock = net_create_socket();
-    if (server_sock == INVALID_SOCKET) {
-        fprintf(stderr, "Failed to create socket\n");
-        return -1;
+    if (strchr(host, '/')) {
+        server_sock = net_create_unix_socket();
+        if (server_sock == INVALID_SOCKET) {
+            fprintf(stderr, "Failed to create socket\n");
+            return -1;
+        }
+        if (net_connect_unix(server_sock, host) < 0) {
+            fprintf(stderr, "Failed to connect to %s\n", host);
+            return -1;
+        }
+    } else {
+        /* A name or an IPv4 or IPv6 address */
+        server_sock = net_connect_address(host, port);
+        if (server_sock == INVALID_SOCKET) {
+            fprintf(stderr, "Failed to connect to %s:%d\n", host, port);
+            return -1;
+        }
     }
-    
-    if (net_connect(server_sock, host, port) < 0) {
-        fprintf(stderr, "Failed to connect to %s:%d\n", host, port);
+    net_set_nodelay(server_sock);
+    if (protocol_reset(server_sock) < 0) {
+        fprintf(stderr, "Out of memory\n");
         return -1;
     }
     
@@ -135,8 +170,11 @@ static void run_client_loop(void)
     fd_set readfds;
     
     while (1) {
+        /* Send the commands typed since the last wait in one write */
+        protocol_flush_all();
+
         FD_ZERO(&readfds);
-        FD_SET(STDIN_FILENO, &readfds);
+        if (logged_in) FD_SET(STDIN_FILENO, &readfds);
         FD_SET(server_sock, &readfds);
         
         int max_fd = (server_sock > STDIN_FILENO) ? server_sock : STDIN_FILENO;
@@ -153,7 +191,7 @@ static void run_client_loop(void)
         
         /* Handle server messages */
         if (FD_ISSET(server_sock, &readfds)) {
-            handle_server_message();
+            handle_server_input();
         }
     }
 }
@@ -171,6 +209,13 @@ static void handle_user_input(void)
     if (strlen(input) == 0) {
         return;
     }
+
+    /* Number the request: the server echoes the ID in whatever it sends back */
+    if (++last_request_id == 0) last_request_id = 1;
+    requests[last_request_id % REQUEST_HISTORY].id = last_request_id;
+    snprintf(requests[last_request_id % REQUEST_HISTORY].command,
+             sizeof(requests[0].command), "%.39s", input);
+    protocol_set_request_id(server_sock, last_request_id);
     
     /* Parse commands */
     if (strcmp(input, "help") == 0) {
@@ -178,17 +223,17 @@ static void handle_user_input(void)
     }
     else if (strcmp(input, "list") == 0) {
         /* Request player list */
-        message_t msg;
-        protocol_create_message(&msg, MSG_LIST_PLAYERS, username, "", "");
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_LIST_PLAYERS, username, "", "");
     }
     else if (strncmp(input, "challenge ", 10) == 0) {
-        /* challenge a player*/
-        char *opponent = input + 10;
-        message_t msg;
-        protocol_create_challenge(&msg, username, opponent);
-        protocol_send_message(server_sock, &msg);
-        printf("Challenge sent to %s\n", opponent);
+        /* challenge a player, optionally under other rules */
+        char opponent[64] = "", rules[32] = "";
+        if (sscanf(input + 10, "%63s %31s", opponent, rules) < 1) {
+            printf("Usage: challenge <name> [rules]\n");
+            return;
+        }
+        protocol_send_challenge(server_sock, username, opponent, rules);
+        printf("Challenge sent to %s%s%s\n", opponent, rules[0] ? " with rules " : "", rules);
     }
     else if (strncmp(input, "move ", 5) == 0) {
         /* handle a move */
@@ -199,13 +244,10 @@ static void handle_user_input(void)
             printf("Usage: move <session_id> <hole>\n");
             return;
         }
-        message_t msg;
-        protocol_create_move(&msg, username, hole, sess);
-        protocol_send_message(server_sock, &msg);
+        protocol_send_move(server_sock, username, hole, sess);
     }
     else if (strncmp(input, "pm ", 3) == 0) {
         /* handle private chat*/
-        message_t msg;
         char *rest = input + 3;
         while (*rest == ' ') rest++;
         char *space = strchr(rest, ' ');
@@ -217,15 +259,13 @@ static void handle_user_input(void)
             recip[recip_len] = '\0';
 
             char *message_text = space + 1;
-            protocol_create_private_chat(&msg, username, recip, message_text);
-            protocol_send_message(server_sock, &msg);
+            protocol_send_private_chat(server_sock, username, recip, message_text);
         } else {
             printf("Usage: pm <recipient> <message>\n");
         }
     }
     else if (strncmp(input, "session ", 8) == 0) {
         /* handle session chats*/
-        message_t msg;
         char *rest = input + 8;
         while (*rest == ' ') rest++;
         char *space = strchr(rest, ' ');
@@ -240,64 +280,53 @@ static void handle_user_input(void)
         sess[sess_len] = '\0';
 
         char *message_text = space + 1;
-        protocol_create_session_chat(&msg, username, sess, message_text);
-        protocol_send_message(server_sock, &msg);
+        protocol_send_session_chat(server_sock, username, sess, message_text);
     }
     else if (strcmp(input, "games") == 0) {
         /* Request game session list */
-        message_t msg;
-        protocol_create_message(&msg, MSG_LIST_GAMES, username, "", "");
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_LIST_GAMES, username, "", "");
     }
     else if (strcmp(input, "private") == 0) {
         /* Toggle private mode */
-        message_t msg;
-        protocol_create_message(&msg, MSG_SET_PRIVATE, username, "", "toggle");
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_SET_PRIVATE, username, "", "toggle");
     }
     else if (strncmp(input, "spectate ", 8) == 0) {
         /* Request to observe a game session */
         int session_id = atoi(input + 8);
-        message_t msg;
         char data[BUF_SIZE];
         snprintf(data, sizeof(data), "%d", session_id);
-        protocol_create_message(&msg, MSG_SPECTATE, username, "", data);
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_SPECTATE, username, "", data);
         printf("Requested to observe session %d\n", session_id);
     }
+    else if (strncmp(input, "analyze ", 8) == 0) {
+        /* Turn live analysis of an observed game on, or off with "analyze <id> off" */
+        char sid[32];
+        snprintf(sid, sizeof(sid), "%d", atoi(input + 8));
+        protocol_send(server_sock, MSG_ANALYZE, username, sid, strstr(input + 8, "off") ? "off" : "");
+    }
     else if (strcmp(input, "friends") == 0) {
         /* to print the list of your friends */
-        message_t msg;
-        protocol_create_message(&msg, MSG_LIST_FRIENDS, username, "", "");
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_LIST_FRIENDS, username, "", "");
     }
     else if (strncmp(input, "addfriend ", 10) == 0) {
         char *name = input + 10;
         /* Send a friend request to the server which will forward to the target */
-        message_t msg;
-        protocol_create_message(&msg, MSG_ADD_FRIEND, username, "", name);
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_ADD_FRIEND, username, "", name);
     }
     else if (strncmp(input, "rmfriend ", 9) == 0) {
         /* to remove a friend of your friends*/
         char *name = input + 9;
-        message_t msg;
-        protocol_create_message(&msg, MSG_REMOVE_FRIEND, username, "", name);
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_REMOVE_FRIEND, username, "", name);
     }
     else if (strncmp(input, "acceptfriend ", 13) == 0) {
         /* To accept a friend requerst */
         char *who = input + 13;
-        message_t msg;
-        protocol_create_message(&msg, MSG_FRIEND_REQUEST_ACCEPT, username, who, "");
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_FRIEND_REQUEST_ACCEPT, username, who, "");
     }
     else if (strncmp(input, "refusefriend ", 13) == 0) {
         /* To refuse a friend request */
         char *who = input + 13;
-        message_t msg;
-        protocol_create_message(&msg, MSG_FRIEND_REQUEST_REFUSE, username, who, "");
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_FRIEND_REQUEST_REFUSE, username, who, "");
     }
     else if (strcmp(input, "quit") == 0) {
         /* To quit kill the client */
@@ -306,21 +335,15 @@ static void handle_user_input(void)
     }
     else if (strncmp(input, "accept ", 7) == 0){
         /* To accept a challenge request */
-        message_t msg;
-        protocol_create_message(&msg, MSG_CHALLENGE_ACCEPT, username, input +7, "");
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_CHALLENGE_ACCEPT, username, input +7, "");
     }
     else if (strncmp(input, "refuse ", 7) == 0){
         /* To refuse a challenge request */
-        message_t msg;
-        protocol_create_message(&msg, MSG_CHALLENGE_REFUSE, username, input +7, "");
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_CHALLENGE_REFUSE, username, input +7, "");
     }
     else if(strncmp(input, "bio view ", 9) == 0){
         /* To read the bio of a player */
-        message_t msg;
-        protocol_create_message(&msg, MSG_BIO_VIEW, username, input+9, "");
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_BIO_VIEW, username, input+9, "");
     }
     else if(strcmp(input, "bio edit") == 0){
         /* To edit your bio */
@@ -351,25 +374,21 @@ static void handle_user_input(void)
             bio_len += n;
         }
 
-        message_t msg;
-        protocol_create_message(&msg, MSG_BIO_EDIT, username, "", bio);
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_BIO_EDIT, username, "", bio);
     }
     else if (strncmp(input, "give up ", 8) == 0){
         /* To give up a session*/
-        message_t msg;
-        protocol_create_message(&msg, MSG_GIVE_UP, username, "", input + 8);
-        protocol_send_message(server_sock, &msg);
+        protocol_send(server_sock, MSG_GIVE_UP, username, "", input + 8);
     }
     else {
         printf("Unknown command. Type 'help' for available commands.\n");
     }
 }
 
-static void handle_server_message(void)
+/* Read what the server sent in one call and show every complete message */
+static void handle_server_input(void)
 {
-    message_t msg;
-    int result = protocol_recv_message(server_sock, &msg);
+    int result = protocol_fill(server_sock);
     
     if (result <= 0) {
         /* To handle wrongs passwords*/
@@ -385,9 +404,7 @@ static void handle_server_message(void)
             fflush(stdout);
             if (fgets(retry_pw, sizeof(retry_pw), stdin) == NULL) retry_pw[0] = '\0';
             retry_pw[strcspn(retry_pw, "\n")] = '\0';
-            message_t login_msg;
-            protocol_create_login(&login_msg, username, retry_pw);
-            if (protocol_send_message(server_sock, &login_msg) < 0) {
+            if (protocol_send_login(server_sock, username, retry_pw) < 0) {
                 fprintf(stderr, "Failed to send login retry\n");
                 exit(1);
             }
@@ -397,12 +414,34 @@ static void handle_server_message(void)
         printf("Client disconnected\n");
         exit(0);
     }
-    
+
+    message_view_t msg;
+    int status;
+    while ((status = protocol_next(server_sock, &msg)) > 0) {
+        handle_server_message(msg);
+    }
+    if (status < 0) {
+        fprintf(stderr, "Malformed message from the server\n");
+        exit(1);
+    }
+}
+
+static void handle_server_message(message_view_t msg)
+{
     /* To handle all messages of the server */
     switch (msg.type) {
         case MSG_LOGIN_SUCCESS:
+        {
+            /* Compact frames from the next message on, if the server agreed */
+            unsigned version, features;
+            if (protocol_parse_hello(msg.recipient, &version, &features) &&
+                (features & PROTOCOL_FEATURE_COMPACT)) {
+                protocol_set_encoding(server_sock, PROTOCOL_COMPACT);
+            }
+            logged_in = 1;
             printf("%s", msg.data);
             printf("\nType 'help' for available commands\n\n");
+        }
             break;
 
         case MSG_GAME_START:
@@ -422,7 +461,11 @@ static void handle_server_message(void)
             break;
             
         case MSG_CHALLENGE:
-            printf("\n>>> %s challenges you to a game! <<<\n", msg.sender);
+            if (msg.data[0]) {
+                printf("\n>>> %s challenges you to a game (%s rules)! <<<\n", msg.sender, msg.data);
+            } else {
+                printf("\n>>> %s challenges you to a game! <<<\n", msg.sender);
+            }
             printf("Type 'accept %s' or 'refuse %s'\n", msg.sender, msg.sender);
             break;
 
@@ -439,6 +482,8 @@ static void handle_server_message(void)
             if (strcmp(msg.data, "Invalid password") == 0) {
                 printf("Invalid password. Please try again.\n");
                 last_error_invalid_password = 1;
+            } else if (request_command(msg.request_id)) {
+                printf("Error (%s): %s\n", request_command(msg.request_id), msg.data);
             } else {
                 printf("Error: %s\n", msg.data);
             }
@@ -464,6 +509,10 @@ static void handle_server_message(void)
             printf("Now observing session\n");
             break;
             
+        case MSG_ANALYSIS:
+            printf("\n[Session %s analysis] %s\n", msg.recipient, msg.data);
+            break;
+
         case MSG_BIO_VIEW:
             printf("Bio of %s:\n%s\n", msg.sender, msg.data);
             break;
@@ -474,12 +523,20 @@ static void handle_server_message(void)
     }
 }
 
+/* The command a request ID was given to, if it is still remembered */
+static const char *request_command(uint32_t id)
+{
+    if (id == 0 || requests[id % REQUEST_HISTORY].id != id) return NULL;
+    return requests[id % REQUEST_HISTORY].command;
+}
+
 static void print_help(void)
 {
     printf("\nAvailable commands:\n");
     printf("  help                - Show this help message\n");
     printf("  list                - List online players\n");
-    printf("  challenge <name>    - Challenge a player to a game\n");
+    printf("  challenge <name> [rules] - Challenge a player to a game; rules: standard,\n");
+    printf("                        abapa, nograndslam, feed or 4x4 (default standard)\n");
     printf("  accept <name>       - Accept a challenge\n");
     printf("  refuse <name>       - Refuse a challenge\n");
     printf("  move <id> <hole>    - Play a move in session given by id\n");
@@ -487,6 +544,7 @@ static void print_help(void)
     printf("  session <id> <msg>  - Send a session chat message\n");
     printf("  games               - List active game sessions\n");
     printf("  spectate <id>       - Observe a game session by id\n");
+    printf("  analyze <id> [off]  - Live engine analysis of a game you are observing\n");
     printf("  private             - Toggle private mode (only friends can spectate your games)\n");
     printf("  bio view <pseudo>   - View the bio of a player\n");
     printf("  bio edit            - Edit your bio\n");
@@ -1,13 +1,18 @@
+#define _DEFAULT_SOURCE     /* SO_REUSEPORT */
+
 #include "net.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <signal.h>
 
 // Lightweight network helpers used by both server and client.
 // These wrap common socket operations to keep higher-level code cleaner.
 
-// Initialize network stack on Windows. No-op on POSIX.
+// Initialize network stack on Windows. On POSIX, make a write to a
+// connection the peer closed fail with EPIPE instead of killing the process
+// (a Unix domain peer is gone at once, TCP needs a reset first).
 
 void net_init(void)
 {
@@ -18,6 +23,8 @@ void net_init(void)
         fprintf(stderr, "WSAStartup failed!\n");
         exit(EXIT_FAILURE);
     }
+#else
+    signal(SIGPIPE, SIG_IGN);
 #endif
 }
 
@@ -30,12 +37,13 @@ void net_cleanup(void)
 #endif
 }
 
-// Create a TCP socket. On POSIX, set SO_REUSEADDR to make restart easier during development.
+// Create a TCP socket of the address family `family` (AF_INET, AF_INET6).
+// On POSIX, set SO_REUSEADDR to make restart easier during development.
 // Returns INVALID_SOCKET on error.
 
-SOCKET net_create_socket(void)
+SOCKET net_create_socket(int family)
 {
-    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    SOCKET sock = socket(family, SOCK_STREAM, 0);
     if (sock == INVALID_SOCKET) {
         perror("socket");
         return INVALID_SOCKET;
@@ -51,21 +59,134 @@ SOCKET net_create_socket(void)
     return sock;
 }
 
-// Bind a socket to all network interfaces on the given port.
-// Returns 0 on success, -1 on failure.
+// Disable Nagle's algorithm on a connected socket. The protocol layer already
+// gathers what an event produces into one write per socket, so holding that
+// write back until the previous one is acknowledged only adds latency.
+// Unix domain sockets have no such delay: the option is refused, quietly.
 
-int net_bind_socket(SOCKET sock, int port)
+void net_set_nodelay(SOCKET sock)
 {
-    SOCKADDR_IN addr = {0};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(port);
-    
-    if (bind(sock, (SOCKADDR*)&addr, sizeof(addr)) == SOCKET_ERROR) {
-        perror("bind");
+    int opt = 1;
+    if (setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&opt, sizeof(opt)) < 0 &&
+        errno != EOPNOTSUPP && errno != ENOPROTOOPT) {
+        perror("setsockopt TCP_NODELAY");
+    }
+}
+
+// Let several sockets bind the same port, before binding them: the kernel
+// then spreads incoming connections over their listen queues. Returns 0 on
+// success, -1 where the platform lacks SO_REUSEPORT.
+
+int net_set_reuseport(SOCKET sock)
+{
+#ifdef SO_REUSEPORT
+    int opt = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (const char*)&opt, sizeof(opt)) < 0) {
+        perror("setsockopt SO_REUSEPORT");
         return -1;
     }
     return 0;
+#else
+    (void)sock;
+    fprintf(stderr, "SO_REUSEPORT is not supported on this platform\n");
+    return -1;
+#endif
+}
+
+// Resolve a host name or address literal for TCP, any family; NULL for the
+// wildcard addresses when `passive`. The caller frees the list with
+// freeaddrinfo. Returns NULL on error.
+
+static struct addrinfo *resolve(const char *host, int port, int family, int passive)
+{
+    struct addrinfo hints, *list = NULL;
+    char service[16];
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = family;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : AI_ADDRCONFIG;
+    snprintf(service, sizeof(service), "%d", port);
+    int err = getaddrinfo(host, service, &hints, &list);
+    if (err != 0) {
+        fprintf(stderr, "%s: %s\n", host ? host : "*", gai_strerror(err));
+        return NULL;
+    }
+    return list;
+}
+
+// Create a socket for one resolved address, bind it and listen. An IPv6
+// wildcard socket takes IPv4 connections too (as mapped addresses) when
+// `dual_stack`; any other IPv6 socket only takes IPv6, so that the IPv4
+// addresses of the same name can be bound next to it.
+
+static SOCKET listen_address(const struct addrinfo *ai, int backlog, int reuseport, int dual_stack)
+{
+    SOCKET sock = net_create_socket(ai->ai_family);
+    if (sock == INVALID_SOCKET) return INVALID_SOCKET;
+    if (ai->ai_family == AF_INET6) {
+        int v6only = !dual_stack;
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&v6only, sizeof(v6only)) < 0) {
+            perror("setsockopt IPV6_V6ONLY");
+        }
+    }
+    if (reuseport && net_set_reuseport(sock) < 0) {
+        net_close(sock);
+        return INVALID_SOCKET;
+    }
+    if (bind(sock, ai->ai_addr, (socklen_t)ai->ai_addrlen) == SOCKET_ERROR) {
+        perror("bind");
+        net_close(sock);
+        return INVALID_SOCKET;
+    }
+    if (net_listen_socket(sock, backlog) < 0) {
+        net_close(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+// Listen on `port` at every address `host` resolves to, IPv4 and IPv6 alike.
+// A NULL host listens on all interfaces: one dual-stack IPv6 socket, or an
+// IPv4 one where IPv6 is unavailable. With `reuseport`, other sockets may
+// listen on the same addresses (see net_set_reuseport). Stores at most
+// `max` sockets in `socks` and returns their number, or -1 on error.
+
+int net_listen_address(const char *host, int port, int backlog, int reuseport, SOCKET *socks, int max)
+{
+    if (!host) {
+        struct addrinfo *list = resolve(NULL, port, AF_INET6, 1);
+        SOCKET sock = list ? listen_address(list, backlog, reuseport, 1) : INVALID_SOCKET;
+        if (list) freeaddrinfo(list);
+        if (sock == INVALID_SOCKET) {
+            fprintf(stderr, "No IPv6, listening on IPv4 only\n");
+            list = resolve(NULL, port, AF_INET, 1);
+            if (!list) return -1;
+            sock = listen_address(list, backlog, reuseport, 0);
+            freeaddrinfo(list);
+            if (sock == INVALID_SOCKET) return -1;
+        }
+        if (max < 1) {
+            net_close(sock);
+            return -1;
+        }
+        socks[0] = sock;
+        return 1;
+    }
+
+    struct addrinfo *list = resolve(host, port, AF_UNSPEC, 1);
+    if (!list) return -1;
+    int count = 0;
+    for (struct addrinfo *ai = list; ai && count < max; ai = ai->ai_next) {
+        SOCKET sock = listen_address(ai, backlog, reuseport, 0);
+        if (sock == INVALID_SOCKET) {
+            for (int i = 0; i < count; i++) net_close(socks[i]);
+            count = -1;
+            break;
+        }
+        socks[count++] = sock;
+    }
+    freeaddrinfo(list);
+    return count;
 }
 
 // Put a socket into listening state with the provided backlog.
@@ -80,12 +201,11 @@ int net_listen_socket(SOCKET sock, int backlog)
 }
 
 // Accept a new incoming connection. Returns the client socket or INVALID_SOCKET on error.
-// client_addr is filled with the remote address (if non-NULL).
+// net_peer_name tells where it comes from.
 
-SOCKET net_accept_connection(SOCKET sock, SOCKADDR_IN *client_addr)
+SOCKET net_accept_connection(SOCKET sock)
 {
-    socklen_t addr_len = sizeof(*client_addr);
-    SOCKET client_sock = accept(sock, (SOCKADDR*)client_addr, &addr_len);
+    SOCKET client_sock = accept(sock, NULL, NULL);
     
     if (client_sock == INVALID_SOCKET) {
         perror("accept");
@@ -94,19 +214,109 @@ SOCKET net_accept_connection(SOCKET sock, SOCKADDR_IN *client_addr)
     return client_sock;
 }
 
-// Connect a socket to a remote IPv4 address and port. Returns 0 on success.
+// Connect to a host name or address literal, IPv4 or IPv6: every address it
+// resolves to is tried in turn. Returns the connected socket or INVALID_SOCKET.
 
-int net_connect(SOCKET sock, const char *host, int port)
+SOCKET net_connect_address(const char *host, int port)
 {
-    SOCKADDR_IN addr = {0};
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(port);
-    
-    if (inet_pton(AF_INET, host, &addr.sin_addr) <= 0) {
-        fprintf(stderr, "Invalid address: %s\n", host);
+    struct addrinfo *list = resolve(host, port, AF_UNSPEC, 0);
+    if (!list) return INVALID_SOCKET;
+    SOCKET sock = INVALID_SOCKET;
+    for (struct addrinfo *ai = list; ai; ai = ai->ai_next) {
+        sock = socket(ai->ai_family, SOCK_STREAM, 0);
+        if (sock == INVALID_SOCKET) continue;
+        if (connect(sock, ai->ai_addr, (socklen_t)ai->ai_addrlen) == 0) break;
+        net_close(sock);
+        sock = INVALID_SOCKET;
+    }
+    if (sock == INVALID_SOCKET) perror("connect");
+    freeaddrinfo(list);
+    return sock;
+}
+
+#ifndef WIN32
+
+#include <sys/stat.h>
+
+// Fill a Unix domain socket address; -1 if the path does not fit.
+
+static int unix_address(struct sockaddr_un *addr, const char *path)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
         return -1;
     }
-    
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+// Create a Unix domain stream socket, for peers on the same host: no TCP/IP
+// stack in between, the same byte stream for the protocol.
+// Returns INVALID_SOCKET on error.
+
+SOCKET net_create_unix_socket(void)
+{
+    SOCKET sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET) {
+        perror("socket");
+    }
+    return sock;
+}
+
+// Remove the socket file a previous run left behind at `path`. Anything that
+// is not a socket, or a socket a server still accepts on, is left alone.
+// Returns 0 when the path is free, -1 otherwise.
+
+static int remove_stale_socket(const char *path, const struct sockaddr_un *addr)
+{
+    struct stat st;
+    if (lstat(path, &st) < 0) {
+        if (errno == ENOENT) return 0;
+        perror(path);
+        return -1;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        fprintf(stderr, "%s exists and is not a socket\n", path);
+        return -1;
+    }
+    SOCKET probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe != INVALID_SOCKET) {
+        int live = connect(probe, (const SOCKADDR*)addr, sizeof(*addr)) == 0;
+        closesocket(probe);
+        if (live) {
+            fprintf(stderr, "%s is in use by a running server\n", path);
+            return -1;
+        }
+    }
+    if (unlink(path) < 0 && errno != ENOENT) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+// Bind a Unix domain socket to a filesystem path, replacing the socket file
+// a previous run left behind. Returns 0 on success, -1 on failure.
+
+int net_bind_unix(SOCKET sock, const char *path)
+{
+    struct sockaddr_un addr;
+    if (unix_address(&addr, path) < 0 || remove_stale_socket(path, &addr) < 0) return -1;
+    if (bind(sock, (SOCKADDR*)&addr, sizeof(addr)) == SOCKET_ERROR) {
+        perror("bind");
+        return -1;
+    }
+    return 0;
+}
+
+// Connect a Unix domain socket to the server's path. Returns 0 on success.
+
+int net_connect_unix(SOCKET sock, const char *path)
+{
+    struct sockaddr_un addr;
+    if (unix_address(&addr, path) < 0) return -1;
     if (connect(sock, (SOCKADDR*)&addr, sizeof(addr)) < 0) {
         perror("connect");
         return -1;
@@ -114,6 +324,55 @@ int net_connect(SOCKET sock, const char *host, int port)
     return 0;
 }
 
+#else
+
+SOCKET net_create_unix_socket(void)
+{
+    fprintf(stderr, "Unix domain sockets are not supported on this platform\n");
+    return INVALID_SOCKET;
+}
+
+int net_bind_unix(SOCKET sock, const char *path)
+{
+    (void)sock;
+    (void)path;
+    return -1;
+}
+
+int net_connect_unix(SOCKET sock, const char *path)
+{
+    (void)sock;
+    (void)path;
+    return -1;
+}
+
+#endif
+
+// Describe the peer of a connected socket for the logs: its IP address (an
+// IPv4 client of a dual-stack socket shows as IPv4), or "local" over a Unix
+// domain socket.
+
+void net_peer_name(SOCKET sock, char *buffer, size_t size)
+{
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    snprintf(buffer, size, "?");
+    if (getpeername(sock, (SOCKADDR*)&addr, &addr_len) < 0) return;
+    if (addr.ss_family == AF_INET) {
+        inet_ntop(AF_INET, &((SOCKADDR_IN*)&addr)->sin_addr, buffer, size);
+    } else if (addr.ss_family == AF_INET6) {
+        const struct in6_addr *a6 = &((struct sockaddr_in6*)&addr)->sin6_addr;
+        if (IN6_IS_ADDR_V4MAPPED(a6)) {
+            inet_ntop(AF_INET, &a6->s6_addr[12], buffer, size);
+        } else {
+            inet_ntop(AF_INET6, a6, buffer, size);
+        }
+    } else if (addr.ss_family == AF_UNIX) {
+        snprintf(buffer, size, "local");
+    }
+}
+
 // Wrap send(). Returns number of bytes sent or -1 on error.
 
 
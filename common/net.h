@@ -6,12 +6,15 @@
 #ifdef WIN32
 
 #include <winsock2.h>
+#include <ws2tcpip.h>
 
 #elif defined(__linux__) || defined(__unix__) || defined(__APPLE__)
 
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <netdb.h>
@@ -33,17 +36,26 @@ typedef struct in_addr IN_ADDR;
 #define DEFAULT_PORT 1977
 #define MAX_CLIENTS 100
 #define BUF_SIZE 1024
+#define NET_MAX_LISTENERS 16    /* listening sockets of one event loop */
 
 /* Network initialization and cleanup */
 void net_init(void);
 void net_cleanup(void);
 
-/* Socket operations */
-SOCKET net_create_socket(void);
-int net_bind_socket(SOCKET sock, int port);
+/* Socket operations, for IPv4 and IPv6 alike */
+SOCKET net_create_socket(int family);
+int net_listen_address(const char *host, int port, int backlog, int reuseport, SOCKET *socks, int max);
 int net_listen_socket(SOCKET sock, int backlog);
-SOCKET net_accept_connection(SOCKET sock, SOCKADDR_IN *client_addr);
-int net_connect(SOCKET sock, const char *host, int port);
+SOCKET net_accept_connection(SOCKET sock);
+SOCKET net_connect_address(const char *host, int port);
+void net_set_nodelay(SOCKET sock);
+int net_set_reuseport(SOCKET sock);
+void net_peer_name(SOCKET sock, char *buffer, size_t size);
+
+/* Unix domain sockets, for clients on the server's host */
+SOCKET net_create_unix_socket(void);
+int net_bind_unix(SOCKET sock, const char *path);
+int net_connect_unix(SOCKET sock, const char *path);
 
 /* Data transfer */
 int net_send(SOCKET sock, const char *buffer, int len);
@@ -1,76 +1,605 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "protocol.h"
 #include "net.h"
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <sys/select.h>
+#include <sys/uio.h>
+
+/* Frame buffers of each connection, indexed by socket. A frame is built in
+ * the next free slot of `out` field by field with known lengths: the header,
+ * each string and its terminator, nothing else, instead of zero-padding the
+ * whole 1 KB frame. What lies past the terminators of a legacy frame is
+ * whatever this connection sent before, which is why protocol_reset clears
+ * the buffers for a new connection.
+ *
+ * Committed frames wait in their slots until protocol_flush_all, called once
+ * per event-loop iteration, writes each connection's queue with one writev:
+ * a move that sends the game start, the state and a chat line to a player
+ * costs one syscall and, with TCP_NODELAY set on the socket, leaves in as
+ * few segments as the bytes need. A full queue is flushed early.
+ *
+ * Received bytes go to a ring of PROTOCOL_RING_FRAMES legacy frames, filled
+ * by one read per readiness event and drained frame by frame; a partial
+ * frame waits there for the rest. Legacy frames have a fixed size that
+ * divides the ring, so one never straddles the end and is handed out in
+ * place; a compact frame that does is first made contiguous in `wrapped`.
+ *
+ * The encoding is an index into `codecs`, chosen at login: building and
+ * reading a frame is one indirect call, with no test of the encoding. */
+#define PROTOCOL_RING_SIZE (PROTOCOL_RING_FRAMES * sizeof(message_t))
+
+/* Compact frame: a 12-byte header, then the three fields, each followed by
+ * its terminator so that they are read in place:
+ *   u16 frame length, u8 type, u8 sender length, u8 recipient length, u8 0,
+ *   u16 data length, u32 request ID (all little-endian) */
+#define COMPACT_HEADER 12
+#define COMPACT_MAX (COMPACT_HEADER + 60 + 64 + BUF_SIZE)
+#define FRAME_MAX (COMPACT_MAX > sizeof(message_t) ? COMPACT_MAX : sizeof(message_t))
+
+typedef union {
+    message_t legacy;
+    unsigned char bytes[FRAME_MAX];
+} frame_buf_t;
+
+typedef struct {
+    int encoding;                   /* protocol_encoding_t, legacy when zeroed */
+    uint32_t request_id;            /* stamped on outgoing frames */
+    frame_buf_t out[PROTOCOL_QUEUE_FRAMES];
+    size_t out_size[PROTOCOL_QUEUE_FRAMES];
+    int queued;                     /* committed frames waiting in `out` */
+    int pending;                    /* listed in `pending` for the next flush */
+    char *out_data;                 /* data field of the frame being built */
+    size_t head;                    /* offset of the first unread byte */
+    size_t used;                    /* bytes buffered from head on */
+    union {
+        message_t align;
+        char bytes[PROTOCOL_RING_SIZE];
+    } ring;
+    frame_buf_t wrapped;
+} protocol_conn_t;
+
+typedef struct {
+    char *(*begin)(protocol_conn_t *conn, frame_buf_t *out, msg_type_t type, const char *sender, const char *recipient);
+    size_t (*finish)(protocol_conn_t *conn, frame_buf_t *out, size_t data_len);   /* returns the frame size */
+    int (*next)(protocol_conn_t *conn, message_view_t *msg);
+} protocol_codec_t;
+
+/* A socket belongs to one I/O thread at a time, so its entry in `conns` is
+ * only touched by that thread; what is not per socket is per thread. Entries
+ * are allocated by protocol_reset and freed by protocol_close, so a process
+ * holds buffers for its open connections only. */
+static protocol_conn_t *conns[FD_SETSIZE];
+static __thread protocol_conn_t spare;      /* other sockets: legacy, cleared per frame */
+static __thread SOCKET pending[FD_SETSIZE]; /* sockets with queued frames */
+static __thread int num_pending = 0;
+
+/* A thread hands the frames for sockets it does not own to `route` instead:
+ * they are built here in the legacy layout, whatever the encoding, and the
+ * thread owning the socket encodes and queues them. */
+static __thread const protocol_route_t *route = NULL;
+static __thread message_t routed;
+static __thread uint32_t routed_request_id[FD_SETSIZE];
+
+/* 1 if what the calling thread does on `sock` goes through its route */
+static int is_routed(SOCKET sock)
+{
+    return route && !(route->local && route->local(sock));
+}
+
+/* Copy `s` into a field of `size` bytes, truncating, and terminate it;
+ * returns its length */
+static size_t put_field(char *field, size_t size, const char *s)
+{
+    size_t len = s ? strnlen(s, size - 1) : 0;
+    if (len) memcpy(field, s, len);
+    field[len] = '\0';
+    return len;
+}
+
+static void put16(unsigned char *p, unsigned v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put32(unsigned char *p, uint32_t v)
+{
+    put16(p, v & 0xffff);
+    put16(p + 2, v >> 16);
+}
+
+static unsigned get16(const unsigned char *p)
+{
+    return (unsigned)p[0] | (unsigned)p[1] << 8;
+}
+
+static uint32_t get32(const unsigned char *p)
+{
+    return (uint32_t)get16(p) | (uint32_t)get16(p + 2) << 16;
+}
+
+/* Consume `size` bytes at the head of the ring */
+static void ring_consume(protocol_conn_t *conn, size_t size)
+{
+    conn->used -= size;
+    conn->head += size;
+    if (conn->head >= PROTOCOL_RING_SIZE) conn->head -= PROTOCOL_RING_SIZE;
+    if (conn->used == 0) conn->head = 0;
+}
+
+static char *legacy_begin(protocol_conn_t *conn, frame_buf_t *frame, msg_type_t type, const char *sender, const char *recipient)
+{
+    message_t *out = &frame->legacy;
+    out->type = type;
+    out->request_id = conn->request_id;
+    put_field(out->sender, sizeof(out->sender), sender);
+    put_field(out->recipient, sizeof(out->recipient), recipient);
+    return out->data;
+}
+
+static size_t legacy_finish(protocol_conn_t *conn, frame_buf_t *frame, size_t data_len)
+{
+    (void)conn;
+    frame->legacy.data[data_len] = '\0';
+    return sizeof(message_t);
+}
+
+static int legacy_next(protocol_conn_t *conn, message_view_t *msg)
+{
+    if (conn->used < sizeof(message_t)) return 0;
+
+    message_t *in = (message_t*)(conn->ring.bytes + conn->head);
+    msg->request_id = in->request_id;
+    /* A sender running into request_id is a name of 60 to 63 characters
+     * from an older peer, whose sender field still had 64 bytes: those
+     * bytes are the end of the name, and the request has no ID. The name
+     * is kept whole so that it can be refused rather than cut short. */
+    if (in->sender[sizeof(in->sender) - 1] != '\0' && !memchr(in->sender, '\0', sizeof(in->sender))) {
+        char *name = (char*)in + offsetof(message_t, sender);
+        name[offsetof(message_t, recipient) - offsetof(message_t, sender) - 1] = '\0';
+        msg->request_id = 0;
+    }
+    /* A peer may leave a field unterminated: three stores, no scan */
+    in->recipient[sizeof(in->recipient) - 1] = '\0';
+    in->data[sizeof(in->data) - 1] = '\0';
+    msg->type = in->type;
+    msg->sender = in->sender;
+    msg->recipient = in->recipient;
+    msg->data = in->data;
+    ring_consume(conn, sizeof(message_t));
+    return 1;
+}
+
+static char *compact_begin(protocol_conn_t *conn, frame_buf_t *frame, msg_type_t type, const char *sender, const char *recipient)
+{
+    unsigned char *out = frame->bytes;
+    char *field = (char*)out + COMPACT_HEADER;
+    size_t sender_len = put_field(field, 60, sender);
+    field += sender_len + 1;
+    size_t recipient_len = put_field(field, 64, recipient);
+    out[2] = (unsigned char)type;
+    out[3] = (unsigned char)sender_len;
+    out[4] = (unsigned char)recipient_len;
+    out[5] = 0;
+    put32(out + 8, conn->request_id);
+    conn->out_data = field + recipient_len + 1;
+    return conn->out_data;
+}
+
+static size_t compact_finish(protocol_conn_t *conn, frame_buf_t *frame, size_t data_len)
+{
+    unsigned char *out = frame->bytes;
+    conn->out_data[data_len] = '\0';
+    size_t size = (size_t)(conn->out_data - (char*)out) + data_len + 1;
+    put16(out, (unsigned)size);
+    put16(out + 6, (unsigned)data_len);
+    return size;
+}
 
-/* To create a message to send it to the client or the server */
-void protocol_create_message(message_t *msg, msg_type_t type, const char *sender, const char *recipient, const char *data)
+static int compact_next(protocol_conn_t *conn, message_view_t *msg)
 {
-    msg->type = type;
-    strncpy(msg->sender, sender ? sender : "", sizeof(msg->sender) - 1);
-    strncpy(msg->recipient, recipient ? recipient : "", sizeof(msg->recipient) - 1);
-    strncpy(msg->data, data ? data : "", sizeof(msg->data) - 1);
-    msg->sender[sizeof(msg->sender) - 1] = '\0';
-    msg->recipient[sizeof(msg->recipient) - 1] = '\0';
-    msg->data[sizeof(msg->data) - 1] = '\0';
+    if (conn->used < COMPACT_HEADER) return 0;
+    size_t second = conn->head + 1 < PROTOCOL_RING_SIZE ? conn->head + 1 : 0;
+    size_t size = (unsigned char)conn->ring.bytes[conn->head] |
+                  (size_t)(unsigned char)conn->ring.bytes[second] << 8;
+    if (size < COMPACT_HEADER + 3 || size > COMPACT_MAX) return -1;
+    if (conn->used < size) return 0;
+
+    unsigned char *frame = (unsigned char*)conn->ring.bytes + conn->head;
+    size_t first = PROTOCOL_RING_SIZE - conn->head;
+    if (size > first) {
+        memcpy(conn->wrapped.bytes, frame, first);
+        memcpy(conn->wrapped.bytes + first, conn->ring.bytes, size - first);
+        frame = conn->wrapped.bytes;
+    }
+
+    size_t sender_len = frame[3], recipient_len = frame[4], data_len = get16(frame + 6);
+    if (sender_len >= 60 || recipient_len >= 64 || data_len >= BUF_SIZE ||
+        COMPACT_HEADER + sender_len + recipient_len + data_len + 3 != size) {
+        return -1;
+    }
+    char *sender = (char*)frame + COMPACT_HEADER;
+    char *recipient = sender + sender_len + 1;
+    char *data = recipient + recipient_len + 1;
+    sender[sender_len] = '\0';
+    recipient[recipient_len] = '\0';
+    data[data_len] = '\0';
+    msg->type = (msg_type_t)frame[2];
+    msg->request_id = get32(frame + 8);
+    msg->sender = sender;
+    msg->recipient = recipient;
+    msg->data = data;
+    ring_consume(conn, size);
+    return 1;
 }
 
-/* to send the message created to the server */
-int protocol_send_message(int sock, const message_t *msg)
+static const protocol_codec_t codecs[PROTOCOL_ENCODINGS] = {
+    [PROTOCOL_LEGACY] = { legacy_begin, legacy_finish, legacy_next },
+    [PROTOCOL_COMPACT] = { compact_begin, compact_finish, compact_next },
+};
+
+static protocol_conn_t *protocol_conn(SOCKET sock)
 {
-    int sent = net_send(sock, (const char*)msg, sizeof(message_t));
-    return sent == sizeof(message_t) ? 0 : -1;
+    if (sock >= 0 && sock < FD_SETSIZE && conns[sock]) return conns[sock];
+    return &spare;
 }
 
-/* to receive a message sent by the server or a client,  handling partial reads (TCP fragmentation) */
-int protocol_recv_message(int sock, message_t *msg)
+/* Write the frames queued for the socket with one writev, resuming after a
+ * short write. Returns 0, or -1 on error (the queue is dropped). */
+static int flush_conn(SOCKET sock, protocol_conn_t *conn)
 {
-    
-    size_t total_received = 0;
-    size_t msg_size = sizeof(message_t);
-    char *buffer = (char*)msg;
-    
-    while (total_received < msg_size) {
-        int received = recv(sock, buffer + total_received, msg_size - total_received, 0);
-        
-        if (received < 0) {
-            return -1; 
+    struct iovec iov[PROTOCOL_QUEUE_FRAMES];
+    int iovcnt = conn->queued;
+    for (int i = 0; i < iovcnt; i++) {
+        iov[i].iov_base = conn->out[i].bytes;
+        iov[i].iov_len = conn->out_size[i];
+    }
+    conn->queued = 0;
+
+    struct iovec *next = iov;
+    while (iovcnt > 0) {
+        ssize_t written = writev(sock, next, iovcnt);
+        if (written < 0) {
+            perror("writev");
+            return -1;
+        }
+        while (iovcnt > 0 && (size_t)written >= next->iov_len) {
+            written -= (ssize_t)next->iov_len;
+            next++;
+            iovcnt--;
         }
-        if (received == 0) {
-            return 0;
+        if (iovcnt > 0) {
+            next->iov_base = (char*)next->iov_base + written;
+            next->iov_len -= (size_t)written;
         }
-        total_received += received;
     }
-    
-    return total_received;
+    return 0;
 }
 
-/* Create a login message. The password (if any) is placed in the data field. */
-void protocol_create_login(message_t *msg, const char *username, const char *password)
+/* Route the frames the calling thread sends to sockets it does no I/O on */
+void protocol_set_route(const protocol_route_t *r)
 {
-    protocol_create_message(msg, MSG_LOGIN, username, "", password ? password : "");
+    route = r;
 }
 
-/* Create a challenge message */
-void protocol_create_challenge(message_t *msg, const char *from, const char *to)
+/* Give a new connection its buffers, or forget what an earlier connection
+ * on this descriptor left in them. Returns 0, or -1 when out of memory. */
+int protocol_reset(SOCKET sock)
 {
-    protocol_create_message(msg, MSG_CHALLENGE, from, to, "");
+    if (sock < 0 || sock >= FD_SETSIZE) return 0;
+    if (!conns[sock]) {
+        conns[sock] = (protocol_conn_t*)calloc(1, sizeof(protocol_conn_t));
+        return conns[sock] ? 0 : -1;
+    }
+    memset(conns[sock], 0, sizeof(protocol_conn_t));
+    return 0;
+}
+
+/* Frame encoding of the connection in both directions from the next frame on */
+void protocol_set_encoding(SOCKET sock, protocol_encoding_t encoding)
+{
+    if (is_routed(sock)) {
+        route->set_encoding(sock, encoding);
+        return;
+    }
+    if (sock >= 0 && sock < FD_SETSIZE && conns[sock] && encoding < PROTOCOL_ENCODINGS) {
+        conns[sock]->encoding = encoding;
+    }
+}
+
+/* Request ID carried by the frames sent to `sock` from now on, 0 for none:
+ * a client numbers its requests, the server sets the ID of the request it
+ * is handling so that everything sent back meanwhile answers it. */
+void protocol_set_request_id(SOCKET sock, uint32_t request_id)
+{
+    if (is_routed(sock)) {
+        if (sock >= 0 && sock < FD_SETSIZE) routed_request_id[sock] = request_id;
+        return;
+    }
+    if (sock >= 0 && sock < FD_SETSIZE && conns[sock]) conns[sock]->request_id = request_id;
 }
 
-/* Create a move message*/
-void protocol_create_move(message_t *msg, const char *player, int hole, const char *session_id)
+/* Write the frames queued for the socket now */
+int protocol_flush(SOCKET sock)
 {
-    char data[16];
-    snprintf(data, sizeof(data), "%d", hole);
-    protocol_create_message(msg, MSG_PLAY_MOVE, player, session_id, data);
+    protocol_conn_t *conn = protocol_conn(sock);
+    return conn->queued ? flush_conn(sock, conn) : 0;
 }
-/* Create a private chat message*/
-void protocol_create_private_chat(message_t *msg, const char *from, const char *to, const char *text)
+
+/* Write every queued frame, one writev per socket: the end of an event-loop
+ * iteration, before waiting for the next events */
+void protocol_flush_all(void)
 {
-    protocol_create_message(msg, MSG_PRIVATE_CHAT, from, to, text);
+    for (int i = 0; i < num_pending; i++) {
+        protocol_conn_t *conn = conns[pending[i]];
+        conn->pending = 0;
+        if (conn->queued) flush_conn(pending[i], conn);
+    }
+    num_pending = 0;
 }
-/* Create a session chat message*/
-void protocol_create_session_chat(message_t *msg, const char *from, const char *session_id, const char *text)
+
+/* The sockets with queued frames, taken off the list for an event loop that
+ * writes them itself (see protocol_queued); returns their number */
+int protocol_pending(SOCKET *socks)
 {
-    protocol_create_message(msg, MSG_SESSION_CHAT, from, session_id, text);
-}
\ No newline at end of file
+    int n = num_pending;
+    for (int i = 0; i < n; i++) {
+        socks[i] = pending[i];
+        conns[pending[i]]->pending = 0;
+    }
+    num_pending = 0;
+    return n;
+}
+
+/* The frames queued for the socket, as iovecs over its queue; they stay
+ * valid and in place until protocol_sent. Returns their number. */
+int protocol_queued(SOCKET sock, struct iovec *iov)
+{
+    protocol_conn_t *conn = protocol_conn(sock);
+    for (int i = 0; i < conn->queued; i++) {
+        iov[i].iov_base = conn->out[i].bytes;
+        iov[i].iov_len = conn->out_size[i];
+    }
+    return conn->queued;
+}
+
+/* The frames returned by protocol_queued are written: free the queue */
+void protocol_sent(SOCKET sock)
+{
+    protocol_conn(sock)->queued = 0;
+}
+
+/* Send what is queued for the socket and take it off the calling thread's
+ * flush list, before another thread takes the connection over: its buffers
+ * and encoding go with it. */
+int protocol_release(SOCKET sock)
+{
+    protocol_conn_t *conn = protocol_conn(sock);
+    int status = protocol_flush(sock);
+    if (conn->pending) {
+        for (int i = 0; i < num_pending; i++) {
+            if (pending[i] == sock) {
+                pending[i] = pending[--num_pending];
+                break;
+            }
+        }
+        conn->pending = 0;
+    }
+    return status;
+}
+
+/* Send what is queued for the socket and close it. The socket also leaves
+ * the flush list: once closed, its descriptor may be reused by a connection
+ * that another thread flushes. */
+void protocol_close(SOCKET sock)
+{
+    if (is_routed(sock)) {
+        route->close(sock);
+        return;
+    }
+    protocol_conn_t *conn = protocol_conn(sock);
+    protocol_release(sock);
+    if (conn != &spare) {
+        free(conn);
+        conns[sock] = NULL;
+    }
+    net_close(sock);
+}
+
+/* Start a frame in the next slot of the socket's outbound queue, flushing a
+ * full one first; returns its data field, of `room` bytes, to fill before
+ * protocol_commit */
+char *protocol_begin(SOCKET sock, msg_type_t type, const char *sender, const char *recipient, size_t *room)
+{
+    if (room) *room = BUF_SIZE;
+    if (is_routed(sock)) {
+        routed.type = type;
+        put_field(routed.sender, sizeof(routed.sender), sender);
+        put_field(routed.recipient, sizeof(routed.recipient), recipient);
+        return routed.data;
+    }
+    protocol_conn_t *conn = protocol_conn(sock);
+    if (conn == &spare) memset(&spare.out[0], 0, sizeof(spare.out[0]));
+    if (conn->queued == PROTOCOL_QUEUE_FRAMES) flush_conn(sock, conn);
+    return codecs[conn->encoding].begin(conn, &conn->out[conn->queued], type, sender, recipient);
+}
+
+/* Terminate the data written after protocol_begin and queue the frame, for
+ * the next protocol_flush_all. Sockets past the table are written at once. */
+int protocol_commit(SOCKET sock, size_t data_len)
+{
+    if (data_len >= BUF_SIZE) data_len = BUF_SIZE - 1;
+    if (is_routed(sock)) {
+        routed.data[data_len] = '\0';
+        routed.request_id = sock >= 0 && sock < FD_SETSIZE ? routed_request_id[sock] : 0;
+        return route->send(sock, &routed, data_len);
+    }
+    protocol_conn_t *conn = protocol_conn(sock);
+    int slot = conn->queued++;
+    conn->out_size[slot] = codecs[conn->encoding].finish(conn, &conn->out[slot], data_len);
+    if (conn == &spare) return flush_conn(sock, conn);
+    if (!conn->pending) {
+        if (num_pending == FD_SETSIZE) protocol_flush_all();
+        conn->pending = 1;
+        pending[num_pending++] = sock;
+    }
+    return 0;
+}
+
+/* To build a message in place and send it to the client or the server */
+int protocol_send(SOCKET sock, msg_type_t type, const char *sender, const char *recipient, const char *data)
+{
+    return protocol_send_n(sock, type, sender, recipient, data, data ? strnlen(data, BUF_SIZE - 1) : 0);
+}
+
+/* Same when the caller knows the length of the data, e.g. for a broadcast */
+int protocol_send_n(SOCKET sock, msg_type_t type, const char *sender, const char *recipient, const char *data, size_t data_len)
+{
+    size_t room;
+    char *field = protocol_begin(sock, type, sender, recipient, &room);
+    if (data_len >= room) data_len = room - 1;
+    if (data_len) memcpy(field, data, data_len);
+    return protocol_commit(sock, data_len);
+}
+
+/* Same, with the data formatted straight into the frame */
+int protocol_sendf(SOCKET sock, msg_type_t type, const char *sender, const char *recipient, const char *fmt, ...)
+{
+    size_t room;
+    char *field = protocol_begin(sock, type, sender, recipient, &room);
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(field, room, fmt, ap);
+    va_end(ap);
+    return protocol_commit(sock, len < 0 ? 0 : (size_t)len);
+}
+
+/* Read once from the socket into its receive ring, as much as fits: both
+ * free segments when the space wraps. Returns the number of bytes read, 0
+ * when the peer closed the connection or -1 on error (or a full ring). */
+int protocol_fill(SOCKET sock)
+{
+    if (sock < 0 || sock >= FD_SETSIZE || !conns[sock]) return -1;
+    protocol_conn_t *conn = conns[sock];
+    if (conn->used == PROTOCOL_RING_SIZE) return -1;
+
+    size_t tail = conn->head + conn->used;
+    if (tail >= PROTOCOL_RING_SIZE) tail -= PROTOCOL_RING_SIZE;
+    struct iovec iov[2];
+    int iovcnt = 1;
+    iov[0].iov_base = conn->ring.bytes + tail;
+    if (tail >= conn->head) {
+        iov[0].iov_len = PROTOCOL_RING_SIZE - tail;
+        if (conn->head > 0) {
+            iov[1].iov_base = conn->ring.bytes;
+            iov[1].iov_len = conn->head;
+            iovcnt = 2;
+        }
+    } else {
+        iov[0].iov_len = conn->head - tail;
+    }
+
+    ssize_t received = readv(sock, iov, iovcnt);
+    if (received < 0) {
+        return -1;
+    }
+    conn->used += (size_t)received;
+    return (int)received;
+}
+
+/* Append bytes read from the socket by other means (an io_uring receive) to
+ * its receive ring. Returns 0, or -1 when they do not fit. */
+int protocol_feed(SOCKET sock, const char *data, size_t len)
+{
+    if (sock < 0 || sock >= FD_SETSIZE || !conns[sock]) return -1;
+    protocol_conn_t *conn = conns[sock];
+    if (len > PROTOCOL_RING_SIZE - conn->used) return -1;
+
+    size_t tail = conn->head + conn->used;
+    if (tail >= PROTOCOL_RING_SIZE) tail -= PROTOCOL_RING_SIZE;
+    size_t first = PROTOCOL_RING_SIZE - tail;
+    if (first > len) first = len;
+    memcpy(conn->ring.bytes + tail, data, first);
+    memcpy(conn->ring.bytes, data + first, len - first);
+    conn->used += len;
+    return 0;
+}
+
+/* Take the next complete message buffered for the socket. The fields are
+ * terminated in place and `msg` points into the ring, valid until the next
+ * protocol_fill. Returns 1, 0 when no complete message is buffered, or -1
+ * on a malformed frame (the connection is then unusable). */
+int protocol_next(SOCKET sock, message_view_t *msg)
+{
+    if (sock < 0 || sock >= FD_SETSIZE || !conns[sock]) return 0;
+    protocol_conn_t *conn = conns[sock];
+    return codecs[conn->encoding].next(conn, msg);
+}
+
+/* to receive a message sent by the server or a client, waiting for the rest
+ * of a partial one (TCP fragmentation), after sending what is queued for the
+ * socket. Extra messages stay buffered for protocol_next. Returns 1, 0 on close or -1 on error. */
+int protocol_recv(SOCKET sock, message_view_t *msg)
+{
+    int status;
+    if (protocol_flush(sock) < 0) return -1;
+    while ((status = protocol_next(sock, msg)) == 0) {
+        int received = protocol_fill(sock);
+        if (received <= 0) {
+            return received;
+        }
+    }
+    return status;
+}
+
+/* "awale <version> <features>", sent in the recipient of MSG_LOGIN and of
+ * MSG_LOGIN_SUCCESS to negotiate the protocol */
+void protocol_format_hello(char *buffer, size_t size, unsigned version, unsigned features)
+{
+    snprintf(buffer, size, "awale %u %x", version, features);
+}
+
+/* Read a hello; anything else (an older peer) is version 1 with no features.
+ * Returns 1 if `text` was a hello. */
+int protocol_parse_hello(const char *text, unsigned *version, unsigned *features)
+{
+    if (sscanf(text, "awale %u %x", version, features) == 2 && *version >= 2) return 1;
+    *version = 1;
+    *features = 0;
+    return 0;
+}
+
+/* Send a login message. The password (if any) is placed in the data field,
+ * the protocol version and features this side supports in the recipient. */
+int protocol_send_login(SOCKET sock, const char *username, const char *password)
+{
+    char hello[32];
+    protocol_format_hello(hello, sizeof(hello), PROTOCOL_VERSION, PROTOCOL_FEATURES);
+    return protocol_send(sock, MSG_LOGIN, username, hello, password);
+}
+
+/* Send a challenge message */
+int protocol_send_challenge(SOCKET sock, const char *from, const char *to, const char *rules)
+{
+    return protocol_send(sock, MSG_CHALLENGE, from, to, rules);
+}
+
+/* Send a move message*/
+int protocol_send_move(SOCKET sock, const char *player, int hole, const char *session_id)
+{
+    return protocol_sendf(sock, MSG_PLAY_MOVE, player, session_id, "%d", hole);
+}
+/* Send a private chat message*/
+int protocol_send_private_chat(SOCKET sock, const char *from, const char *to, const char *text)
+{
+    return protocol_send(sock, MSG_PRIVATE_CHAT, from, to, text);
+}
+/* Send a session chat message*/
+int protocol_send_session_chat(SOCKET sock, const char *from, const char *session_id, const char *text)
+{
+    return protocol_send(sock, MSG_SESSION_CHAT, from, session_id, text);
+}
@@ -1,13 +1,15 @@
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include "net.h"
 
 /* Message types for client-server communication */
 typedef enum {
-    MSG_LOGIN,              /* Client logs in with username */
+    MSG_LOGIN,              /* Client logs in with username (recipient: protocol hello, data: password) */
     MSG_LOGOUT,             /* Client disconnects */
-    MSG_LOGIN_SUCCESS,      /* Server confirms successful login */
+    MSG_LOGIN_SUCCESS,      /* Server confirms successful login (recipient: agreed hello for version 2+) */
     MSG_LIST_PLAYERS,       /* Request list of online players */
     MSG_PLAYER_LIST,        /* Server response with player list */
     MSG_LIST_FRIENDS,       /* Request list of friends */
@@ -20,7 +22,7 @@ typedef enum {
     MSG_FRIEND_RESULT,      /* Result of add/remove friend (success/error text in data) */
     MSG_LIST_GAMES,         /* Request list of ongoing games (sessions) */
     MSG_GAME_LIST,          /* Server response with games list */
-    MSG_CHALLENGE,          /* Player A challenges player B */
+    MSG_CHALLENGE,          /* Player A challenges player B (data: rule variant, empty = standard) */
     MSG_CHALLENGE_ACCEPT,   /* Player B accepts challenge */
     MSG_CHALLENGE_REFUSE,   /* Player B refuses challenge */
     MSG_GAME_START,         /* Server notifies game start */
@@ -35,25 +37,116 @@ typedef enum {
     MSG_BIO_EDIT,
     MSG_SPECTATE,           /* Request to spectate a game */
     MSG_SET_PRIVATE,         /* Client -> server: set private mode (data="1" or "0") */
-    MSG_GIVE_UP             /* Player gives up the game */
+    MSG_GIVE_UP,            /* Player gives up the game */
+    MSG_ANALYZE,            /* Spectator (un)subscribes to live analysis (recipient = session id, data "off" to stop) */
+    MSG_ANALYSIS            /* Server->client: analysis text (recipient = session id) */
 } msg_type_t;
 
-/* Protocol message structure */
+/* Wire layout of a message: a fixed-size frame, each field NUL-terminated.
+ * Bytes past a terminator are unspecified (stale bytes of earlier frames sent
+ * to the same connection), so only read up to the terminator.
+ *
+ * request_id takes the last 4 bytes of what used to be a 64-byte sender, so
+ * the frame keeps its size: older peers zero-padded them, which reads as 0,
+ * "no ID", and ignore them past the sender's terminator. A client may number
+ * its requests; the server echoes the ID in every reply and error it sends
+ * back while handling that request, so replies can be matched out of order.
+ * Names, which travel as the sender, are therefore at most
+ * PROTOCOL_NAME_MAX characters; the server refuses longer ones at login. */
+#define PROTOCOL_NAME_MAX 59
+
 typedef struct {
     msg_type_t type;
-    char sender[64];
+    char sender[60];
+    uint32_t request_id;    /* 0 = none */
     char recipient[64];
     char data[BUF_SIZE];
 } message_t;
 
-/* Protocol functions */
-int protocol_send_message(int sock, const message_t *msg);
-int protocol_recv_message(int sock, message_t *msg);
-void protocol_create_message(message_t *msg, msg_type_t type, const char *sender, const char *recipient, const char *data);
-void protocol_create_login(message_t *msg, const char *username, const char *password);
-void protocol_create_challenge(message_t *msg, const char *from, const char *to);
-void protocol_create_move(message_t *msg, const char *player, int hole, const char *session_id);
-void protocol_create_private_chat(message_t *msg, const char *from, const char *to, const char *text);
-void protocol_create_session_chat(message_t *msg, const char *from, const char *session_id, const char *text);
+/* A received message: views into the connection's receive ring, valid until
+ * the next protocol_fill on that socket. Every field is NUL-terminated. */
+typedef struct {
+    msg_type_t type;
+    uint32_t request_id;
+    const char *sender;
+    const char *recipient;
+    const char *data;
+} message_view_t;
+
+/* Frames buffered per connection on the receive side, and queued on the
+ * send side between two flushes */
+#define PROTOCOL_RING_FRAMES 16
+#define PROTOCOL_QUEUE_FRAMES 16
+
+/* Protocol version and feature bits, negotiated at login: MSG_LOGIN carries
+ * the client's in its recipient, MSG_LOGIN_SUCCESS the agreed ones. Peers
+ * that send no hello speak version 1, legacy frames only. */
+#define PROTOCOL_VERSION 2
+#define PROTOCOL_FEATURE_COMPACT 0x1u   /* compact frames after MSG_LOGIN_SUCCESS */
+#define PROTOCOL_FEATURES PROTOCOL_FEATURE_COMPACT
+
+/* Frame encodings. Legacy frames are a whole message_t; compact frames carry
+ * a 12-byte header and the fields at their length. The switch applies to
+ * the frames after MSG_LOGIN_SUCCESS, which is itself legacy, in both
+ * directions: a client asking for compact frames sends nothing between its
+ * MSG_LOGIN and the answer. */
+typedef enum {
+    PROTOCOL_LEGACY,
+    PROTOCOL_COMPACT,
+    PROTOCOL_ENCODINGS
+} protocol_encoding_t;
+
+struct iovec;
+
+/* Delivery of the frames sent by a thread to sockets it does not own, to the
+ * thread that does (see protocol_set_route). `frame` is legacy-laid out,
+ * with the request ID set for the socket, and only valid during the call.
+ * `local`, if set, tells the sockets the thread does own: their frames skip
+ * the route. */
+typedef struct {
+    int (*send)(SOCKET sock, const message_t *frame, size_t data_len);
+    void (*set_encoding)(SOCKET sock, protocol_encoding_t encoding);
+    void (*close)(SOCKET sock);
+    int (*local)(SOCKET sock);
+} protocol_route_t;
+
+/* Protocol functions. Frames are built and read in place in per-connection
+ * buffers indexed by socket, so they are for the thread doing the I/O on
+ * that socket; a thread with a route set sends through it instead. The
+ * buffers are allocated by protocol_reset, when the connection is accepted
+ * or connected, and freed by protocol_close. Sent
+ * frames are queued until protocol_flush_all, which the event loop calls
+ * before it waits; protocol_close sends what is left before closing. A loop
+ * doing its own I/O takes the queues with protocol_pending/protocol_queued
+ * and gives received bytes with protocol_feed. A thread hands a connection
+ * over to another with protocol_release. */
+void protocol_set_route(const protocol_route_t *route);
+int protocol_reset(SOCKET sock);
+void protocol_set_encoding(SOCKET sock, protocol_encoding_t encoding);
+void protocol_format_hello(char *buffer, size_t size, unsigned version, unsigned features);
+int protocol_parse_hello(const char *text, unsigned *version, unsigned *features);
+void protocol_set_request_id(SOCKET sock, uint32_t request_id);
+int protocol_fill(SOCKET sock);
+int protocol_feed(SOCKET sock, const char *data, size_t len);
+int protocol_next(SOCKET sock, message_view_t *msg);
+int protocol_recv(SOCKET sock, message_view_t *msg);
+int protocol_send(SOCKET sock, msg_type_t type, const char *sender, const char *recipient, const char *data);
+int protocol_send_n(SOCKET sock, msg_type_t type, const char *sender, const char *recipient, const char *data, size_t data_len);
+int protocol_sendf(SOCKET sock, msg_type_t type, const char *sender, const char *recipient, const char *fmt, ...)
+    __attribute__((format(printf, 5, 6)));
+char *protocol_begin(SOCKET sock, msg_type_t type, const char *sender, const char *recipient, size_t *room);
+int protocol_commit(SOCKET sock, size_t data_len);
+int protocol_flush(SOCKET sock);
+void protocol_flush_all(void);
+int protocol_release(SOCKET sock);
+void protocol_close(SOCKET sock);
+int protocol_pending(SOCKET *socks);
+int protocol_queued(SOCKET sock, struct iovec *iov);
+void protocol_sent(SOCKET sock);
+int protocol_send_login(SOCKET sock, const char *username, const char *password);
+int protocol_send_challenge(SOCKET sock, const char *from, const char *to, const char *rules);
+int protocol_send_move(SOCKET sock, const char *player, int hole, const char *session_id);
+int protocol_send_private_chat(SOCKET sock, const char *from, const char *to, const char *text);
+int protocol_send_session_chat(SOCKET sock, const char *from, const char *session_id, const char *text);
 
 #endif 
@@ -0,0 +1,492 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "ai.h"
+#include "tablebase.h"
+#include "nn.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+/* Alpha-beta (negamax) search with iterative deepening.
+ * Parallelism is Lazy SMP: every thread searches the same root independently
+ * and they cooperate only through the shared, lock-free transposition table. */
+
+#define TT_DEFAULT_MB 16
+#define TT_BOUND_UPPER 1
+#define TT_BOUND_LOWER 2
+#define TT_BOUND_EXACT 3
+
+/* One table slot. `check` holds key ^ data so a torn write from a concurrent
+ * thread is detected on probe instead of returning a corrupted entry. */
+typedef struct {
+    uint64_t check;
+    uint64_t data;
+} tt_entry_t;
+
+typedef struct {
+    int score;
+    int depth;
+    int bound;
+    int move;
+} tt_hit_t;
+
+static tt_entry_t *tt_table = NULL;
+static uint64_t tt_mask = 0;
+static unsigned int tt_generation = 0;
+
+/* Per-thread search state */
+typedef struct {
+    awale_game_t root;
+    const ai_config_t *cfg;
+    volatile int *stop;         /* shared by all threads of one search */
+    struct timespec start;
+    unsigned int generation;
+    int id;
+    int pondering;              /* time_ms starts counting once cfg->ponder clears */
+    int aborted;
+    unsigned long long nodes;
+    int root_move;
+    int best_move;
+    int best_score;
+    int depth;
+    int use_nn;
+    const ai_weights_t *weights;        /* cfg->weights, when they apply to the rules */
+    nn_acc_t acc[AI_MAX_DEPTH + 1];     /* network accumulators, one per ply */
+} search_thread_t;
+
+// Allocate the shared transposition table (rounded down to a power of two entries).
+int ai_init(size_t tt_size_mb)
+{
+    if (tt_size_mb == 0) tt_size_mb = TT_DEFAULT_MB;
+    size_t entries = 1;
+    while (entries * 2 * sizeof(tt_entry_t) <= tt_size_mb * 1024 * 1024) entries *= 2;
+
+    ai_cleanup();
+    tt_table = (tt_entry_t*)calloc(entries, sizeof(tt_entry_t));
+    if (!tt_table) {
+        perror("calloc");
+        return -1;
+    }
+    tt_mask = entries - 1;
+    return 0;
+}
+
+// Release the transposition table.
+void ai_cleanup(void)
+{
+    free(tt_table);
+    tt_table = NULL;
+    tt_mask = 0;
+}
+
+// Forget everything stored in the transposition table.
+void ai_clear(void)
+{
+    if (tt_table) memset(tt_table, 0, (size_t)(tt_mask + 1) * sizeof(tt_entry_t));
+}
+
+void ai_config_default(ai_config_t *cfg)
+{
+    if (!cfg) return;
+    cfg->threads = 1;
+    cfg->max_depth = 12;
+    cfg->time_ms = 0;
+    cfg->stop = NULL;
+    cfg->ponder = NULL;
+    cfg->ponder_ms = 0;
+    cfg->use_nn = 0;
+    cfg->weights = NULL;
+    cfg->tt_salt = 0;
+}
+
+// Static evaluation from the side to move's point of view: the score difference.
+int ai_evaluate(const awale_game_t *game)
+{
+    int me = game->current_player;
+    return game->scores[me] - game->scores[1 - me];
+}
+
+const char *const ai_eval_term_names[AI_EVAL_TERMS] = {
+    "material", "board", "vulnerable", "empty", "kroo"
+};
+
+void ai_weights_default(ai_weights_t *weights)
+{
+    memset(weights, 0, sizeof(*weights));
+    weights->w[0] = AI_WEIGHT_SCALE;
+}
+
+// Evaluation terms, each "side to move minus opponent": captured seeds, seeds on
+// the own row, holes with 1-2 seeds (capturable), empty holes, holes of 12+ seeds.
+void ai_eval_features(const awale_game_t *game, int features[AI_EVAL_TERMS])
+{
+    int me = game->current_player;
+    features[0] = game->scores[me] - game->scores[1 - me];
+    for (int i = 1; i < AI_EVAL_TERMS; i++) features[i] = 0;
+    for (int h = 0; h < TOTAL_HOLES; h++) {
+        int sign = (h / HOLES_PER_PLAYER == me) ? 1 : -1;
+        int seeds = game->holes[h];
+        features[1] += sign * seeds;
+        if (seeds == 1 || seeds == 2) features[2] += sign;
+        if (seeds == 0) features[3] += sign;
+        if (seeds >= 12) features[4] += sign;
+    }
+}
+
+// Linear evaluation in seeds, side to move's point of view.
+int ai_evaluate_weights(const awale_game_t *game, const ai_weights_t *weights)
+{
+    int f[AI_EVAL_TERMS];
+    ai_eval_features(game, f);
+    int sum = 0;
+    for (int i = 0; i < AI_EVAL_TERMS; i++) sum += weights->w[i] * f[i];
+    return (sum >= 0 ? sum + AI_WEIGHT_SCALE / 2 : sum - AI_WEIGHT_SCALE / 2) / AI_WEIGHT_SCALE;
+}
+
+// Read "name value" lines; unknown names are ignored, missing ones keep their default.
+int ai_weights_load(const char *path, ai_weights_t *weights)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    ai_weights_default(weights);
+    char name[64];
+    int value;
+    while (fscanf(f, "%63s %d", name, &value) == 2) {
+        for (int i = 0; i < AI_EVAL_TERMS; i++) {
+            if (strcmp(name, ai_eval_term_names[i]) == 0) weights->w[i] = value;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+int ai_weights_save(const char *path, const ai_weights_t *weights)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    for (int i = 0; i < AI_EVAL_TERMS; i++) fprintf(f, "%s %d\n", ai_eval_term_names[i], weights->w[i]);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static int score_to_tt(int score, int ply)
+{
+    if (score >= AI_WIN - AI_MAX_DEPTH) return score + ply;
+    if (score <= -AI_WIN + AI_MAX_DEPTH) return score - ply;
+    return score;
+}
+
+static int score_from_tt(int score, int ply)
+{
+    if (score >= AI_WIN - AI_MAX_DEPTH) return score - ply;
+    if (score <= -AI_WIN + AI_MAX_DEPTH) return score + ply;
+    return score;
+}
+
+static int tt_probe(uint64_t key, tt_hit_t *hit)
+{
+    if (!tt_table) return 0;
+    tt_entry_t *e = &tt_table[key & tt_mask];
+    uint64_t data = __atomic_load_n(&e->data, __ATOMIC_RELAXED);
+    uint64_t check = __atomic_load_n(&e->check, __ATOMIC_RELAXED);
+    if ((check ^ data) != key || data == 0) return 0;
+
+    hit->score = (int16_t)(data & 0xFFFF);
+    hit->depth = (int)((data >> 16) & 0xFF);
+    hit->bound = (int)((data >> 24) & 0x3);
+    hit->move = (int)((data >> 26) & 0xF) - 1;
+    return 1;
+}
+
+static void tt_store(uint64_t key, unsigned int generation, int depth, int bound, int score, int move)
+{
+    if (!tt_table) return;
+    tt_entry_t *e = &tt_table[key & tt_mask];
+
+    /* Keep deeper entries from the current search unless this is the same position */
+    uint64_t old = __atomic_load_n(&e->data, __ATOMIC_RELAXED);
+    uint64_t old_key = __atomic_load_n(&e->check, __ATOMIC_RELAXED) ^ old;
+    if (old != 0 && old_key != key && ((old >> 32) & 0xFF) == (generation & 0xFF) &&
+        (int)((old >> 16) & 0xFF) > depth) {
+        return;
+    }
+
+    uint64_t data = (uint64_t)(uint16_t)(int16_t)score
+                  | ((uint64_t)(depth & 0xFF) << 16)
+                  | ((uint64_t)bound << 24)
+                  | ((uint64_t)(move + 1) << 26)
+                  | ((uint64_t)(generation & 0xFF) << 32);
+    __atomic_store_n(&e->check, key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&e->data, data, __ATOMIC_RELAXED);
+}
+
+static double elapsed_ms_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static int search_should_stop(search_thread_t *t)
+{
+    if (__atomic_load_n(t->stop, __ATOMIC_RELAXED)) return 1;
+    if (t->cfg->stop && __atomic_load_n(t->cfg->stop, __ATOMIC_RELAXED)) return 1;
+    if (t->pondering) {
+        if (__atomic_load_n(t->cfg->ponder, __ATOMIC_ACQUIRE)) {
+            return t->cfg->ponder_ms > 0 && elapsed_ms_since(&t->start) >= t->cfg->ponder_ms;
+        }
+        /* Ponder hit: the regular budget runs from now */
+        t->pondering = 0;
+        clock_gettime(CLOCK_MONOTONIC, &t->start);
+    }
+    if (t->cfg->time_ms > 0 && elapsed_ms_since(&t->start) >= t->cfg->time_ms) return 1;
+    return 0;
+}
+
+// Leaf evaluation: the network when enabled, else the score difference.
+static int evaluate(const search_thread_t *t, const awale_game_t *game, int ply)
+{
+    if (t->use_nn) return nn_evaluate(game, &t->acc[ply]);
+    if (t->weights) return ai_evaluate_weights(game, t->weights);
+    return ai_evaluate(game);
+}
+
+// Value of a finished game for the player who would be on move.
+static int terminal_score(const awale_game_t *game, int ply)
+{
+    if (game->winner == -1) return 0;
+    return (game->winner == game->current_player) ? AI_WIN - ply : -AI_WIN + ply;
+}
+
+// Exact value of a tablebase position: its final seed margin, lifted above any heuristic score.
+static int tablebase_score(const awale_game_t *game, int value)
+{
+    int margin = ai_evaluate(game) + value;
+    if (margin > 0) return AI_TB_WIN + margin;
+    if (margin < 0) return -AI_TB_WIN + margin;
+    return 0;
+}
+
+// Fill `moves` with legal holes for the side to move. The hash move goes first;
+// helper threads rotate the rest so Lazy SMP threads explore different orders.
+static int generate_moves(const awale_game_t *game, int *moves, int first, int rotate)
+{
+    if (game->variant != AWALE_VARIANT_STANDARD) {
+        /* Feeding and grand slam rules: ask the variant's kernel */
+        const awale_variant_info_t *info = awale_variant_info(game->variant);
+        if (!info) return 0;
+        int holes = info->holes_per_player;
+        int n = 0;
+        if (first >= 0 && awale_is_valid_move(game, first)) moves[n++] = first;
+        for (int i = 0; i < holes; i++) {
+            int hole = game->current_player * holes + (holes - 1 - (i + rotate) % holes);
+            if (hole != first && awale_is_valid_move(game, hole)) moves[n++] = hole;
+        }
+        return n;
+    }
+    int start = game->current_player * HOLES_PER_PLAYER;
+    int n = 0;
+    if (first >= 0 && awale_is_valid_move(game, first)) moves[n++] = first;
+    for (int i = 0; i < HOLES_PER_PLAYER; i++) {
+        int hole = start + (HOLES_PER_PLAYER - 1 - (i + rotate) % HOLES_PER_PLAYER);
+        if (hole != first && game->holes[hole] > 0) moves[n++] = hole;
+    }
+    return n;
+}
+
+static int search_node(search_thread_t *t, const awale_game_t *game, int depth, int alpha, int beta, int ply)
+{
+    if (game->game_over) return terminal_score(game, ply);
+
+    if ((++t->nodes & 1023) == 0 && search_should_stop(t)) t->aborted = 1;
+    if (t->aborted) return 0;
+
+    int tb_value;
+    if (ply > 0 && tb_probe(game, &tb_value)) return tablebase_score(game, tb_value);
+
+    if (depth <= 0 || ply >= AI_MAX_DEPTH - 1) return evaluate(t, game, ply);
+
+    uint64_t key = awale_hash(game) ^ t->cfg->tt_salt;
+    tt_hit_t hit;
+    int tt_move = -1;
+    if (tt_probe(key, &hit)) {
+        tt_move = hit.move;
+        if (ply > 0 && hit.depth >= depth) {
+            int s = score_from_tt(hit.score, ply);
+            if (hit.bound == TT_BOUND_EXACT) return s;
+            if (hit.bound == TT_BOUND_LOWER && s >= beta) return s;
+            if (hit.bound == TT_BOUND_UPPER && s <= alpha) return s;
+        }
+    }
+
+    int moves[HOLES_PER_PLAYER];
+    int n = generate_moves(game, moves, tt_move, t->id > 0 ? t->id + ply : 0);
+    if (n == 0) return evaluate(t, game, ply);
+
+    int alpha_orig = alpha;
+    int best = -AI_INF;
+    int best_move = moves[0];
+    for (int i = 0; i < n; i++) {
+        awale_game_t child = *game;
+        awale_play_move(&child, moves[i]);
+        if (t->use_nn) nn_update(&t->acc[ply], game, &child, &t->acc[ply + 1], depth > 1 ? -1 : child.current_player);
+        int score = -search_node(t, &child, depth - 1, -beta, -alpha, ply + 1);
+        if (t->aborted) return 0;
+
+        if (score > best) {
+            best = score;
+            best_move = moves[i];
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta) break;
+            }
+        }
+    }
+
+    int bound = (best <= alpha_orig) ? TT_BOUND_UPPER : (best >= beta) ? TT_BOUND_LOWER : TT_BOUND_EXACT;
+    tt_store(key, t->generation, depth, bound, score_to_tt(best, ply), best_move);
+    if (ply == 0) t->root_move = best_move;
+    return best;
+}
+
+// Iterative deepening driver run by every search thread.
+static void *search_thread_main(void *arg)
+{
+    search_thread_t *t = (search_thread_t*)arg;
+    int max_depth = t->cfg->max_depth > 0 ? t->cfg->max_depth : AI_MAX_DEPTH - 1;
+    if (max_depth > AI_MAX_DEPTH - 1) max_depth = AI_MAX_DEPTH - 1;
+
+    /* Helpers start one ply deeper every other thread to spread work across depths */
+    int first_depth = (t->id > 0) ? 1 + (t->id & 1) : 1;
+    for (int depth = first_depth; depth <= max_depth; depth++) {
+        t->root_move = -1;
+        int score = search_node(t, &t->root, depth, -AI_INF, AI_INF, 0);
+        if (t->aborted) break;
+
+        t->best_move = t->root_move;
+        t->best_score = score;
+        t->depth = depth;
+        if (score >= AI_WIN - AI_MAX_DEPTH || score <= -AI_WIN + AI_MAX_DEPTH) break;
+    }
+
+    /* The main thread finishing, or any thread completing the last
+     * iteration, ends the whole search */
+    if (t->id == 0 || t->depth >= max_depth) __atomic_store_n(t->stop, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+// Rebuild the principal variation by following hash moves from the root.
+static void extract_pv(const awale_game_t *game, uint64_t salt, ai_result_t *result)
+{
+    result->pv_len = 0;
+    if (result->best_move < 0) return;
+
+    awale_game_t pos = *game;
+    int move = result->best_move;
+    while (result->pv_len < AI_MAX_PV && awale_is_valid_move(&pos, move)) {
+        result->pv[result->pv_len++] = move;
+        awale_play_move(&pos, move);
+
+        tt_hit_t hit;
+        if (pos.game_over || !tt_probe(awale_hash(&pos) ^ salt, &hit)) break;
+        move = hit.move;
+    }
+}
+
+// Answer from the tablebase when the root is covered: instant and exact.
+static int tablebase_root(const awale_game_t *game, ai_result_t *result)
+{
+    int move, value;
+    if (!tb_best_move(game, &move, &value)) return 0;
+
+    result->best_move = move;
+    result->score = tablebase_score(game, value);
+    awale_game_t pos = *game;
+    while (result->pv_len < AI_MAX_PV && tb_best_move(&pos, &move, &value)) {
+        result->pv[result->pv_len++] = move;
+        awale_play_move(&pos, move);
+    }
+    return 1;
+}
+
+// Search `game` and report the best move for the side to move.
+// Returns 0 on success, -1 on invalid arguments.
+int ai_search(const awale_game_t *game, const ai_config_t *cfg, ai_result_t *result)
+{
+    if (!game || !result) return -1;
+
+    ai_config_t defaults;
+    if (!cfg) {
+        ai_config_default(&defaults);
+        cfg = &defaults;
+    }
+
+    memset(result, 0, sizeof(*result));
+    result->best_move = -1;
+    if (tablebase_root(game, result)) return 0;
+
+    int nthreads = cfg->threads;
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > AI_MAX_THREADS) nthreads = AI_MAX_THREADS;
+
+    volatile int stop = 0;
+    unsigned int generation = __atomic_add_fetch(&tt_generation, 1, __ATOMIC_RELAXED);
+    search_thread_t threads[AI_MAX_THREADS];
+    pthread_t tids[AI_MAX_THREADS];
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int i = 0; i < nthreads; i++) {
+        search_thread_t *t = &threads[i];
+        memset(t, 0, sizeof(*t));
+        t->root = *game;
+        t->cfg = cfg;
+        t->stop = &stop;
+        t->start = start;
+        t->generation = generation;
+        t->id = i;
+        t->pondering = cfg->ponder && __atomic_load_n(cfg->ponder, __ATOMIC_ACQUIRE);
+        t->best_move = -1;
+        t->root_move = -1;
+        /* The network and the weights are trained for the standard rules */
+        t->use_nn = cfg->use_nn && nn_loaded() && game->variant == AWALE_VARIANT_STANDARD;
+        t->weights = game->variant == AWALE_VARIANT_STANDARD ? cfg->weights : NULL;
+        if (t->use_nn) nn_refresh(game, &t->acc[0]);
+    }
+
+    int started = 1;
+    for (int i = 1; i < nthreads; i++) {
+        if (pthread_create(&tids[i], NULL, search_thread_main, &threads[i]) != 0) break;
+        started++;
+    }
+    search_thread_main(&threads[0]);
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    for (int i = 1; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    /* Report the deepest completed iteration; the main thread wins ties */
+    search_thread_t *best = &threads[0];
+    for (int i = 0; i < started; i++) {
+        result->nodes += threads[i].nodes;
+        if (threads[i].best_move >= 0 && (best->best_move < 0 || threads[i].depth > best->depth)) {
+            best = &threads[i];
+        }
+    }
+
+    result->best_move = best->best_move;
+    result->score = best->best_score;
+    result->depth = best->depth;
+    if (result->best_move < 0) {
+        /* Stopped before depth 1 completed: fall back to any legal move */
+        int moves[HOLES_PER_PLAYER];
+        if (!game->game_over && generate_moves(game, moves, -1, 0) > 0) {
+            result->best_move = moves[0];
+            result->score = ai_evaluate(game);
+        }
+    }
+    extract_pv(game, cfg->tt_salt, result);
+    result->elapsed_ms = elapsed_ms_since(&start);
+    return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef AI_H
+#define AI_H
+
+#include <stddef.h>
+#include "awale.h"
+
+/* Search limits */
+#define AI_MAX_DEPTH 64
+#define AI_MAX_PV 32
+#define AI_MAX_THREADS 64
+
+/* Score bounds: wins are AI_WIN minus the ply they are reached at */
+#define AI_INF 32000
+#define AI_WIN 30000
+
+/* Tablebase results: AI_TB_WIN plus the final seed margin, below any win score */
+#define AI_TB_WIN 20000
+
+/* Tunable linear evaluation: terms from ai_eval_features, weights in
+ * 1/AI_WEIGHT_SCALE seeds. The defaults reduce to the score difference. */
+#define AI_EVAL_TERMS 5
+#define AI_WEIGHT_SCALE 16
+#define AI_WEIGHTS_FILE "awale.weights"
+
+typedef struct {
+    int w[AI_EVAL_TERMS];
+} ai_weights_t;
+
+/* Search configuration */
+typedef struct {
+    int threads;            /* search threads (Lazy SMP), 1 = single-threaded */
+    int max_depth;          /* iterative deepening limit, in plies */
+    int time_ms;            /* wall-clock budget, 0 = depth limit only */
+    volatile int *stop;     /* optional external stop flag, polled while searching */
+    volatile int *ponder;   /* optional: while set, time_ms does not run; it starts on clear */
+    int ponder_ms;          /* cap on the time spent pondering, 0 = none */
+    int use_nn;             /* evaluate with the neural network when one is loaded */
+    const ai_weights_t *weights;    /* linear evaluation, NULL = score difference */
+    uint64_t tt_salt;       /* mixed into hash keys: searches with different evaluations
+                               running at once must not share table entries */
+} ai_config_t;
+
+/* Search result */
+typedef struct {
+    int best_move;          /* hole index, -1 if the side to move has no move */
+    int score;              /* from the side to move's point of view */
+    int depth;              /* deepest fully completed iteration */
+    int pv[AI_MAX_PV];      /* principal variation, pv[0] == best_move */
+    int pv_len;
+    unsigned long long nodes;
+    double elapsed_ms;
+} ai_result_t;
+
+/* Shared transposition table lifecycle */
+int ai_init(size_t tt_size_mb);
+void ai_cleanup(void);
+void ai_clear(void);
+
+/* Search */
+void ai_config_default(ai_config_t *cfg);
+int ai_search(const awale_game_t *game, const ai_config_t *cfg, ai_result_t *result);
+int ai_evaluate(const awale_game_t *game);
+
+/* Linear evaluation */
+extern const char *const ai_eval_term_names[AI_EVAL_TERMS];
+void ai_weights_default(ai_weights_t *weights);
+void ai_eval_features(const awale_game_t *game, int features[AI_EVAL_TERMS]);
+int ai_evaluate_weights(const awale_game_t *game, const ai_weights_t *weights);
+int ai_weights_load(const char *path, ai_weights_t *weights);
+int ai_weights_save(const char *path, const ai_weights_t *weights);
+
+#endif /* AI_H */
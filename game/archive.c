@@ -0,0 +1,95 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "archive.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+// List the .awale files of `dir`. Returns the count, or -1.
+int archive_list(const char *dir, char ***out)
+{
+    DIR *d = opendir(dir);
+    if (!d) return -1;
+    int count = 0, capacity = 0;
+    char **files = NULL;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        if (len < 7 || strcmp(ent->d_name + len - 6, ".awale") != 0) continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            char **grown = (char**)realloc(files, capacity * sizeof(char*));
+            if (!grown) break;
+            files = grown;
+        }
+        size_t size = strlen(dir) + len + 2;
+        files[count] = (char*)malloc(size);
+        if (!files[count]) break;
+        snprintf(files[count], size, "%s/%s", dir, ent->d_name);
+        count++;
+    }
+    closedir(d);
+    *out = files;
+    return count;
+}
+
+void archive_free_list(char **files, int count)
+{
+    for (int i = 0; i < count; i++) free(files[i]);
+    free(files);
+}
+
+// Replay one saved game, calling `visit` for each of its first `max_plies` moves
+// (all of them if max_plies <= 0). Returns the number of moves replayed, or -1.
+int archive_replay(const char *filename, int max_plies, archive_visit_t visit, void *ctx)
+{
+    FILE *f = fopen(filename, "r");
+    if (!f) return -1;
+
+    char line[256];
+    archive_game_t info;
+    memset(&info, 0, sizeof(info));
+    info.winner = -2;
+    int in_moves = 0;
+    int plies = 0;
+    awale_game_t game;
+    awale_reset(&game);
+
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!in_moves) {
+            if (strncmp(line, "players: ", 9) == 0) {
+                if (sscanf(line + 9, "%63[^|]|%63[^\n]", info.names[0], info.names[1]) != 2) break;
+            } else if (strncmp(line, "variant: ", 9) == 0) {
+                /* The tools learn the standard rules only */
+                if (awale_variant_by_name(line + 9) != AWALE_VARIANT_STANDARD) break;
+            } else if (strncmp(line, "winner: ", 8) == 0) {
+                info.winner = atoi(line + 8);
+            } else if (strncmp(line, "scores: ", 8) == 0) {
+                if (sscanf(line + 8, "%d %d", &info.scores[0], &info.scores[1]) != 2) break;
+            } else if (strcmp(line, "moves:") == 0) {
+                in_moves = 1;
+            }
+            continue;
+        }
+
+        /* "name|hole"; hole -1 marks a give-up */
+        char *sep = strrchr(line, '|');
+        if (!sep || info.winner < -1 || (max_plies > 0 && plies >= max_plies)) break;
+        *sep = '\0';
+        int hole = atoi(sep + 1);
+        int player = (strcmp(line, info.names[0]) == 0) ? 0 : (strcmp(line, info.names[1]) == 0) ? 1 : -1;
+        if (hole < 0 || player < 0) break;
+
+        /* Who started is not stored: it is whoever played first */
+        if (plies == 0) game.current_player = player;
+        if (player != game.current_player || !awale_is_valid_move(&game, hole)) break;
+        if (visit(&info, &game, hole, ctx) != 0) break;
+
+        awale_play_move(&game, hole);
+        plies++;
+    }
+    fclose(f);
+    return plies > 0 ? plies : -1;
+}
@@ -0,0 +1,25 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "awale.h"
+
+/* Reading the saved_games archive (the .awale files written by the server)
+ * for the offline tools: opening book, evaluation training. Games played
+ * under another rule variant are skipped. */
+
+/* Header of one archived game */
+typedef struct {
+    char names[2][64];
+    int winner;             /* 0, 1, or -1 for a draw */
+    int scores[2];          /* final scores */
+} archive_game_t;
+
+/* Called for every replayed move with the position before it; a nonzero
+ * return stops the replay of this game */
+typedef int (*archive_visit_t)(const archive_game_t *info, const awale_game_t *before, int hole, void *ctx);
+
+int archive_list(const char *dir, char ***files);
+void archive_free_list(char **files, int count);
+int archive_replay(const char *filename, int max_plies, archive_visit_t visit, void *ctx);
+
+#endif /* ARCHIVE_H */
@@ -11,17 +11,36 @@ awale_game_t* awale_create(void){
     if (!game){
         return NULL;
     }
-    awale_reset(game);
+    awale_init(game);
     return game;
 }
 
+// Initialize a caller-owned game object in place (embedded or on the stack),
+// the allocation-free counterpart of awale_create.
+void awale_init(awale_game_t *game){
+    awale_reset_variant(game, AWALE_VARIANT_STANDARD);
+}
+
 // Reset an existing game state to the initial configuration.
 void awale_reset(awale_game_t *game){
+    awale_reset_variant(game, AWALE_VARIANT_STANDARD);
+}
+
+// Reset to the initial configuration of a rule variant (unused holes stay empty).
+void awale_reset_variant(awale_game_t *game, int variant){
+    const awale_variant_info_t *info = awale_variant_info(variant);
+    if (!info) {
+        info = awale_variant_info(AWALE_VARIANT_STANDARD);
+        variant = AWALE_VARIANT_STANDARD;
+    }
     for (int i = 0; i< 2; ++i) game->scores[i]=0;
-    for (int i = 0; i < TOTAL_HOLES; ++i) game->holes[i] = 4;  
+    for (int i = 0; i < TOTAL_HOLES; ++i) {
+        game->holes[i] = (i < 2 * info->holes_per_player) ? info->initial_seeds : 0;
+    }
     game->game_over = 0;
     game->current_player = 0;
     game->winner = -1;
+    game->variant = variant;
 }
 
 // Free a previously allocated game object.
@@ -38,111 +57,114 @@ void awale_switch_player(awale_game_t *game){
     }
 }
 
+/* One rule kernel per variant, see awale_rules.h */
+#define SLAM_CAPTURE 0
+#define SLAM_NO_CAPTURE 1
+#define SLAM_FORBIDDEN 2
+
+#define VARIANT standard
+#define V_HOLES HOLES_PER_PLAYER
+#define V_WIN WINNING_SCORE
+#define V_FEED 0
+#define V_SLAM SLAM_CAPTURE
+#include "awale_rules.h"
+
+#define VARIANT abapa
+#define V_HOLES 6
+#define V_WIN 24
+#define V_FEED 1
+#define V_SLAM SLAM_NO_CAPTURE
+#include "awale_rules.h"
+
+#define VARIANT no_grand_slam
+#define V_HOLES 6
+#define V_WIN 24
+#define V_FEED 0
+#define V_SLAM SLAM_FORBIDDEN
+#include "awale_rules.h"
+
+#define VARIANT feed
+#define V_HOLES 6
+#define V_WIN 24
+#define V_FEED 1
+#define V_SLAM SLAM_CAPTURE
+#include "awale_rules.h"
+
+#define VARIANT four
+#define V_HOLES 4
+#define V_WIN 16
+#define V_FEED 0
+#define V_SLAM SLAM_CAPTURE
+#include "awale_rules.h"
+
+static const awale_variant_info_t awale_variants[AWALE_VARIANT_COUNT] = {
+    { "standard", "6 holes, no feeding rule, grand slams capture, 26 seeds win", HOLES_PER_PLAYER, INITIAL_SEEDS, WINNING_SCORE },
+    { "abapa", "Oware abapa: feed an empty opponent, grand slams capture nothing, 25 seeds win", 6, 4, 24 },
+    { "nograndslam", "grand slams are not allowed unless forced, 25 seeds win", 6, 4, 24 },
+    { "feed", "an empty opponent must be fed if possible, 25 seeds win", 6, 4, 24 },
+    { "4x4", "4 holes a side with 4 seeds each, 17 seeds win", 4, 4, 16 },
+};
+
+// Describe a rule variant, or NULL if it does not exist.
+const awale_variant_info_t *awale_variant_info(int variant){
+    if (variant < 0 || variant >= AWALE_VARIANT_COUNT) {
+        return NULL;
+    }
+    return &awale_variants[variant];
+}
+
+// Look a variant up by name; an empty name is the standard rules. Returns -1 if unknown.
+int awale_variant_by_name(const char *name){
+    if (!name || !*name) {
+        return AWALE_VARIANT_STANDARD;
+    }
+    for (int i = 0; i < AWALE_VARIANT_COUNT; i++) {
+        if (strcmp(name, awale_variants[i].name) == 0) return i;
+    }
+    return -1;
+}
+
+/* Kernels of the other variants, called through this table so the standard
+ * rules keep a dispatch of one predictable branch */
+typedef struct {
+    int (*is_valid_move)(const awale_game_t *game, int hole);
+    awale_status_t (*play_move)(awale_game_t *game, int hole);
+} awale_kernel_t;
+
+static const awale_kernel_t awale_kernels[AWALE_VARIANT_COUNT] = {
+    { is_valid_move_standard, play_move_standard },
+    { is_valid_move_abapa, play_move_abapa },
+    { is_valid_move_no_grand_slam, play_move_no_grand_slam },
+    { is_valid_move_feed, play_move_feed },
+    { is_valid_move_four, play_move_four },
+};
+
 // Check whether a move (hole index) is valid for the current player.
 int awale_is_valid_move(const awale_game_t *game, int hole){
     if (!game) {
         return 0;
     }
-    
-    if (game->game_over) {
-        return 0;
-    }
-    
-    if (hole < 0 || hole >= TOTAL_HOLES) {
-        return 0;
-    }
-    
-    int player = game->current_player;
-    int start = player * HOLES_PER_PLAYER;
-    int end = start + HOLES_PER_PLAYER;
-    
-    if (hole < start || hole >= end) {
-        return 0;
+    if (game->variant == AWALE_VARIANT_STANDARD) {
+        return is_valid_move_standard(game, hole);
     }
-    
-    if (game->holes[hole] == 0) {
+    if ((unsigned int)game->variant >= AWALE_VARIANT_COUNT) {
         return 0;
     }
-    
-    return 1;
+    return awale_kernels[game->variant].is_valid_move(game, hole);
 }
 
 // Execute a move: sow seeds from `hole`, apply capture rules and update scores.
-// Returns an awale_status_t indicating success or error reason.
 awale_status_t awale_play_move(awale_game_t *game, int hole){
-    if (!awale_is_valid_move(game, hole)) {
-        if (!game) return AWALE_INVALID_MOVE;
-        if (game->game_over) return AWALE_GAME_OVER;
-        if (hole < 0 || hole >= TOTAL_HOLES) return AWALE_INVALID_HOLE;
-        if (game->holes[hole] == 0) return AWALE_EMPTY_HOLE;
+    if (!game) {
         return AWALE_INVALID_MOVE;
     }
-    
-    int player = game->current_player;
-    int seeds = game->holes[hole];
-    game->holes[hole] = 0;
-    int current = hole;
-    
-    while (seeds > 0) {
-        current = (current + 1) % TOTAL_HOLES;
-        
-        if (current != hole) {
-            game->holes[current]++;
-            seeds--;
-        }
-    }
-    
-    int opponent = 1 - player;
-    int opp_start = opponent * HOLES_PER_PLAYER;
-    int opp_end = opp_start + HOLES_PER_PLAYER;
-    
-    while (current >= opp_start && current < opp_end &&
-           (game->holes[current] == 2 || game->holes[current] == 3)) {
-        
-        game->scores[player] += game->holes[current];
-        game->holes[current] = 0;
-        
-        current = (current - 1 + TOTAL_HOLES) % TOTAL_HOLES;
-    }
-    
-    awale_switch_player(game);
-    
-    if (game->scores[0] > WINNING_SCORE || game->scores[1] > WINNING_SCORE) {
-        game->game_over = 1;
-        game->winner = (game->scores[0] > game->scores[1]) ? 0 : 1;
-        return AWALE_OK;
-    }
-    
-    int player0_has_seeds = 0;
-    int player1_has_seeds = 0;
-    
-    for (int i = 0; i < HOLES_PER_PLAYER; i++) {
-        if (game->holes[i] > 0) player0_has_seeds = 1;
-        if (game->holes[i + HOLES_PER_PLAYER] > 0) player1_has_seeds = 1;
+    if (game->variant == AWALE_VARIANT_STANDARD) {
+        return play_move_standard(game, hole);
     }
-    
-    if (!player0_has_seeds || !player1_has_seeds) {
-        for (int i = 0; i < HOLES_PER_PLAYER; i++) {
-            game->scores[0] += game->holes[i];
-            game->holes[i] = 0;
-        }
-        for (int i = HOLES_PER_PLAYER; i < TOTAL_HOLES; i++) {
-            game->scores[1] += game->holes[i];
-            game->holes[i] = 0;
-        }
-        
-        game->game_over = 1;
-        
-        if (game->scores[0] > game->scores[1]) {
-            game->winner = 0;
-        } else if (game->scores[1] > game->scores[0]) {
-            game->winner = 1;
-        } else {
-            game->winner = -1;
-        }
+    if ((unsigned int)game->variant >= AWALE_VARIANT_COUNT) {
+        return AWALE_INVALID_MOVE;
     }
-    
-    return AWALE_OK;
+    return awale_kernels[game->variant].play_move(game, hole);
 }
 
 // Return whether the game has finished.
@@ -169,9 +191,191 @@ int awale_get_score(const awale_game_t *game, int player){
     return game->scores[player];
 }
 
+// Count the positions reached after exactly `depth` moves; finished games are
+// dead ends. Every leaf is played, so this exercises the sowing and capture code.
+uint64_t awale_perft(const awale_game_t *game, int depth){
+    if (!game) {
+        return 0;
+    }
+    if (depth <= 0) {
+        return 1;
+    }
+    const awale_variant_info_t *info = awale_variant_info(game->variant);
+    if (!info) {
+        return 0;
+    }
+    uint64_t nodes = 0;
+    int holes = info->holes_per_player;
+    int start = game->current_player * holes;
+    for (int hole = start; hole < start + holes; hole++) {
+        if (!awale_is_valid_move(game, hole)) continue;
+        awale_game_t child = *game;
+        awale_play_move(&child, hole);
+        nodes += awale_perft(&child, depth - 1);
+    }
+    return nodes;
+}
+
+// Mix a feature index into a pseudo-random 64-bit key (splitmix64 finalizer).
+// Used as an implicit Zobrist table so keys stay stable across builds and runs.
+static uint64_t awale_zobrist_key(uint64_t feature){
+    uint64_t x = feature + 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Zobrist hash of the position: seeds per hole, both scores, the side to move and
+// the rule variant (standard games hash as they always did).
+uint64_t awale_hash(const awale_game_t *game){
+    if (!game) {
+        return 0;
+    }
+    uint64_t h = game->current_player ? awale_zobrist_key(0xFFFF) : 0;
+    for (int i = 0; i < TOTAL_HOLES; i++) {
+        h ^= awale_zobrist_key(((uint64_t)i << 8) | (uint64_t)game->holes[i]);
+    }
+    h ^= awale_zobrist_key((12ULL << 8) | (uint64_t)game->scores[0]);
+    h ^= awale_zobrist_key((13ULL << 8) | (uint64_t)game->scores[1]);
+    if (game->variant != AWALE_VARIANT_STANDARD) {
+        h ^= awale_zobrist_key(0x10000 | (uint64_t)game->variant);
+    }
+    return h;
+}
+
+/* C(n, k) for n < AWALE_RANK_MAX_SEEDS + TOTAL_HOLES and k < TOTAL_HOLES */
+static const uint64_t awale_binomial[AWALE_RANK_MAX_SEEDS + TOTAL_HOLES][TOTAL_HOLES] = {
+    { 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 1, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 1, 3, 3, 1, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 1, 4, 6, 4, 1, 0, 0, 0, 0, 0, 0, 0 },
+    { 1, 5, 10, 10, 5, 1, 0, 0, 0, 0, 0, 0 },
+    { 1, 6, 15, 20, 15, 6, 1, 0, 0, 0, 0, 0 },
+    { 1, 7, 21, 35, 35, 21, 7, 1, 0, 0, 0, 0 },
+    { 1, 8, 28, 56, 70, 56, 28, 8, 1, 0, 0, 0 },
+    { 1, 9, 36, 84, 126, 126, 84, 36, 9, 1, 0, 0 },
+    { 1, 10, 45, 120, 210, 252, 210, 120, 45, 10, 1, 0 },
+    { 1, 11, 55, 165, 330, 462, 462, 330, 165, 55, 11, 1 },
+    { 1, 12, 66, 220, 495, 792, 924, 792, 495, 220, 66, 12 },
+    { 1, 13, 78, 286, 715, 1287, 1716, 1716, 1287, 715, 286, 78 },
+    { 1, 14, 91, 364, 1001, 2002, 3003, 3432, 3003, 2002, 1001, 364 },
+    { 1, 15, 105, 455, 1365, 3003, 5005, 6435, 6435, 5005, 3003, 1365 },
+    { 1, 16, 120, 560, 1820, 4368, 8008, 11440, 12870, 11440, 8008, 4368 },
+    { 1, 17, 136, 680, 2380, 6188, 12376, 19448, 24310, 24310, 19448, 12376 },
+    { 1, 18, 153, 816, 3060, 8568, 18564, 31824, 43758, 48620, 43758, 31824 },
+    { 1, 19, 171, 969, 3876, 11628, 27132, 50388, 75582, 92378, 92378, 75582 },
+    { 1, 20, 190, 1140, 4845, 15504, 38760, 77520, 125970, 167960, 184756, 167960 },
+    { 1, 21, 210, 1330, 5985, 20349, 54264, 116280, 203490, 293930, 352716, 352716 },
+    { 1, 22, 231, 1540, 7315, 26334, 74613, 170544, 319770, 497420, 646646, 705432 },
+    { 1, 23, 253, 1771, 8855, 33649, 100947, 245157, 490314, 817190, 1144066, 1352078 },
+    { 1, 24, 276, 2024, 10626, 42504, 134596, 346104, 735471, 1307504, 1961256, 2496144 },
+    { 1, 25, 300, 2300, 12650, 53130, 177100, 480700, 1081575, 2042975, 3268760, 4457400 },
+    { 1, 26, 325, 2600, 14950, 65780, 230230, 657800, 1562275, 3124550, 5311735, 7726160 },
+    { 1, 27, 351, 2925, 17550, 80730, 296010, 888030, 2220075, 4686825, 8436285, 13037895 },
+    { 1, 28, 378, 3276, 20475, 98280, 376740, 1184040, 3108105, 6906900, 13123110, 21474180 },
+    { 1, 29, 406, 3654, 23751, 118755, 475020, 1560780, 4292145, 10015005, 20030010, 34597290 },
+    { 1, 30, 435, 4060, 27405, 142506, 593775, 2035800, 5852925, 14307150, 30045015, 54627300 },
+    { 1, 31, 465, 4495, 31465, 169911, 736281, 2629575, 7888725, 20160075, 44352165, 84672315 },
+    { 1, 32, 496, 4960, 35960, 201376, 906192, 3365856, 10518300, 28048800, 64512240, 129024480 },
+    { 1, 33, 528, 5456, 40920, 237336, 1107568, 4272048, 13884156, 38567100, 92561040, 193536720 },
+    { 1, 34, 561, 5984, 46376, 278256, 1344904, 5379616, 18156204, 52451256, 131128140, 286097760 },
+    { 1, 35, 595, 6545, 52360, 324632, 1623160, 6724520, 23535820, 70607460, 183579396, 417225900 },
+    { 1, 36, 630, 7140, 58905, 376992, 1947792, 8347680, 30260340, 94143280, 254186856, 600805296 },
+    { 1, 37, 666, 7770, 66045, 435897, 2324784, 10295472, 38608020, 124403620, 348330136, 854992152 },
+    { 1, 38, 703, 8436, 73815, 501942, 2760681, 12620256, 48903492, 163011640, 472733756, 1203322288 },
+    { 1, 39, 741, 9139, 82251, 575757, 3262623, 15380937, 61523748, 211915132, 635745396, 1676056044 },
+    { 1, 40, 780, 9880, 91390, 658008, 3838380, 18643560, 76904685, 273438880, 847660528, 2311801440ULL },
+    { 1, 41, 820, 10660, 101270, 749398, 4496388, 22481940, 95548245, 350343565, 1121099408, 3159461968ULL },
+    { 1, 42, 861, 11480, 111930, 850668, 5245786, 26978328, 118030185, 445891810, 1471442973, 4280561376ULL },
+    { 1, 43, 903, 12341, 123410, 962598, 6096454, 32224114, 145008513, 563921995, 1917334783, 5752004349ULL },
+    { 1, 44, 946, 13244, 135751, 1086008, 7059052, 38320568, 177232627, 708930508, 2481256778ULL, 7669339132ULL },
+    { 1, 45, 990, 14190, 148995, 1221759, 8145060, 45379620, 215553195, 886163135, 3190187286ULL, 10150595910ULL },
+    { 1, 46, 1035, 15180, 163185, 1370754, 9366819, 53524680, 260932815, 1101716330, 4076350421ULL, 13340783196ULL },
+    { 1, 47, 1081, 16215, 178365, 1533939, 10737573, 62891499, 314457495, 1362649145, 5178066751ULL, 17417133617ULL },
+    { 1, 48, 1128, 17296, 194580, 1712304, 12271512, 73629072, 377348994, 1677106640, 6540715896ULL, 22595200368ULL },
+    { 1, 49, 1176, 18424, 211876, 1906884, 13983816, 85900584, 450978066, 2054455634, 8217822536ULL, 29135916264ULL },
+    { 1, 50, 1225, 19600, 230300, 2118760, 15890700, 99884400, 536878650, 2505433700ULL, 10272278170ULL, 37353738800ULL },
+    { 1, 51, 1275, 20825, 249900, 2349060, 18009460, 115775100, 636763050, 3042312350ULL, 12777711870ULL, 47626016970ULL },
+    { 1, 52, 1326, 22100, 270725, 2598960, 20358520, 133784560, 752538150, 3679075400ULL, 15820024220ULL, 60403728840ULL },
+    { 1, 53, 1378, 23426, 292825, 2869685, 22957480, 154143080, 886322710, 4431613550ULL, 19499099620ULL, 76223753060ULL },
+    { 1, 54, 1431, 24804, 316251, 3162510, 25827165, 177100560, 1040465790, 5317936260ULL, 23930713170ULL, 95722852680ULL },
+    { 1, 55, 1485, 26235, 341055, 3478761, 28989675, 202927725, 1217566350, 6358402050ULL, 29248649430ULL, 119653565850ULL },
+    { 1, 56, 1540, 27720, 367290, 3819816, 32468436, 231917400, 1420494075, 7575968400ULL, 35607051480ULL, 148902215280ULL },
+    { 1, 57, 1596, 29260, 395010, 4187106, 36288252, 264385836, 1652411475, 8996462475ULL, 43183019880ULL, 184509266760ULL },
+    { 1, 58, 1653, 30856, 424270, 4582116, 40475358, 300674088, 1916797311, 10648873950ULL, 52179482355ULL, 227692286640ULL },
+    { 1, 59, 1711, 32509, 455126, 5006386, 45057474, 341149446, 2217471399ULL, 12565671261ULL, 62828356305ULL, 279871768995ULL },
+};
+
+// Number of positions (both sides to move) with exactly `seeds` seeds on the board.
+uint64_t awale_rank_size(int seeds){
+    if (seeds < 0 || seeds > AWALE_RANK_MAX_SEEDS) {
+        return 0;
+    }
+    return 2 * awale_binomial[seeds + TOTAL_HOLES - 1][TOTAL_HOLES - 1];
+}
+
+// Rank the position among those with the same seed total (combinatorial number
+// system over the 12 hole counts), side to move as the most significant part.
+uint64_t awale_rank(const awale_game_t *game){
+    int seeds = 0;
+    for (int i = 0; i < TOTAL_HOLES; i++) {
+        seeds += game->holes[i];
+    }
+
+    uint64_t index = 0;
+    int left = seeds;
+    for (int i = 0; i < TOTAL_HOLES - 1; i++) {
+        int k = TOTAL_HOLES - 1 - i;
+        /* Distributions of the remaining seeds where hole i holds fewer than it does */
+        index += awale_binomial[left + k][k] - awale_binomial[left - game->holes[i] + k][k];
+        left -= game->holes[i];
+    }
+    if (game->current_player) {
+        index += awale_binomial[seeds + TOTAL_HOLES - 1][TOTAL_HOLES - 1];
+    }
+    return index;
+}
+
+// Inverse of awale_rank: rebuild the holes and side to move of position `index`
+// among those with `seeds` seeds. Scores are cleared. Returns 0, or -1 if out of range.
+int awale_unrank(uint64_t index, int seeds, awale_game_t *game){
+    if (!game || index >= awale_rank_size(seeds)) {
+        return -1;
+    }
+
+    uint64_t per_side = awale_binomial[seeds + TOTAL_HOLES - 1][TOTAL_HOLES - 1];
+    game->current_player = (index >= per_side);
+    if (game->current_player) {
+        index -= per_side;
+    }
+
+    int left = seeds;
+    for (int i = 0; i < TOTAL_HOLES - 1; i++) {
+        int k = TOTAL_HOLES - 1 - i;
+        int x = 0;
+        for (;;) {
+            uint64_t count = awale_binomial[left - x + k - 1][k - 1];
+            if (index < count) break;
+            index -= count;
+            x++;
+        }
+        game->holes[i] = x;
+        left -= x;
+    }
+    game->holes[TOTAL_HOLES - 1] = left;
+    game->scores[0] = 0;
+    game->scores[1] = 0;
+    game->game_over = 0;
+    game->winner = -1;
+    return 0;
+}
+
 // Pretty-print the current board and scores to stdout with optional player names.
 void awale_print(const awale_game_t *game, const char *player0_name, const char *player1_name){
     if (!game) return;
+    const awale_variant_info_t *info = awale_variant_info(game->variant);
+    int holes = info ? info->holes_per_player : HOLES_PER_PLAYER;
 
         const char *p0 = player0_name ? player0_name : "Player 0";
         const char *p1 = player1_name ? player1_name : "Player 1";
@@ -182,25 +386,25 @@ void awale_print(const awale_game_t *game, const char *player0_name, const char
         size_t max_label = strlen(top_label) > strlen(bottom_label) ? strlen(top_label) : strlen(bottom_label);
 
         printf("%*s", (int)max_label, "");
-        for (int i = TOTAL_HOLES - 1; i >= HOLES_PER_PLAYER; i--) {
+        for (int i = 2 * holes - 1; i >= holes; i--) {
             printf(" %2d  ", i);
         }
         printf("\n");
 
         printf("%-*s", (int)max_label, top_label);
-        for (int i = TOTAL_HOLES - 1; i >= HOLES_PER_PLAYER; i--) {
+        for (int i = 2 * holes - 1; i >= holes; i--) {
             printf("[%2d] ", game->holes[i]);
         }
         printf("  Score: %d\n", game->scores[1]);
 
         printf("%-*s", (int)max_label, bottom_label);
-        for (int i = 0; i < HOLES_PER_PLAYER; i++) {
+        for (int i = 0; i < holes; i++) {
             printf("[%2d] ", game->holes[i]);
         }
         printf("  Score: %d\n", game->scores[0]);
 
         printf("%*s", (int)max_label, "");
-        for (int i = 0; i < HOLES_PER_PLAYER; i++) {
+        for (int i = 0; i < holes; i++) {
             printf(" %2d  ", i);
         }
         printf("\n");
@@ -226,6 +430,8 @@ void awale_print(const awale_game_t *game, const char *player0_name, const char
 void awale_print_to_buffer(const awale_game_t *game, char *buffer, int size,
                                      const char *player0_name, const char *player1_name){
     if (!game || !buffer || size <= 0) return;
+    const awale_variant_info_t *info = awale_variant_info(game->variant);
+    int holes = info ? info->holes_per_player : HOLES_PER_PLAYER;
 
     int offset = 0;
 
@@ -240,25 +446,25 @@ void awale_print_to_buffer(const awale_game_t *game, char *buffer, int size,
 
     offset += snprintf(buffer + offset, size - offset, "\n");
     offset += snprintf(buffer + offset, size - offset, "%*s", (int)max_label, "");
-    for (int i = TOTAL_HOLES - 1; i >= HOLES_PER_PLAYER; i--) {
+    for (int i = 2 * holes - 1; i >= holes; i--) {
         offset += snprintf(buffer + offset, size - offset, " %2d  ", i);
     }
     offset += snprintf(buffer + offset, size - offset, "\n");
 
     offset += snprintf(buffer + offset, size - offset, "%-*s", (int)max_label, top_label);
-    for (int i = TOTAL_HOLES - 1; i >= HOLES_PER_PLAYER; i--) {
+    for (int i = 2 * holes - 1; i >= holes; i--) {
         offset += snprintf(buffer + offset, size - offset, "[%2d] ", game->holes[i]);
     }
     offset += snprintf(buffer + offset, size - offset, "  Score: %d\n", game->scores[1]);
 
     offset += snprintf(buffer + offset, size - offset, "%-*s", (int)max_label, bottom_label);
-    for (int i = 0; i < HOLES_PER_PLAYER; i++) {
+    for (int i = 0; i < holes; i++) {
         offset += snprintf(buffer + offset, size - offset, "[%2d] ", game->holes[i]);
     }
     offset += snprintf(buffer + offset, size - offset, "  Score: %d\n", game->scores[0]);
 
     offset += snprintf(buffer + offset, size - offset, "%*s", (int)max_label, "");
-    for (int i = 0; i < HOLES_PER_PLAYER; i++) {
+    for (int i = 0; i < holes; i++) {
         offset += snprintf(buffer + offset, size - offset, " %2d  ", i);
     }
     offset += snprintf(buffer + offset, size - offset, "\n");
@@ -297,6 +503,7 @@ int awale_save(const awale_game_t *game, const char *filename){
         fprintf(f, "%d ", game->holes[i]);
     }
     fprintf(f, "\n");
+    fprintf(f, "%d\n", game->variant);
     
     fclose(f);
     return 0;
@@ -340,6 +547,10 @@ awale_game_t* awale_load(const char *filename){
             return NULL;
         }
     }
+    /* Snapshots from before rule variants have no variant line */
+    if (fscanf(f, "%d", &game->variant) != 1 || !awale_variant_info(game->variant)) {
+        game->variant = AWALE_VARIANT_STANDARD;
+    }
     
     fclose(f);
     return game;
@@ -360,6 +571,8 @@ const char* awale_status_string(awale_status_t status){
             return "Starvation rule violation";
         case AWALE_GAME_OVER:
             return "Game over";
+        case AWALE_GRAND_SLAM_RULE:
+            return "Grand slam not allowed";
         default:
             return "Unknown status";
     }
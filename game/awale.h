@@ -1,6 +1,8 @@
 #ifndef AWALE_H
 #define AWALE_H
 
+#include <stdint.h>
+
 /* Awale game constants */
 #define HOLES_PER_PLAYER 6
 #define TOTAL_HOLES 12
@@ -14,9 +16,30 @@ typedef enum {
     AWALE_INVALID_HOLE,
     AWALE_EMPTY_HOLE,
     AWALE_STARVATION_RULE,
-    AWALE_GAME_OVER
+    AWALE_GAME_OVER,
+    AWALE_GRAND_SLAM_RULE
 } awale_status_t;
 
+/* Rule variants, chosen when a game starts. The constants above describe the
+ * standard rules; the other variants are separate kernels generated from
+ * awale_rules.h, so none of them pays for the others. */
+typedef enum {
+    AWALE_VARIANT_STANDARD,         /* this server's rules: no feeding, grand slams capture */
+    AWALE_VARIANT_ABAPA,            /* Oware abapa: feed an empty opponent, grand slams capture nothing */
+    AWALE_VARIANT_NO_GRAND_SLAM,    /* standard, but a move may not capture the whole opposing row */
+    AWALE_VARIANT_FEED,             /* standard, but an empty opponent must be fed */
+    AWALE_VARIANT_4X4,              /* 4 holes a side, 4 seeds each */
+    AWALE_VARIANT_COUNT
+} awale_variant_t;
+
+typedef struct {
+    const char *name;
+    const char *description;
+    int holes_per_player;
+    int initial_seeds;
+    int winning_score;              /* more than this wins */
+} awale_variant_info_t;
+
 /* Game state structure */
 typedef struct {
     int holes[TOTAL_HOLES];    /* holes[0-5] = player 0, holes[6-11] = player 1 */
@@ -24,12 +47,19 @@ typedef struct {
     int current_player;        /* 0 or 1 */
     int game_over;             /* 1 if game is finished */
     int winner;                /* -1 = draw, 0 or 1 = winner */
+    int variant;               /* awale_variant_t, fixed for the game */
 } awale_game_t;
 
 /* Game lifecycle */
 awale_game_t* awale_create(void);
+void awale_init(awale_game_t *game);
 void awale_free(awale_game_t *game);
 void awale_reset(awale_game_t *game);
+void awale_reset_variant(awale_game_t *game, int variant);
+
+/* Rule variants */
+const awale_variant_info_t *awale_variant_info(int variant);
+int awale_variant_by_name(const char *name);
 
 /* Game operations */
 void awale_switch_player(awale_game_t *game);
@@ -40,6 +70,16 @@ int awale_is_valid_move(const awale_game_t *game, int hole);
 int awale_is_game_over(const awale_game_t *game);
 int awale_get_winner(const awale_game_t *game);
 int awale_get_score(const awale_game_t *game, int player);
+uint64_t awale_hash(const awale_game_t *game);
+uint64_t awale_perft(const awale_game_t *game, int depth);
+
+/* Dense position index: seeds per hole plus side to move, one partition per
+ * seed total on the board. Positions with n seeds use indices 0..awale_rank_size(n)-1,
+ * side 0 to move first. Scores are not part of the index. */
+#define AWALE_RANK_MAX_SEEDS (TOTAL_HOLES * INITIAL_SEEDS)
+uint64_t awale_rank_size(int seeds);
+uint64_t awale_rank(const awale_game_t *game);
+int awale_unrank(uint64_t index, int seeds, awale_game_t *game);
 
 /* Display and persistence */
 void awale_print(const awale_game_t *game, const char *player0_name, const char *player1_name);
@@ -0,0 +1,495 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "awale_batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AWALE_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+/* Random playouts over many boards at once. Each step picks a uniformly random
+ * non-empty hole on every unfinished board and applies exactly the rules of
+ * awale_play_move (sowing, captures, winning score, starvation collect).
+ * Sowing is computed arithmetically: with s = 11q + r seeds, every other hole
+ * gets q seeds and the r holes following the origin get one more. */
+
+/* int16 state arrays per lane, followed by the uint32 rng array */
+#define BATCH_ARRAYS (TOTAL_HOLES + 2 + 5)
+
+static uint32_t batch_rng_next(uint32_t x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+// Allocate a batch of `lanes` games (rounded up to a whole group), all reset.
+awale_batch_t* awale_batch_create(int lanes, uint32_t seed)
+{
+    if (lanes <= 0) return NULL;
+    lanes = (lanes + AWALE_BATCH_GROUP - 1) / AWALE_BATCH_GROUP * AWALE_BATCH_GROUP;
+
+    awale_batch_t *batch = (awale_batch_t*)calloc(1, sizeof(awale_batch_t));
+    if (!batch) return NULL;
+    if (posix_memalign(&batch->mem, 32, (size_t)lanes * (BATCH_ARRAYS * sizeof(int16_t) + sizeof(uint32_t))) != 0) {
+        free(batch);
+        return NULL;
+    }
+
+    int16_t *p = (int16_t*)batch->mem;
+    batch->lanes = lanes;
+    for (int h = 0; h < TOTAL_HOLES; h++, p += lanes) batch->holes[h] = p;
+    batch->scores[0] = p; p += lanes;
+    batch->scores[1] = p; p += lanes;
+    batch->current_player = p; p += lanes;
+    batch->game_over = p; p += lanes;
+    batch->winner = p; p += lanes;
+    batch->last_move = p; p += lanes;
+    batch->plies = p; p += lanes;
+    batch->rng = (uint32_t*)p;
+
+    uint32_t x = seed ? seed : 0x9E3779B9u;
+    for (int i = 0; i < lanes; i++) {
+        x = batch_rng_next(x + 0x9E3779B9u);
+        batch->rng[i] = x ? x : 1;
+    }
+    awale_game_t initial;
+    awale_reset(&initial);
+    awale_batch_load(batch, &initial);
+    batch->use_simd = awale_batch_simd_available();
+    return batch;
+}
+
+void awale_batch_free(awale_batch_t *batch)
+{
+    if (batch) {
+        free(batch->mem);
+        free(batch);
+    }
+}
+
+// Copy `game` into every lane.
+void awale_batch_load(awale_batch_t *batch, const awale_game_t *game)
+{
+    for (int i = 0; i < batch->lanes; i++) {
+        for (int h = 0; h < TOTAL_HOLES; h++) batch->holes[h][i] = game->holes[h];
+        batch->scores[0][i] = game->scores[0];
+        batch->scores[1][i] = game->scores[1];
+        batch->current_player[i] = game->current_player;
+        batch->game_over[i] = game->game_over;
+        batch->winner[i] = game->winner;
+        batch->last_move[i] = -1;
+        batch->plies[i] = 0;
+    }
+}
+
+static void batch_load_lane(awale_batch_t *batch, int i, const awale_game_t *game)
+{
+    for (int h = 0; h < TOTAL_HOLES; h++) batch->holes[h][i] = game->holes[h];
+    batch->scores[0][i] = game->scores[0];
+    batch->scores[1][i] = game->scores[1];
+    batch->current_player[i] = game->current_player;
+    batch->game_over[i] = game->game_over;
+    batch->winner[i] = game->winner;
+    batch->plies[i] = 0;
+}
+
+// Extract lane `lane` as a regular game state (the kernels play the standard rules).
+void awale_batch_get(const awale_batch_t *batch, int lane, awale_game_t *game)
+{
+    game->variant = AWALE_VARIANT_STANDARD;
+    for (int h = 0; h < TOTAL_HOLES; h++) game->holes[h] = batch->holes[h][lane];
+    game->scores[0] = batch->scores[0][lane];
+    game->scores[1] = batch->scores[1][lane];
+    game->current_player = batch->current_player[lane];
+    game->game_over = batch->game_over[lane];
+    game->winner = batch->winner[lane];
+}
+
+int awale_batch_simd_available(void)
+{
+#ifdef AWALE_BATCH_X86
+    return __builtin_cpu_supports("avx2") ? 1 : 0;
+#else
+    return 0;
+#endif
+}
+
+// Select the kernel; returns the kernel actually in use.
+int awale_batch_set_simd(awale_batch_t *batch, int enable)
+{
+    batch->use_simd = enable && awale_batch_simd_available();
+    return batch->use_simd;
+}
+
+// Scalar kernel: one random move on lane `i`. Returns 1 if a move was played.
+static int batch_step_lane(awale_batch_t *b, int i)
+{
+    int h[TOTAL_HOLES];
+    if (b->game_over[i]) {
+        b->last_move[i] = -1;
+        return 0;
+    }
+
+    int player = b->current_player[i];
+    int base = player * HOLES_PER_PLAYER;
+    uint32_t x = batch_rng_next(b->rng[i]);
+    int k = (int)((((x >> 8) * 6u) >> 24));
+
+    int move = -1;
+    for (int t = 0; t < HOLES_PER_PLAYER; t++) {
+        int hole = base + (k + t) % HOLES_PER_PLAYER;
+        if (b->holes[hole][i] > 0) { move = hole; break; }
+    }
+    if (move < 0) {
+        b->last_move[i] = -1;
+        return 0;
+    }
+    b->rng[i] = x;
+
+    for (int j = 0; j < TOTAL_HOLES; j++) h[j] = b->holes[j][i];
+    int seeds = h[move];
+    int q = (seeds * 373) >> 12;        /* seeds / 11 for seeds <= 48 */
+    int r = seeds - q * 11;
+    for (int j = 0; j < TOTAL_HOLES; j++) {
+        int d = j - move;
+        if (d < 0) d += TOTAL_HOLES;
+        if (d == 0) h[j] = 0;
+        else h[j] += q + (d <= r);
+    }
+    int last = move + (r == 0 ? 11 : r);
+    if (last >= TOTAL_HOLES) last -= TOTAL_HOLES;
+
+    int opponent = 1 - player;
+    int captured = 0;
+    if (last / HOLES_PER_PLAYER == opponent) {
+        int stop = opponent * HOLES_PER_PLAYER;
+        for (int j = last; j >= stop && (h[j] == 2 || h[j] == 3); j--) {
+            captured += h[j];
+            h[j] = 0;
+        }
+    }
+    int s0 = b->scores[0][i] + (player == 0 ? captured : 0);
+    int s1 = b->scores[1][i] + (player == 1 ? captured : 0);
+    int over = 0, winner = b->winner[i];
+
+    if (s0 > WINNING_SCORE || s1 > WINNING_SCORE) {
+        over = 1;
+        winner = (s0 > s1) ? 0 : 1;
+    } else {
+        int row0 = 0, row1 = 0;
+        for (int j = 0; j < HOLES_PER_PLAYER; j++) {
+            row0 += h[j];
+            row1 += h[j + HOLES_PER_PLAYER];
+        }
+        if (row0 == 0 || row1 == 0) {
+            s0 += row0;
+            s1 += row1;
+            for (int j = 0; j < TOTAL_HOLES; j++) h[j] = 0;
+            over = 1;
+            winner = (s0 > s1) ? 0 : (s1 > s0) ? 1 : -1;
+        }
+    }
+
+    for (int j = 0; j < TOTAL_HOLES; j++) b->holes[j][i] = h[j];
+    b->scores[0][i] = s0;
+    b->scores[1][i] = s1;
+    b->current_player[i] = opponent;
+    b->game_over[i] = over;
+    b->winner[i] = winner;
+    b->last_move[i] = move;
+    return 1;
+}
+
+#ifdef AWALE_BATCH_X86
+// AVX2 kernel: the scalar algorithm on 16 lanes at a time, branch-free.
+// Finished lanes are masked out by blending their old state back in.
+// With `restart`, lanes that end (or hit `max_plies`) are reloaded in-register.
+__attribute__((target("avx2")))
+static int batch_step_avx2(awale_batch_t *b, const awale_game_t *restart, int max_plies,
+                           awale_batch_stats_t *stats)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i two = _mm256_set1_epi16(2);
+    const __m256i three = _mm256_set1_epi16(3);
+    const __m256i five = _mm256_set1_epi16(5);
+    const __m256i six = _mm256_set1_epi16(HOLES_PER_PLAYER);
+    const __m256i twelve = _mm256_set1_epi16(TOTAL_HOLES);
+    const __m256i win_score = _mm256_set1_epi16(WINNING_SCORE);
+    /* 1 << (15 - k) for k = 0..7, looked up with a byte shuffle */
+    const __m256i pow_table = _mm256_setr_epi16(1 << 15, 1 << 14, 1 << 13, 1 << 12, 1 << 11, 1 << 10, 1 << 9, 1 << 8,
+                                                1 << 15, 1 << 14, 1 << 13, 1 << 12, 1 << 11, 1 << 10, 1 << 9, 1 << 8);
+    int played = 0;
+    __m256i start_holes[TOTAL_HOLES];
+    if (restart) {
+        for (int j = 0; j < TOTAL_HOLES; j++) start_holes[j] = _mm256_set1_epi16((short)restart->holes[j]);
+    }
+
+    for (int i = 0; i < b->lanes; i += AWALE_BATCH_GROUP) {
+        __m256i h[TOTAL_HOLES];
+        for (int j = 0; j < TOTAL_HOLES; j++) h[j] = _mm256_load_si256((const __m256i*)&b->holes[j][i]);
+        __m256i cur = _mm256_load_si256((const __m256i*)&b->current_player[i]);
+        __m256i over = _mm256_load_si256((const __m256i*)&b->game_over[i]);
+        __m256i winner = _mm256_load_si256((const __m256i*)&b->winner[i]);
+        __m256i s0 = _mm256_load_si256((const __m256i*)&b->scores[0][i]);
+        __m256i s1 = _mm256_load_si256((const __m256i*)&b->scores[1][i]);
+        __m256i plies = _mm256_load_si256((const __m256i*)&b->plies[i]);
+
+        __m256i is_p1 = _mm256_cmpeq_epi16(cur, one);
+        __m256i active = _mm256_cmpeq_epi16(over, zero);
+
+        /* Mover's row and bitmask of its non-empty holes */
+        __m256i row[HOLES_PER_PLAYER];
+        __m256i bits = zero;
+        for (int t = 0; t < HOLES_PER_PLAYER; t++) {
+            row[t] = _mm256_blendv_epi8(h[t], h[t + HOLES_PER_PLAYER], is_p1);
+            __m256i nonempty = _mm256_cmpgt_epi16(row[t], zero);
+            bits = _mm256_or_si256(bits, _mm256_and_si256(nonempty, _mm256_set1_epi16(1 << t)));
+        }
+        active = _mm256_and_si256(active, _mm256_cmpgt_epi16(bits, zero));
+        unsigned active_bytes = (unsigned)_mm256_movemask_epi8(active);
+        if (active_bytes == 0 && !restart) {
+            _mm256_store_si256((__m256i*)&b->last_move[i], _mm256_set1_epi16(-1));
+            continue;
+        }
+        played += __builtin_popcount(active_bytes) / 2;
+
+        /* Advance both xorshift32 halves; their high words become the 16-bit draws */
+        __m256i x0 = _mm256_load_si256((const __m256i*)&b->rng[i]);
+        __m256i x1 = _mm256_load_si256((const __m256i*)&b->rng[i + 8]);
+        x0 = _mm256_xor_si256(x0, _mm256_slli_epi32(x0, 13));
+        x1 = _mm256_xor_si256(x1, _mm256_slli_epi32(x1, 13));
+        x0 = _mm256_xor_si256(x0, _mm256_srli_epi32(x0, 17));
+        x1 = _mm256_xor_si256(x1, _mm256_srli_epi32(x1, 17));
+        x0 = _mm256_xor_si256(x0, _mm256_slli_epi32(x0, 5));
+        x1 = _mm256_xor_si256(x1, _mm256_slli_epi32(x1, 5));
+        _mm256_store_si256((__m256i*)&b->rng[i], x0);
+        _mm256_store_si256((__m256i*)&b->rng[i + 8], x1);
+        __m256i draw = _mm256_packus_epi32(_mm256_srli_epi32(x0, 16), _mm256_srli_epi32(x1, 16));
+
+        /* Random start k in 0..5, then the first non-empty hole from k on (cyclically):
+         * rotate the doubled mask right by k as a high multiply by 2^(16 - k) */
+        __m256i k = _mm256_mulhi_epu16(draw, six);
+        __m256i pow_index = _mm256_add_epi16(_mm256_mullo_epi16(k, _mm256_set1_epi16(0x0202)), _mm256_set1_epi16(0x0100));
+        __m256i pow = _mm256_shuffle_epi8(pow_table, pow_index);
+        __m256i doubled = _mm256_or_si256(bits, _mm256_slli_epi16(bits, HOLES_PER_PLAYER));
+        __m256i rotated = _mm256_mulhi_epu16(_mm256_slli_epi16(doubled, 1), pow);
+        __m256i lowest = _mm256_and_si256(rotated, _mm256_sub_epi16(zero, rotated));
+        __m256i t = zero;
+        for (int u = 1; u < HOLES_PER_PLAYER; u++) {
+            t = _mm256_sub_epi16(t, _mm256_cmpgt_epi16(lowest, _mm256_set1_epi16((1 << u) - 1)));
+        }
+        __m256i rel = _mm256_add_epi16(k, t);
+        rel = _mm256_sub_epi16(rel, _mm256_and_si256(_mm256_cmpgt_epi16(rel, five), six));
+        __m256i move = _mm256_add_epi16(rel, _mm256_and_si256(is_p1, six));
+
+        /* Seeds in the chosen hole */
+        __m256i seeds = zero;
+        for (int u = 0; u < HOLES_PER_PLAYER; u++) {
+            seeds = _mm256_or_si256(seeds, _mm256_and_si256(_mm256_cmpeq_epi16(rel, _mm256_set1_epi16(u)), row[u]));
+        }
+        __m256i q = _mm256_srli_epi16(_mm256_mullo_epi16(seeds, _mm256_set1_epi16(373)), 12);
+        __m256i r = _mm256_sub_epi16(seeds, _mm256_mullo_epi16(q, _mm256_set1_epi16(11)));
+        __m256i last = _mm256_add_epi16(move, _mm256_blendv_epi8(r, _mm256_set1_epi16(11), _mm256_cmpeq_epi16(r, zero)));
+        last = _mm256_sub_epi16(last, _mm256_and_si256(_mm256_cmpgt_epi16(last, _mm256_set1_epi16(11)), twelve));
+
+        /* Sow (hole at distance d = 1..11 gets q, plus one if d <= r; the origin is emptied)
+         * fused with the capture chain, which walks down from the last hole while it
+         * holds 2 or 3, staying in the opponent's row */
+        __m256i opp_is_p1 = _mm256_cmpeq_epi16(cur, zero);
+        __m256i chain = zero;
+        __m256i captured = zero;
+        __m256i row0 = zero, row1 = zero;
+        __m256i nh[TOTAL_HOLES];
+        for (int j = TOTAL_HOLES - 1; j >= 0; j--) {
+            __m256i d = _mm256_sub_epi16(_mm256_set1_epi16(j), move);
+            d = _mm256_add_epi16(d, _mm256_and_si256(_mm256_cmpgt_epi16(zero, d), twelve));
+            __m256i extra = _mm256_andnot_si256(_mm256_cmpgt_epi16(d, r), one);
+            __m256i v = _mm256_add_epi16(h[j], _mm256_add_epi16(q, extra));
+            v = _mm256_andnot_si256(_mm256_cmpeq_epi16(d, zero), v);
+
+            if (j == HOLES_PER_PLAYER - 1) chain = zero;
+            __m256i in_opp = (j >= HOLES_PER_PLAYER) ? opp_is_p1 : is_p1;
+            __m256i capturable = _mm256_or_si256(_mm256_cmpeq_epi16(v, two), _mm256_cmpeq_epi16(v, three));
+            chain = _mm256_or_si256(chain, _mm256_cmpeq_epi16(last, _mm256_set1_epi16(j)));
+            chain = _mm256_and_si256(chain, _mm256_and_si256(in_opp, capturable));
+            captured = _mm256_add_epi16(captured, _mm256_and_si256(chain, v));
+            nh[j] = _mm256_andnot_si256(chain, v);
+            if (j >= HOLES_PER_PLAYER) row1 = _mm256_add_epi16(row1, nh[j]);
+            else row0 = _mm256_add_epi16(row0, nh[j]);
+        }
+        __m256i ns0 = _mm256_add_epi16(s0, _mm256_andnot_si256(is_p1, captured));
+        __m256i ns1 = _mm256_add_epi16(s1, _mm256_and_si256(is_p1, captured));
+
+        /* Winning score */
+        __m256i won = _mm256_or_si256(_mm256_cmpgt_epi16(ns0, win_score), _mm256_cmpgt_epi16(ns1, win_score));
+        __m256i won_winner = _mm256_andnot_si256(_mm256_cmpgt_epi16(ns0, ns1), one);
+
+        /* Starvation: a side without seeds ends the game, each side collects its row */
+        __m256i starved = _mm256_andnot_si256(won, _mm256_or_si256(_mm256_cmpeq_epi16(row0, zero),
+                                                                   _mm256_cmpeq_epi16(row1, zero)));
+        ns0 = _mm256_add_epi16(ns0, _mm256_and_si256(starved, row0));
+        ns1 = _mm256_add_epi16(ns1, _mm256_and_si256(starved, row1));
+        /* (ns1 > ns0) -> 2 - 1 = 1, (ns0 > ns1) -> 0 - 0 = 0, draw -> 0 - 1 = -1 */
+        __m256i starved_winner = _mm256_sub_epi16(_mm256_and_si256(_mm256_cmpgt_epi16(ns1, ns0), two),
+                                                  _mm256_andnot_si256(_mm256_cmpgt_epi16(ns0, ns1), one));
+
+        __m256i new_winner = _mm256_blendv_epi8(winner, won_winner, won);
+        new_winner = _mm256_blendv_epi8(new_winner, starved_winner, starved);
+        __m256i ended = _mm256_or_si256(won, starved);
+
+        for (int j = 0; j < TOTAL_HOLES; j++) {
+            h[j] = _mm256_blendv_epi8(h[j], _mm256_andnot_si256(starved, nh[j]), active);
+        }
+        s0 = _mm256_blendv_epi8(s0, ns0, active);
+        s1 = _mm256_blendv_epi8(s1, ns1, active);
+        cur = _mm256_blendv_epi8(cur, _mm256_sub_epi16(one, cur), active);
+        over = _mm256_blendv_epi8(over, _mm256_and_si256(ended, one), active);
+        winner = _mm256_blendv_epi8(winner, new_winner, active);
+        plies = _mm256_sub_epi16(plies, active);
+
+        if (restart) {
+            /* Count finished games, then reload every lane that is done or stuck */
+            __m256i reload = _mm256_or_si256(_mm256_cmpgt_epi16(over, zero),
+                                             _mm256_cmpgt_epi16(plies, _mm256_set1_epi16((short)(max_plies - 1))));
+            reload = _mm256_or_si256(reload, _mm256_cmpeq_epi16(active, zero));
+            unsigned reload_bytes = (unsigned)_mm256_movemask_epi8(reload);
+            if (reload_bytes) {
+                unsigned finished = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(active, ended));
+                unsigned won0 = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi16(winner, zero));
+                unsigned won1 = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi16(winner, one));
+                stats->games += __builtin_popcount(finished) / 2;
+                stats->wins[0] += __builtin_popcount(finished & won0) / 2;
+                stats->wins[1] += __builtin_popcount(finished & won1) / 2;
+                stats->truncated += __builtin_popcount(reload_bytes & ~finished & active_bytes) / 2;
+                for (int j = 0; j < TOTAL_HOLES; j++) h[j] = _mm256_blendv_epi8(h[j], start_holes[j], reload);
+                s0 = _mm256_blendv_epi8(s0, _mm256_set1_epi16((short)restart->scores[0]), reload);
+                s1 = _mm256_blendv_epi8(s1, _mm256_set1_epi16((short)restart->scores[1]), reload);
+                cur = _mm256_blendv_epi8(cur, _mm256_set1_epi16((short)restart->current_player), reload);
+                over = _mm256_blendv_epi8(over, _mm256_set1_epi16((short)restart->game_over), reload);
+                winner = _mm256_blendv_epi8(winner, _mm256_set1_epi16((short)restart->winner), reload);
+                plies = _mm256_andnot_si256(reload, plies);
+            }
+        }
+
+        for (int j = 0; j < TOTAL_HOLES; j++) _mm256_store_si256((__m256i*)&b->holes[j][i], h[j]);
+        _mm256_store_si256((__m256i*)&b->scores[0][i], s0);
+        _mm256_store_si256((__m256i*)&b->scores[1][i], s1);
+        _mm256_store_si256((__m256i*)&b->current_player[i], cur);
+        _mm256_store_si256((__m256i*)&b->game_over[i], over);
+        _mm256_store_si256((__m256i*)&b->winner[i], winner);
+        _mm256_store_si256((__m256i*)&b->plies[i], plies);
+        _mm256_store_si256((__m256i*)&b->last_move[i], _mm256_blendv_epi8(_mm256_set1_epi16(-1), move, active));
+    }
+    return played;
+}
+#endif
+
+// Play one random legal move on every unfinished lane. Returns the number of moves played.
+int awale_batch_step(awale_batch_t *batch)
+{
+#ifdef AWALE_BATCH_X86
+    if (batch->use_simd) return batch_step_avx2(batch, NULL, 0, NULL);
+#endif
+    int played = 0;
+    for (int i = 0; i < batch->lanes; i++) {
+        int moved = batch_step_lane(batch, i);
+        batch->plies[i] += moved;
+        played += moved;
+    }
+    return played;
+}
+
+// Step until every lane is finished or `max_plies` steps were made.
+// Returns the total number of moves played.
+long long awale_batch_playout(awale_batch_t *batch, int max_plies)
+{
+    long long total = 0;
+    for (int ply = 0; ply < max_plies; ply++) {
+        int played = awale_batch_step(batch);
+        if (played == 0) break;
+        total += played;
+    }
+    return total;
+}
+
+// Continuous self-play: run `steps` lockstep steps, restarting every lane from
+// `start` as soon as its game ends or reaches `max_plies`, so no lane sits idle.
+// Moves and results are added to `stats`.
+void awale_batch_run(awale_batch_t *batch, const awale_game_t *start, int steps, int max_plies,
+                     awale_batch_stats_t *stats)
+{
+    if (max_plies < 1) max_plies = 1;
+    if (max_plies > INT16_MAX) max_plies = INT16_MAX;
+    for (int step = 0; step < steps; step++) {
+#ifdef AWALE_BATCH_X86
+        if (batch->use_simd) {
+            stats->moves += batch_step_avx2(batch, start, max_plies, stats);
+            continue;
+        }
+#endif
+        for (int i = 0; i < batch->lanes; i++) {
+            int moved = batch_step_lane(batch, i);
+            int ended = moved && batch->game_over[i];
+            stats->moves += moved;
+            batch->plies[i] += moved;
+            if (ended) {
+                stats->games++;
+                if (batch->winner[i] >= 0) stats->wins[batch->winner[i]]++;
+            } else if (moved && batch->plies[i] >= max_plies) {
+                stats->truncated++;
+            }
+            if (batch->game_over[i] || !moved || batch->plies[i] >= max_plies) {
+                batch_load_lane(batch, i, start);
+            }
+        }
+    }
+    stats->draws = stats->games - stats->wins[0] - stats->wins[1];
+}
+
+static int batch_lane_differs(const awale_batch_t *batch, int lane, const awale_game_t *ref)
+{
+    awale_game_t g;
+    awale_batch_get(batch, lane, &g);
+    return memcmp(g.holes, ref->holes, sizeof(g.holes)) != 0 ||
+           g.scores[0] != ref->scores[0] || g.scores[1] != ref->scores[1] ||
+           g.current_player != ref->current_player || g.game_over != ref->game_over ||
+           (g.game_over && g.winner != ref->winner);
+}
+
+// Replay every lane's moves through awale_play_move and compare the states,
+// for the scalar kernel and (when available) the AVX2 kernel.
+long long awale_batch_verify(int lanes, int plies, uint32_t seed)
+{
+    long long mismatches = 0;
+    int kernels = awale_batch_simd_available() ? 2 : 1;
+    awale_game_t *refs = (awale_game_t*)malloc((size_t)(lanes + AWALE_BATCH_GROUP) * sizeof(awale_game_t));
+    if (!refs) return -1;
+
+    for (int simd = 0; simd < kernels; simd++) {
+        awale_batch_t *batch = awale_batch_create(lanes, seed);
+        if (!batch) {
+            free(refs);
+            return -1;
+        }
+        awale_batch_set_simd(batch, simd);
+        for (int i = 0; i < batch->lanes; i++) awale_batch_get(batch, i, &refs[i]);
+
+        for (int ply = 0; ply < plies; ply++) {
+            if (awale_batch_step(batch) == 0) break;
+            for (int i = 0; i < batch->lanes; i++) {
+                int move = batch->last_move[i];
+                if (move >= 0 && awale_play_move(&refs[i], move) != AWALE_OK) mismatches++;
+                else if (batch_lane_differs(batch, i, &refs[i])) mismatches++;
+            }
+        }
+        awale_batch_free(batch);
+    }
+    free(refs);
+    return mismatches;
+}
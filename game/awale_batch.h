@@ -0,0 +1,53 @@
+#ifndef AWALE_BATCH_H
+#define AWALE_BATCH_H
+
+#include <stdint.h>
+#include "awale.h"
+
+/* Lanes are processed in groups of this size; batch sizes are rounded up */
+#define AWALE_BATCH_GROUP 16
+
+/* Structure-of-arrays batch of independent games, stepped in lockstep.
+ * holes[h][lane] holds the seeds of hole h for every game of the batch; state
+ * is 16-bit so one AVX2 vector covers a whole group. */
+typedef struct {
+    int lanes;
+    int16_t *holes[TOTAL_HOLES];
+    int16_t *scores[2];
+    int16_t *current_player;
+    int16_t *game_over;
+    int16_t *winner;
+    int16_t *last_move;        /* hole played by the last step, -1 for finished lanes */
+    int16_t *plies;            /* moves played since the lane was (re)started */
+    uint32_t *rng;             /* per-lane xorshift32 state */
+    int use_simd;              /* 1 = AVX2 kernel, 0 = scalar kernel */
+    void *mem;
+} awale_batch_t;
+
+/* Totals of a continuous run (awale_batch_run) */
+typedef struct {
+    long long moves;
+    long long games;           /* games that reached game over */
+    long long wins[2];
+    long long draws;
+    long long truncated;       /* restarted at the ply cap without a result */
+} awale_batch_stats_t;
+
+/* Batch lifecycle */
+awale_batch_t* awale_batch_create(int lanes, uint32_t seed);
+void awale_batch_free(awale_batch_t *batch);
+void awale_batch_load(awale_batch_t *batch, const awale_game_t *game);
+void awale_batch_get(const awale_batch_t *batch, int lane, awale_game_t *game);
+
+/* Kernels */
+int awale_batch_simd_available(void);
+int awale_batch_set_simd(awale_batch_t *batch, int enable);
+int awale_batch_step(awale_batch_t *batch);
+long long awale_batch_playout(awale_batch_t *batch, int max_plies);
+void awale_batch_run(awale_batch_t *batch, const awale_game_t *start, int steps, int max_plies,
+                     awale_batch_stats_t *stats);
+
+/* Cross-check both kernels against awale_play_move; returns the number of mismatches */
+long long awale_batch_verify(int lanes, int plies, uint32_t seed);
+
+#endif /* AWALE_BATCH_H */
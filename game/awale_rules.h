@@ -0,0 +1,191 @@
+/* Rule kernel template, included by awale.c once per variant:
+ *
+ *   #define VARIANT  abapa              suffix of the generated functions
+ *   #define V_HOLES  6                  holes per player
+ *   #define V_WIN    24                 a player with more seeds than this wins
+ *   #define V_FEED   1                  a move must give seeds to an empty opponent if one can
+ *   #define V_SLAM   SLAM_NO_CAPTURE    grand slams: SLAM_CAPTURE, SLAM_NO_CAPTURE or SLAM_FORBIDDEN
+ *   #include "awale_rules.h"
+ *
+ * The parameters are constants, so every copy compiles to straight-line code
+ * for its own ruleset: no rule is tested at run time. Holes 0..V_HOLES-1 belong
+ * to player 0, the next V_HOLES to player 1; the rest of the board stays empty.
+ * The parameters are undefined at the end, ready for the next variant. */
+
+#define V_TOTAL (2 * V_HOLES)
+#define V_PASTE2(name, variant) name##_##variant
+#define V_PASTE(name, variant) V_PASTE2(name, variant)
+#define V_FN(name) V_PASTE(name, VARIANT)
+
+/* Sow the seeds of `hole` counterclockwise, skipping it; returns the last hole */
+static inline int V_FN(sow)(int *holes, int hole)
+{
+    int seeds = holes[hole];
+    holes[hole] = 0;
+    int current = hole;
+    while (seeds > 0) {
+        current = (current + 1) % V_TOTAL;
+        if (current != hole) {
+            holes[current]++;
+            seeds--;
+        }
+    }
+    return current;
+}
+
+/* Take the 2s and 3s backwards from `current` while it is on the opponent's row */
+static inline void V_FN(capture)(awale_game_t *game, int player, int current)
+{
+    int opp_start = (1 - player) * V_HOLES;
+    while (current >= opp_start && current < opp_start + V_HOLES &&
+           (game->holes[current] == 2 || game->holes[current] == 3)) {
+        game->scores[player] += game->holes[current];
+        game->holes[current] = 0;
+        current = (current - 1 + V_TOTAL) % V_TOTAL;
+    }
+}
+
+static inline int V_FN(row_empty)(const awale_game_t *game, int player)
+{
+    for (int i = player * V_HOLES; i < (player + 1) * V_HOLES; i++) {
+        if (game->holes[i] > 0) return 0;
+    }
+    return 1;
+}
+
+#if V_FEED
+/* Whether sowing `hole` reaches the opponent's row */
+static inline int V_FN(feeds)(const awale_game_t *game, int hole)
+{
+    return game->holes[hole] >= V_HOLES - hole % V_HOLES;
+}
+
+static inline int V_FN(can_feed)(const awale_game_t *game)
+{
+    int start = game->current_player * V_HOLES;
+    for (int hole = start; hole < start + V_HOLES; hole++) {
+        if (V_FN(feeds)(game, hole)) return 1;
+    }
+    return 0;
+}
+#endif
+
+#if V_SLAM != SLAM_CAPTURE
+/* Whether playing `hole` would capture every seed on the opponent's row */
+static int V_FN(is_grand_slam)(const awale_game_t *game, int hole)
+{
+    int holes[V_TOTAL];
+    memcpy(holes, game->holes, sizeof(holes));
+    int last = V_FN(sow)(holes, hole);
+    int opp_start = (1 - game->current_player) * V_HOLES;
+    if (last < opp_start || last >= opp_start + V_HOLES) return 0;
+    for (int i = opp_start; i <= last; i++) {
+        if (holes[i] != 2 && holes[i] != 3) return 0;
+    }
+    for (int i = last + 1; i < opp_start + V_HOLES; i++) {
+        if (holes[i] != 0) return 0;
+    }
+    return 1;
+}
+#endif
+
+/* Legality of a move, before the grand slam rule */
+static inline awale_status_t V_FN(check_basic)(const awale_game_t *game, int hole)
+{
+    if (game->game_over) return AWALE_GAME_OVER;
+    if (hole < 0 || hole >= V_TOTAL) return AWALE_INVALID_HOLE;
+    int start = game->current_player * V_HOLES;
+    if (hole < start || hole >= start + V_HOLES) return AWALE_INVALID_MOVE;
+    if (game->holes[hole] == 0) return AWALE_EMPTY_HOLE;
+#if V_FEED
+    if (!V_FN(feeds)(game, hole) && V_FN(row_empty)(game, 1 - game->current_player)) {
+        return AWALE_STARVATION_RULE;
+    }
+#endif
+    return AWALE_OK;
+}
+
+static inline awale_status_t V_FN(check_move)(const awale_game_t *game, int hole)
+{
+    awale_status_t status = V_FN(check_basic)(game, hole);
+#if V_SLAM == SLAM_FORBIDDEN
+    /* A grand slam is only allowed when every other move is one too */
+    if (status == AWALE_OK && V_FN(is_grand_slam)(game, hole)) {
+        int start = game->current_player * V_HOLES;
+        for (int other = start; other < start + V_HOLES; other++) {
+            if (other != hole && V_FN(check_basic)(game, other) == AWALE_OK &&
+                !V_FN(is_grand_slam)(game, other)) {
+                return AWALE_GRAND_SLAM_RULE;
+            }
+        }
+    }
+#endif
+    return status;
+}
+
+static int V_FN(is_valid_move)(const awale_game_t *game, int hole)
+{
+    return V_FN(check_move)(game, hole) == AWALE_OK;
+}
+
+static awale_status_t V_FN(play_move)(awale_game_t *game, int hole)
+{
+    awale_status_t status = V_FN(check_move)(game, hole);
+    if (status != AWALE_OK) return status;
+
+    int player = game->current_player;
+#if V_SLAM != SLAM_CAPTURE
+    /* Allowed grand slams capture nothing */
+    int slam = V_FN(is_grand_slam)(game, hole);
+#endif
+    int last = V_FN(sow)(game->holes, hole);
+#if V_SLAM != SLAM_CAPTURE
+    if (!slam)
+#endif
+    V_FN(capture)(game, player, last);
+    game->current_player = 1 - player;
+
+    if (game->scores[0] > V_WIN || game->scores[1] > V_WIN) {
+        game->game_over = 1;
+        game->winner = (game->scores[0] > game->scores[1]) ? 0 : 1;
+        return AWALE_OK;
+    }
+
+#if V_FEED
+    /* Over when the side to move has nothing to play, or cannot feed an empty
+     * opponent; either way every seed left is on one row and goes to its owner */
+    int finished = V_FN(row_empty)(game, 1 - player) ||
+                   (V_FN(row_empty)(game, player) && !V_FN(can_feed)(game));
+#else
+    int finished = V_FN(row_empty)(game, 0) || V_FN(row_empty)(game, 1);
+#endif
+    if (finished) {
+        for (int i = 0; i < V_HOLES; i++) {
+            game->scores[0] += game->holes[i];
+            game->holes[i] = 0;
+        }
+        for (int i = V_HOLES; i < V_TOTAL; i++) {
+            game->scores[1] += game->holes[i];
+            game->holes[i] = 0;
+        }
+        game->game_over = 1;
+        if (game->scores[0] > game->scores[1]) {
+            game->winner = 0;
+        } else if (game->scores[1] > game->scores[0]) {
+            game->winner = 1;
+        } else {
+            game->winner = -1;
+        }
+    }
+    return AWALE_OK;
+}
+
+#undef V_FN
+#undef V_PASTE
+#undef V_PASTE2
+#undef V_TOTAL
+#undef VARIANT
+#undef V_HOLES
+#undef V_WIN
+#undef V_FEED
+#undef V_SLAM
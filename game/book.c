@@ -0,0 +1,270 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "book.h"
+#include "archive.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Opening book.
+ *
+ * The builder replays archived games (the files written by session_save_game)
+ * and emits one entry per (position, move) with the results obtained by the side
+ * that played it. Entries are sorted by Zobrist key, so the book is probed with a
+ * binary search straight in the mapped file. */
+
+#define BOOK_MAX_THREADS 64
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+} book_header_t;
+
+/* Growable list of entries */
+typedef struct {
+    book_entry_t *items;
+    size_t count;
+    size_t capacity;
+} book_list_t;
+
+/* Mapped file */
+static void *book_map = NULL;
+static size_t book_map_size = 0;
+static const book_entry_t *book_entries = NULL;
+static size_t book_count = 0;
+
+static int book_list_push(book_list_t *list, const book_entry_t *entry)
+{
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 1024;
+        book_entry_t *items = (book_entry_t*)realloc(list->items, capacity * sizeof(book_entry_t));
+        if (!items) return -1;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = *entry;
+    return 0;
+}
+
+static int book_entry_compare(const void *a, const void *b)
+{
+    const book_entry_t *x = (const book_entry_t*)a;
+    const book_entry_t *y = (const book_entry_t*)b;
+    if (x->key != y->key) return (x->key < y->key) ? -1 : 1;
+    return (int)x->move - (int)y->move;
+}
+
+// Sort the list and merge entries for the same (key, move).
+static void book_list_merge(book_list_t *list)
+{
+    if (list->count == 0) return;
+    qsort(list->items, list->count, sizeof(book_entry_t), book_entry_compare);
+    size_t out = 0;
+    for (size_t i = 1; i < list->count; i++) {
+        book_entry_t *last = &list->items[out];
+        const book_entry_t *e = &list->items[i];
+        if (e->key == last->key && e->move == last->move) {
+            last->wins += e->wins;
+            last->draws += e->draws;
+            last->losses += e->losses;
+        } else {
+            list->items[++out] = *e;
+        }
+    }
+    list->count = out + 1;
+}
+
+// Archive visitor: record the move with the result of the side that played it.
+static int book_visit(const archive_game_t *info, const awale_game_t *before, int hole, void *ctx)
+{
+    book_entry_t e;
+    memset(&e, 0, sizeof(e));
+    e.key = awale_hash(before);
+    e.move = (uint16_t)hole;
+    if (info->winner == -1) e.draws = 1;
+    else if (info->winner == before->current_player) e.wins = 1;
+    else e.losses = 1;
+    return book_list_push((book_list_t*)ctx, &e);
+}
+
+typedef struct {
+    char **files;
+    int num_files;
+    int *next_file;         /* shared cursor, claimed atomically */
+    int max_plies;
+    int games;
+    book_list_t list;
+} book_worker_t;
+
+static void *book_worker_main(void *arg)
+{
+    book_worker_t *w = (book_worker_t*)arg;
+    for (;;) {
+        int i = __atomic_fetch_add(w->next_file, 1, __ATOMIC_RELAXED);
+        if (i >= w->num_files) break;
+        if (archive_replay(w->files[i], w->max_plies, book_visit, &w->list) > 0) w->games++;
+    }
+    book_list_merge(&w->list);
+    return NULL;
+}
+
+long book_build(const char *dir, const char *path, int max_plies, int threads, int *games_read)
+{
+    if (!dir || !path) return -1;
+    if (max_plies <= 0) max_plies = BOOK_DEFAULT_PLIES;
+    if (threads < 1) threads = 1;
+    if (threads > BOOK_MAX_THREADS) threads = BOOK_MAX_THREADS;
+
+    char **files = NULL;
+    int num_files = archive_list(dir, &files);
+    if (num_files < 0) {
+        perror(dir);
+        return -1;
+    }
+
+    book_worker_t workers[BOOK_MAX_THREADS];
+    pthread_t tids[BOOK_MAX_THREADS];
+    int next_file = 0;
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        memset(&workers[i], 0, sizeof(workers[i]));
+        workers[i].files = files;
+        workers[i].num_files = num_files;
+        workers[i].next_file = &next_file;
+        workers[i].max_plies = max_plies;
+    }
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&tids[i], NULL, book_worker_main, &workers[i]) != 0) break;
+        started++;
+    }
+    book_worker_main(&workers[0]);
+    for (int i = 1; i <= started; i++) pthread_join(tids[i], NULL);
+
+    /* Merge the per-thread books */
+    book_list_t all = { NULL, 0, 0 };
+    int games = 0;
+    long result = 0;
+    for (int i = 0; i <= started; i++) {
+        games += workers[i].games;
+        for (size_t j = 0; j < workers[i].list.count && result == 0; j++) {
+            if (book_list_push(&all, &workers[i].list.items[j]) < 0) result = -1;
+        }
+        free(workers[i].list.items);
+    }
+    archive_free_list(files, num_files);
+    if (games_read) *games_read = games;
+    book_list_merge(&all);
+
+    FILE *f = (result == 0) ? fopen(path, "wb") : NULL;
+    if (!f) {
+        if (result == 0) perror(path);
+        free(all.items);
+        return -1;
+    }
+    book_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BOOK_MAGIC, 4);
+    header.version = BOOK_VERSION;
+    header.count = all.count;
+    if (fwrite(&header, sizeof(header), 1, f) != 1 ||
+        fwrite(all.items, sizeof(book_entry_t), all.count, f) != all.count) {
+        perror(path);
+        result = -1;
+    }
+    if (fclose(f) != 0) result = -1;
+    if (result == 0) result = (long)all.count;
+    free(all.items);
+    return result;
+}
+
+// Map a book file. Returns 0 on success, -1 if it is missing or invalid.
+int book_open(const char *path)
+{
+    book_close();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(book_header_t)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    const book_header_t *header = (const book_header_t*)map;
+    if (memcmp(header->magic, BOOK_MAGIC, 4) != 0 || header->version != BOOK_VERSION ||
+        header->count > ((size_t)st.st_size - sizeof(book_header_t)) / sizeof(book_entry_t)) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+
+    book_map = map;
+    book_map_size = (size_t)st.st_size;
+    book_entries = (const book_entry_t*)((const char*)map + sizeof(book_header_t));
+    book_count = (size_t)header->count;
+    return 0;
+}
+
+void book_close(void)
+{
+    if (book_map) munmap(book_map, book_map_size);
+    book_map = NULL;
+    book_map_size = 0;
+    book_entries = NULL;
+    book_count = 0;
+}
+
+// Number of (position, move) entries in the mapped book.
+size_t book_size(void)
+{
+    return book_count;
+}
+
+// Find the book moves of `game`: points *entries at the first one and returns their count.
+int book_lookup(const awale_game_t *game, const book_entry_t **entries)
+{
+    if (!book_entries || !game || game->game_over) return 0;
+    uint64_t key = awale_hash(game);
+
+    size_t lo = 0, hi = book_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (book_entries[mid].key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t end = lo;
+    while (end < book_count && book_entries[end].key == key) end++;
+    if (entries) *entries = &book_entries[lo];
+    return (int)(end - lo);
+}
+
+// Pick the book move with the best score (a draw counts half) among moves played
+// at least BOOK_MIN_GAMES times. Returns 1 on a hit.
+int book_best_move(const awale_game_t *game, int *move, book_entry_t *stats)
+{
+    const book_entry_t *entries;
+    int n = book_lookup(game, &entries);
+    const book_entry_t *best = NULL;
+    double best_score = -1.0;
+    for (int i = 0; i < n; i++) {
+        const book_entry_t *e = &entries[i];
+        uint32_t games = e->wins + e->draws + e->losses;
+        if (games < BOOK_MIN_GAMES || !awale_is_valid_move(game, e->move)) continue;
+        double score = (e->wins + 0.5 * e->draws) / games;
+        if (score > best_score || (score == best_score && games > best->wins + best->draws + best->losses)) {
+            best = e;
+            best_score = score;
+        }
+    }
+    if (!best) return 0;
+    *move = best->move;
+    if (stats) *stats = *best;
+    return 1;
+}
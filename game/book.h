@@ -0,0 +1,37 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "awale.h"
+
+/* Opening book built from the saved_games archive */
+#define BOOK_DEFAULT_FILE "awale.book"
+#define BOOK_MAGIC "AWBK"
+#define BOOK_VERSION 1
+#define BOOK_DEFAULT_PLIES 24
+#define BOOK_MIN_GAMES 2
+
+/* One (position, move) pair, sorted by key then move in the book file */
+typedef struct {
+    uint64_t key;           /* awale_hash of the position before the move */
+    uint32_t wins;          /* game results for the side that played `move` */
+    uint32_t draws;
+    uint32_t losses;
+    uint16_t move;
+    uint16_t reserved;
+} book_entry_t;
+
+/* Offline build: replay every .awale file in `dir` with `threads` threads,
+ * recording the first `max_plies` moves, and write the book to `path`.
+ * Returns the number of entries written, or -1. */
+long book_build(const char *dir, const char *path, int max_plies, int threads, int *games_read);
+
+/* Lookup: the file is memory-mapped once and shared by every thread */
+int book_open(const char *path);
+void book_close(void);
+size_t book_size(void);
+int book_lookup(const awale_game_t *game, const book_entry_t **entries);
+int book_best_move(const awale_game_t *game, int *move, book_entry_t *stats);
+
+#endif /* BOOK_H */
@@ -0,0 +1,324 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "mcts.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+
+/* UCT search. All threads share one tree (tree parallelism); a thread walking
+ * down adds a virtual loss to every node on its path so the others spread out.
+ * Nodes come from a flat arena: expanding a node reserves its whole child
+ * block with one atomic add, so there is no per-node allocation. */
+
+#define MCTS_VIRTUAL_LOSS 1
+#define MCTS_MAX_PATH 256
+#define MCTS_PLAYOUT_LIMIT 400   /* the rules have no repetition draw */
+
+#define NODE_UNEXPANDED 0
+#define NODE_EXPANDING 1
+#define NODE_EXPANDED 2
+
+/* Results are stored doubled: win = 2, draw = 1, loss = 0 */
+typedef struct {
+    int32_t first_child;        /* arena index of the child block */
+    int8_t num_children;
+    int8_t move;                /* hole played to reach this node */
+    int8_t state;               /* NODE_* expansion state */
+    int8_t pad;
+    int32_t visits;             /* real visits plus in-flight virtual losses */
+    int64_t reward;             /* for the player who played `move` */
+} mcts_node_t;
+
+struct mcts_tree {
+    mcts_node_t *nodes;
+    size_t capacity;
+    size_t used;                /* bumped atomically by expanding threads */
+};
+
+typedef struct {
+    mcts_tree_t *tree;
+    const mcts_config_t *cfg;
+    const awale_game_t *root;
+    volatile int *stop;
+    struct timespec start;
+    uint32_t rng;
+    unsigned long long playouts;
+} mcts_thread_t;
+
+// Allocate a tree able to hold `max_nodes` nodes.
+mcts_tree_t* mcts_create(size_t max_nodes)
+{
+    if (max_nodes < 2) max_nodes = 2;
+    mcts_tree_t *tree = (mcts_tree_t*)malloc(sizeof(mcts_tree_t));
+    if (!tree) return NULL;
+    tree->nodes = (mcts_node_t*)malloc(max_nodes * sizeof(mcts_node_t));
+    if (!tree->nodes) {
+        free(tree);
+        return NULL;
+    }
+    tree->capacity = max_nodes;
+    tree->used = 0;
+    return tree;
+}
+
+void mcts_free(mcts_tree_t *tree)
+{
+    if (tree) {
+        free(tree->nodes);
+        free(tree);
+    }
+}
+
+void mcts_config_default(mcts_config_t *cfg)
+{
+    if (!cfg) return;
+    cfg->threads = 1;
+    cfg->time_ms = 1000;
+    cfg->max_playouts = 0;
+    cfg->exploration = 0.7;
+    cfg->seed = 0x2545F491u;
+    cfg->stop = NULL;
+}
+
+static uint32_t rng_next(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static double elapsed_ms_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static void node_init(mcts_node_t *node, int move)
+{
+    node->first_child = -1;
+    node->num_children = 0;
+    node->move = (int8_t)move;
+    node->state = NODE_UNEXPANDED;
+    node->pad = 0;
+    node->visits = 0;
+    node->reward = 0;
+}
+
+// Create the children of `node` for every legal move in `game`.
+// Only the thread that wins the state transition expands; others just play out.
+static void node_expand(mcts_tree_t *tree, mcts_node_t *node, const awale_game_t *game)
+{
+    int8_t expected = NODE_UNEXPANDED;
+    if (!__atomic_compare_exchange_n(&node->state, &expected, NODE_EXPANDING, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    int moves[HOLES_PER_PLAYER];
+    int n = 0;
+    int start = game->current_player * HOLES_PER_PLAYER;
+    for (int i = start; i < start + HOLES_PER_PLAYER; i++) {
+        if (game->holes[i] > 0) moves[n++] = i;
+    }
+
+    size_t first = __atomic_fetch_add(&tree->used, (size_t)n, __ATOMIC_RELAXED);
+    if (n == 0 || first + n > tree->capacity) {
+        /* Arena exhausted: leave the node as a leaf for good */
+        __atomic_store_n(&node->state, NODE_EXPANDED, __ATOMIC_RELEASE);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        node_init(&tree->nodes[first + i], moves[i]);
+    }
+    node->first_child = (int32_t)first;
+    node->num_children = (int8_t)n;
+    __atomic_store_n(&node->state, NODE_EXPANDED, __ATOMIC_RELEASE);
+}
+
+// Pick the child maximizing UCB1, unvisited children first.
+static mcts_node_t *select_child(mcts_tree_t *tree, mcts_node_t *node, double exploration)
+{
+    mcts_node_t *children = &tree->nodes[node->first_child];
+    int parent_visits = __atomic_load_n(&node->visits, __ATOMIC_RELAXED);
+    double log_parent = log((double)(parent_visits > 0 ? parent_visits : 1));
+
+    mcts_node_t *best = &children[0];
+    double best_value = -1.0;
+    for (int i = 0; i < node->num_children; i++) {
+        int visits = __atomic_load_n(&children[i].visits, __ATOMIC_RELAXED);
+        if (visits == 0) return &children[i];
+        int64_t reward = __atomic_load_n(&children[i].reward, __ATOMIC_RELAXED);
+        double value = (double)reward / (2.0 * visits) + exploration * sqrt(log_parent / visits);
+        if (value > best_value) {
+            best_value = value;
+            best = &children[i];
+        }
+    }
+    return best;
+}
+
+// Play uniformly random legal moves until the game ends (or the ply cap is hit).
+// Returns the doubled result for `player`.
+static int playout(awale_game_t *game, int player, uint32_t *rng)
+{
+    for (int ply = 0; !game->game_over && ply < MCTS_PLAYOUT_LIMIT; ply++) {
+        int start = game->current_player * HOLES_PER_PLAYER;
+        int moves[HOLES_PER_PLAYER];
+        int n = 0;
+        for (int i = start; i < start + HOLES_PER_PLAYER; i++) {
+            if (game->holes[i] > 0) moves[n++] = i;
+        }
+        if (n == 0) break;
+        awale_play_move(game, moves[rng_next(rng) % n]);
+    }
+
+    int winner = game->winner;
+    if (!game->game_over) {
+        if (game->scores[0] == game->scores[1]) winner = -1;
+        else winner = (game->scores[0] > game->scores[1]) ? 0 : 1;
+    }
+    if (winner == -1) return 1;
+    return (winner == player) ? 2 : 0;
+}
+
+// One selection / expansion / simulation / backup cycle.
+static void run_iteration(mcts_thread_t *t)
+{
+    mcts_tree_t *tree = t->tree;
+    mcts_node_t *path[MCTS_MAX_PATH];
+    int movers[MCTS_MAX_PATH];
+    int depth = 0;
+
+    awale_game_t game = *t->root;
+    mcts_node_t *node = &tree->nodes[0];
+    __atomic_fetch_add(&node->visits, MCTS_VIRTUAL_LOSS, __ATOMIC_RELAXED);
+    path[depth] = node;
+    movers[depth++] = 1 - game.current_player;
+
+    while (!game.game_over && depth < MCTS_MAX_PATH) {
+        if (__atomic_load_n(&node->state, __ATOMIC_ACQUIRE) != NODE_EXPANDED) {
+            /* Expand on the second visit so one-off leaves do not burn arena space */
+            if (__atomic_load_n(&node->visits, __ATOMIC_RELAXED) <= MCTS_VIRTUAL_LOSS + 1) break;
+            node_expand(tree, node, &game);
+            if (__atomic_load_n(&node->state, __ATOMIC_ACQUIRE) != NODE_EXPANDED) break;
+        }
+        if (node->num_children == 0) break;
+
+        node = select_child(tree, node, t->cfg->exploration);
+        __atomic_fetch_add(&node->visits, MCTS_VIRTUAL_LOSS, __ATOMIC_RELAXED);
+        movers[depth] = game.current_player;
+        path[depth++] = node;
+        awale_play_move(&game, node->move);
+    }
+
+    /* Simulate from the reached position for player 0, then credit each mover */
+    int result0 = playout(&game, 0, &t->rng);
+    for (int i = 0; i < depth; i++) {
+        int reward = (movers[i] == 0) ? result0 : 2 - result0;
+        __atomic_fetch_add(&path[i]->visits, 1 - MCTS_VIRTUAL_LOSS, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&path[i]->reward, (int64_t)reward, __ATOMIC_RELAXED);
+    }
+    t->playouts++;
+}
+
+static int search_should_stop(mcts_thread_t *t)
+{
+    if (__atomic_load_n(t->stop, __ATOMIC_RELAXED)) return 1;
+    if (t->cfg->stop && __atomic_load_n(t->cfg->stop, __ATOMIC_RELAXED)) return 1;
+    if (t->cfg->max_playouts > 0 &&
+        __atomic_load_n(&t->tree->nodes[0].visits, __ATOMIC_RELAXED) >= (long long)t->cfg->max_playouts) return 1;
+    if (t->cfg->time_ms > 0 && elapsed_ms_since(&t->start) >= t->cfg->time_ms) return 1;
+    return 0;
+}
+
+static void *search_thread_main(void *arg)
+{
+    mcts_thread_t *t = (mcts_thread_t*)arg;
+    while (1) {
+        if ((t->playouts & 15) == 0 && search_should_stop(t)) break;
+        run_iteration(t);
+    }
+    __atomic_store_n(t->stop, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+// Run a time/playout-budgeted search from `game`. The tree is rebuilt from scratch.
+// Returns 0 on success, -1 on invalid arguments.
+int mcts_search(mcts_tree_t *tree, const awale_game_t *game, const mcts_config_t *cfg, mcts_result_t *result)
+{
+    if (!tree || !game || !result) return -1;
+
+    mcts_config_t defaults;
+    if (!cfg) {
+        mcts_config_default(&defaults);
+        cfg = &defaults;
+    }
+    memset(result, 0, sizeof(*result));
+    result->best_move = -1;
+    if (game->game_over) return 0;
+    if (cfg->time_ms <= 0 && cfg->max_playouts == 0 && !cfg->stop) return -1;
+
+    int nthreads = cfg->threads;
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > MCTS_MAX_THREADS) nthreads = MCTS_MAX_THREADS;
+
+    tree->used = 1;
+    node_init(&tree->nodes[0], -1);
+
+    volatile int stop = 0;
+    mcts_thread_t threads[MCTS_MAX_THREADS];
+    pthread_t tids[MCTS_MAX_THREADS];
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < nthreads; i++) {
+        threads[i].tree = tree;
+        threads[i].cfg = cfg;
+        threads[i].root = game;
+        threads[i].stop = &stop;
+        threads[i].start = start;
+        threads[i].rng = (cfg->seed ? cfg->seed : 1u) * 2654435761u + (uint32_t)i * 40503u + 1u;
+        threads[i].playouts = 0;
+    }
+
+    int started = 1;
+    for (int i = 1; i < nthreads; i++) {
+        if (pthread_create(&tids[i], NULL, search_thread_main, &threads[i]) != 0) break;
+        started++;
+    }
+    search_thread_main(&threads[0]);
+    for (int i = 1; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    for (int i = 0; i < started; i++) {
+        result->playouts += threads[i].playouts;
+    }
+    result->elapsed_ms = elapsed_ms_since(&start);
+    result->playouts_per_sec = result->elapsed_ms > 0 ? result->playouts * 1000.0 / result->elapsed_ms : 0;
+    result->nodes_used = tree->used < tree->capacity ? tree->used : tree->capacity;
+
+    mcts_node_t *root = &tree->nodes[0];
+    if (root->state == NODE_EXPANDED && root->num_children > 0) {
+        mcts_node_t *best = NULL;
+        for (int i = 0; i < root->num_children; i++) {
+            mcts_node_t *child = &tree->nodes[root->first_child + i];
+            if (!best || child->visits > best->visits) best = child;
+        }
+        result->best_move = best->move;
+        result->expected = best->visits > 0 ? (double)best->reward / (2.0 * best->visits) : 0.5;
+    } else {
+        /* Too few playouts to expand the root: any legal move will do */
+        int first = game->current_player * HOLES_PER_PLAYER;
+        for (int i = first; i < first + HOLES_PER_PLAYER; i++) {
+            if (game->holes[i] > 0) { result->best_move = i; break; }
+        }
+        result->expected = 0.5;
+    }
+    return 0;
+}
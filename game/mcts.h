@@ -0,0 +1,38 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <stddef.h>
+#include "awale.h"
+
+#define MCTS_MAX_THREADS 64
+
+/* Monte Carlo Tree Search configuration */
+typedef struct {
+    int threads;                /* tree-parallel playout threads */
+    int time_ms;                /* wall-clock budget, 0 = playout limit only */
+    unsigned long long max_playouts; /* 0 = time limit only */
+    double exploration;         /* UCT exploration constant */
+    unsigned int seed;          /* random seed for the playouts */
+    volatile int *stop;         /* optional external stop flag */
+} mcts_config_t;
+
+/* Search result */
+typedef struct {
+    int best_move;              /* most visited root move, -1 if none */
+    double expected;            /* expected result for the side to move, 0 = loss .. 1 = win */
+    unsigned long long playouts;
+    double playouts_per_sec;
+    double elapsed_ms;
+    size_t nodes_used;
+} mcts_result_t;
+
+/* Search tree backed by a fixed node arena */
+typedef struct mcts_tree mcts_tree_t;
+
+mcts_tree_t* mcts_create(size_t max_nodes);
+void mcts_free(mcts_tree_t *tree);
+
+void mcts_config_default(mcts_config_t *cfg);
+int mcts_search(mcts_tree_t *tree, const awale_game_t *game, const mcts_config_t *cfg, mcts_result_t *result);
+
+#endif /* MCTS_H */
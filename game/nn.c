@@ -0,0 +1,303 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "nn.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NN_X86 1
+#include <immintrin.h>
+#endif
+
+/* Neural evaluation.
+ *
+ * Inference is integer only: the accumulator holds the first layer in int16
+ * (int8 weights, units of 1/NN_QUANT), its clipped ReLU gives uint8 inputs for
+ * the int8 second layer, and so on. The AVX2 and scalar paths compute exactly
+ * the same values. */
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint16_t inputs;
+    uint16_t l1;
+    uint16_t l2;
+    uint16_t reserved;
+} nn_header_t;
+
+static nn_weights_t *net = NULL;
+/* First layer weights widened to int16, so updates are plain vector adds */
+static int16_t (*w1_wide)[NN_L1] = NULL;
+static int nn_avx2 = 0;
+
+static int simd_available(void)
+{
+#ifdef NN_X86
+    return __builtin_cpu_supports("avx2") ? 1 : 0;
+#else
+    return 0;
+#endif
+}
+
+// Load a network file. Returns 0 on success, -1 if it is missing or invalid.
+int nn_load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    nn_header_t header;
+    nn_weights_t *weights = (nn_weights_t*)malloc(sizeof(nn_weights_t));
+    int ok = weights && fread(&header, sizeof(header), 1, f) == 1 &&
+             memcmp(header.magic, NN_MAGIC, 4) == 0 && header.version == NN_VERSION &&
+             header.inputs == NN_INPUTS && header.l1 == NN_L1 && header.l2 == NN_L2 &&
+             fread(weights, sizeof(nn_weights_t), 1, f) == 1;
+    fclose(f);
+    if (!ok) {
+        free(weights);
+        return -1;
+    }
+
+    void *mem = NULL;
+    if (posix_memalign(&mem, 64, sizeof(int16_t) * NN_INPUTS * NN_L1) != 0) {
+        free(weights);
+        return -1;
+    }
+    int16_t (*wide)[NN_L1] = (int16_t(*)[NN_L1])mem;
+    for (int i = 0; i < NN_INPUTS; i++) {
+        for (int j = 0; j < NN_L1; j++) wide[i][j] = weights->w1[i][j];
+    }
+
+    nn_unload();
+    net = weights;
+    w1_wide = wide;
+    nn_avx2 = simd_available();
+    return 0;
+}
+
+// Write quantized weights in the format nn_load() reads. Returns 0 on success.
+int nn_save(const char *path, const nn_weights_t *weights)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    nn_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, NN_MAGIC, 4);
+    header.version = NN_VERSION;
+    header.inputs = NN_INPUTS;
+    header.l1 = NN_L1;
+    header.l2 = NN_L2;
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(weights, sizeof(*weights), 1, f) == 1;
+    if (fclose(f) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+void nn_unload(void)
+{
+    free(net);
+    free(w1_wide);
+    net = NULL;
+    w1_wide = NULL;
+}
+
+int nn_loaded(void)
+{
+    return net != NULL;
+}
+
+// Force the scalar path (0) or allow AVX2 where supported (1), for benchmarks.
+void nn_use_simd(int enable)
+{
+    nn_avx2 = enable && simd_available();
+}
+
+static inline int feature(int perspective, int hole, int seeds)
+{
+    int rel = hole - perspective * HOLES_PER_PLAYER;
+    if (rel < 0) rel += TOTAL_HOLES;
+    return rel * NN_BUCKETS + (seeds < NN_BUCKETS - 1 ? seeds : NN_BUCKETS - 1);
+}
+
+// Input index of `hole` holding `seeds`, seen by `perspective` (own row first).
+int nn_feature(int perspective, int hole, int seeds)
+{
+    return feature(perspective, hole, seeds);
+}
+
+// dst = src + the first-layer columns of `add` - those of `sub`.
+static void acc_build(int16_t *dst, const int16_t *src, const int *add, int n_add, const int *sub, int n_sub)
+{
+    for (int i = 0; i < NN_L1; i++) {
+        int x = src[i];
+        for (int k = 0; k < n_add; k++) x += w1_wide[add[k]][i];
+        for (int k = 0; k < n_sub; k++) x -= w1_wide[sub[k]][i];
+        dst[i] = (int16_t)x;
+    }
+}
+
+#ifdef NN_X86
+// Same, with the whole layer held in four registers: src and dst are touched once.
+__attribute__((target("avx2")))
+static void acc_build_avx2(int16_t *dst, const int16_t *src, const int *add, int n_add, const int *sub, int n_sub)
+{
+    const __m256i *s = (const __m256i*)src;
+    __m256i v0 = _mm256_loadu_si256(s), v1 = _mm256_loadu_si256(s + 1);
+    __m256i v2 = _mm256_loadu_si256(s + 2), v3 = _mm256_loadu_si256(s + 3);
+    for (int k = 0; k < n_add; k++) {
+        const __m256i *w = (const __m256i*)w1_wide[add[k]];
+        v0 = _mm256_add_epi16(v0, _mm256_load_si256(w));
+        v1 = _mm256_add_epi16(v1, _mm256_load_si256(w + 1));
+        v2 = _mm256_add_epi16(v2, _mm256_load_si256(w + 2));
+        v3 = _mm256_add_epi16(v3, _mm256_load_si256(w + 3));
+    }
+    for (int k = 0; k < n_sub; k++) {
+        const __m256i *w = (const __m256i*)w1_wide[sub[k]];
+        v0 = _mm256_sub_epi16(v0, _mm256_load_si256(w));
+        v1 = _mm256_sub_epi16(v1, _mm256_load_si256(w + 1));
+        v2 = _mm256_sub_epi16(v2, _mm256_load_si256(w + 2));
+        v3 = _mm256_sub_epi16(v3, _mm256_load_si256(w + 3));
+    }
+    __m256i *d = (__m256i*)dst;
+    _mm256_store_si256(d, v0);
+    _mm256_store_si256(d + 1, v1);
+    _mm256_store_si256(d + 2, v2);
+    _mm256_store_si256(d + 3, v3);
+}
+#endif
+
+static void acc_apply(int16_t *dst, const int16_t *src, const int *add, int n_add, const int *sub, int n_sub)
+{
+#ifdef NN_X86
+    if (nn_avx2) {
+        acc_build_avx2(dst, src, add, n_add, sub, n_sub);
+        return;
+    }
+#endif
+    acc_build(dst, src, add, n_add, sub, n_sub);
+}
+
+static void refresh_side(const awale_game_t *game, int16_t *acc, int p)
+{
+    int add[TOTAL_HOLES];
+    for (int h = 0; h < TOTAL_HOLES; h++) add[h] = feature(p, h, game->holes[h]);
+    acc_apply(acc, net->b1, add, TOTAL_HOLES, NULL, 0);
+}
+
+// Compute both accumulators of `game` from scratch.
+void nn_refresh(const awale_game_t *game, nn_acc_t *acc)
+{
+    if (!net) return;
+    refresh_side(game, acc->v[0], 0);
+    refresh_side(game, acc->v[1], 1);
+}
+
+// Derive the accumulators of `after` from those of its parent `before`: only the
+// holes the move touched change; long sowings touch most holes and are rebuilt.
+// `side` limits the work to one perspective (a leaf only needs its mover's), -1 = both.
+void nn_update(const nn_acc_t *parent, const awale_game_t *before, const awale_game_t *after, nn_acc_t *acc, int side)
+{
+    if (!net) return;
+    int changed[TOTAL_HOLES];
+    int n = 0;
+    for (int h = 0; h < TOTAL_HOLES; h++) {
+        if (before->holes[h] != after->holes[h]) changed[n++] = h;
+    }
+
+    for (int p = 0; p < 2; p++) {
+        if (side >= 0 && p != side) continue;
+        if (n > TOTAL_HOLES / 2) {
+            refresh_side(after, acc->v[p], p);
+            continue;
+        }
+        int add[TOTAL_HOLES], sub[TOTAL_HOLES];
+        for (int i = 0; i < n; i++) {
+            add[i] = feature(p, changed[i], after->holes[changed[i]]);
+            sub[i] = feature(p, changed[i], before->holes[changed[i]]);
+        }
+        acc_apply(acc->v[p], parent->v[p], add, n, sub, n);
+    }
+}
+
+static inline int clamp_quant(int x)
+{
+    return x < 0 ? 0 : (x > NN_QUANT ? NN_QUANT : x);
+}
+
+// Layers 2 and 3 from one accumulator. Output in units of 1/(NN_QUANT * NN_QUANT).
+static int forward_scalar(const int16_t *acc)
+{
+    uint8_t h1[NN_L1];
+    for (int i = 0; i < NN_L1; i++) h1[i] = (uint8_t)clamp_quant(acc[i]);
+
+    int out = net->b3;
+    for (int j = 0; j < NN_L2; j++) {
+        int s = net->b2[j];
+        for (int i = 0; i < NN_L1; i++) s += h1[i] * net->w2[j][i];
+        out += clamp_quant(s >> 6) * net->w3[j];
+    }
+    return out;
+}
+
+#ifdef NN_X86
+// Sum each of eight int32 vectors: lane k of the result is the total of v[k].
+__attribute__((target("avx2")))
+static inline __m256i hsum8_avx2(const __m256i *v)
+{
+    __m256i a = _mm256_hadd_epi32(_mm256_hadd_epi32(v[0], v[1]), _mm256_hadd_epi32(v[2], v[3]));
+    __m256i b = _mm256_hadd_epi32(_mm256_hadd_epi32(v[4], v[5]), _mm256_hadd_epi32(v[6], v[7]));
+    return _mm256_add_epi32(_mm256_permute2x128_si256(a, b, 0x20), _mm256_permute2x128_si256(a, b, 0x31));
+}
+
+__attribute__((target("avx2")))
+static int forward_avx2(const int16_t *acc)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i cap16 = _mm256_set1_epi16(NN_QUANT);
+    const __m256i cap32 = _mm256_set1_epi32(NN_QUANT);
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    /* Clipped ReLU and pack to uint8; packus interleaves 128-bit lanes, permute restores order */
+    __m256i a[4];
+    for (int i = 0; i < 4; i++) {
+        a[i] = _mm256_load_si256((const __m256i*)(acc + 16 * i));
+        a[i] = _mm256_min_epi16(_mm256_max_epi16(a[i], zero), cap16);
+    }
+    __m256i h_lo = _mm256_permute4x64_epi64(_mm256_packus_epi16(a[0], a[1]), 0xD8);
+    __m256i h_hi = _mm256_permute4x64_epi64(_mm256_packus_epi16(a[2], a[3]), 0xD8);
+
+    __m256i out = zero;
+    for (int j = 0; j < NN_L2; j += 8) {
+        __m256i dots[8];
+        for (int k = 0; k < 8; k++) {
+            /* uint8 x int8 pairs: at most 2 * 64 * 127, no int16 saturation */
+            __m256i lo = _mm256_maddubs_epi16(h_lo, _mm256_loadu_si256((const __m256i*)net->w2[j + k]));
+            __m256i hi = _mm256_maddubs_epi16(h_hi, _mm256_loadu_si256((const __m256i*)(net->w2[j + k] + 32)));
+            dots[k] = _mm256_madd_epi16(_mm256_add_epi16(lo, hi), ones);
+        }
+        __m256i s = _mm256_add_epi32(hsum8_avx2(dots), _mm256_loadu_si256((const __m256i*)(net->b2 + j)));
+        s = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(s, 6), zero), cap32);
+        __m256i w3 = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(net->w3 + j)));
+        out = _mm256_add_epi32(out, _mm256_mullo_epi32(s, w3));
+    }
+    __m128i r = _mm_add_epi32(_mm256_castsi256_si128(out), _mm256_extracti128_si256(out, 1));
+    r = _mm_add_epi32(r, _mm_shuffle_epi32(r, 0x4E));
+    r = _mm_add_epi32(r, _mm_shuffle_epi32(r, 0xB1));
+    return net->b3 + _mm_cvtsi128_si32(r);
+}
+#endif
+
+// Evaluation in seeds from the side to move's point of view: the score
+// difference plus the network's estimate of the seeds still to be won.
+int nn_evaluate(const awale_game_t *game, const nn_acc_t *acc)
+{
+    int me = game->current_player;
+    int diff = game->scores[me] - game->scores[1 - me];
+    if (!net) return diff;
+
+#ifdef NN_X86
+    int out = nn_avx2 ? forward_avx2(acc->v[me]) : forward_scalar(acc->v[me]);
+#else
+    int out = forward_scalar(acc->v[me]);
+#endif
+    int unit = NN_QUANT * NN_QUANT / NN_OUTPUT_SEEDS;
+    return diff + (out >= 0 ? out + unit / 2 : out - unit / 2) / unit;
+}
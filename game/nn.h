@@ -0,0 +1,54 @@
+#ifndef NN_H
+#define NN_H
+
+#include <stdint.h>
+#include "awale.h"
+
+/* Quantized neural evaluation: 12 holes x seed-bucket one-hot inputs,
+ * seen from one player's side, -> 64 -> 32 -> 1. The first layer is kept as
+ * an accumulator per perspective and updated incrementally move by move;
+ * the rest runs in int8 with an AVX2 path and a scalar fallback. The network
+ * predicts the seeds the side to move will still gain; the evaluation adds
+ * the current score difference. */
+
+#define NN_DEFAULT_FILE "awale.nn"
+#define NN_MAGIC "AWNN"
+#define NN_VERSION 1
+
+#define NN_BUCKETS 16                           /* 0..14 seeds, 15 = 15 or more */
+#define NN_INPUTS (TOTAL_HOLES * NN_BUCKETS)
+#define NN_L1 64
+#define NN_L2 32
+
+/* Fixed point: activations and weights are in units of 1/NN_QUANT, the
+ * network output of 1.0 stands for NN_OUTPUT_SEEDS seeds */
+#define NN_QUANT 64
+#define NN_OUTPUT_SEEDS 8
+
+/* Quantized parameters, as stored in the file after a 16-byte header */
+typedef struct {
+    int8_t w1[NN_INPUTS][NN_L1];
+    int16_t b1[NN_L1];
+    int8_t w2[NN_L2][NN_L1];
+    int32_t b2[NN_L2];
+    int8_t w3[NN_L2];
+    int32_t b3;
+} nn_weights_t;
+
+/* First layer outputs for both perspectives (64-byte aligned for AVX2) */
+typedef struct {
+    int16_t v[2][NN_L1] __attribute__((aligned(64)));
+} nn_acc_t;
+
+int nn_load(const char *path);
+int nn_save(const char *path, const nn_weights_t *weights);
+void nn_unload(void);
+int nn_loaded(void);
+void nn_use_simd(int enable);
+
+int nn_feature(int perspective, int hole, int seeds);
+void nn_refresh(const awale_game_t *game, nn_acc_t *acc);
+void nn_update(const nn_acc_t *parent, const awale_game_t *before, const awale_game_t *after, nn_acc_t *acc, int side);
+int nn_evaluate(const awale_game_t *game, const nn_acc_t *acc);
+
+#endif /* NN_H */
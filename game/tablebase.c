@@ -0,0 +1,402 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "tablebase.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Retrograde endgame tablebases.
+ *
+ * A table entry is the net number of seeds the side to move still gains under
+ * perfect play (its future captures minus the opponent's, including the final
+ * starvation collect). Positions are normalized so the side to move owns holes
+ * 0-5, which makes the side to move implicit, and stored one level per seed
+ * count: level n holds every distribution of n seeds over the 12 holes, indexed
+ * by awale_rank with side 0 to move.
+ *
+ * A capture always moves to a lower level, so levels are solved bottom-up.
+ * Inside a level, non-capturing moves can cycle; those are solved by value
+ * iteration starting from "each side keeps the seeds on its own row", the usual
+ * convention for games that never end. Once the final seed margin is known, the
+ * game result follows: the threshold stop at WINNING_SCORE never changes who
+ * ends up ahead, since a side past it already owns more than half the seeds. */
+
+#define TB_SWEEP_LIMIT 1000
+#define TB_NONE (-128)
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t max_seeds;
+    uint32_t reserved;
+} tb_header_t;
+
+/* Mapped file */
+static void *tb_map = NULL;
+static size_t tb_map_size = 0;
+static const int8_t *tb_values = NULL;
+static int tb_loaded_seeds = -1;
+static uint64_t tb_level_offset[TB_MAX_SEEDS + 2];
+
+// Positions with `seeds` seeds and side 0 to move: the first half of their awale_rank range.
+static uint64_t tb_level_size(int seeds)
+{
+    return awale_rank_size(seeds) / 2;
+}
+
+static void tb_compute_offsets(int max_seeds)
+{
+    tb_level_offset[0] = 0;
+    for (int n = 0; n <= max_seeds; n++) tb_level_offset[n + 1] = tb_level_offset[n] + tb_level_size(n);
+}
+
+static int tb_row_sum(const int *board, int first)
+{
+    int sum = 0;
+    for (int i = first; i < first + HOLES_PER_PLAYER; i++) sum += board[i];
+    return sum;
+}
+
+// Play `move` (0-5) for the side owning holes 0-5. Returns 1 when the game ends,
+// with *gain the mover's net final gain; otherwise returns 0 with *gain the
+// captured seeds and `child` the normalized position for the opponent.
+static int tb_play(const awale_game_t *pos, int move, awale_game_t *child, int *gain)
+{
+    int b[TOTAL_HOLES];
+    memcpy(b, pos->holes, sizeof(b));
+
+    int seeds = b[move];
+    int q = seeds / (TOTAL_HOLES - 1);
+    int r = seeds % (TOTAL_HOLES - 1);
+    b[move] = 0;
+    for (int d = 1; d < TOTAL_HOLES; d++) {
+        b[(move + d) % TOTAL_HOLES] += q + (d <= r);
+    }
+    int last = (move + (r ? r : TOTAL_HOLES - 1)) % TOTAL_HOLES;
+
+    int captured = 0;
+    while (last >= HOLES_PER_PLAYER && (b[last] == 2 || b[last] == 3)) {
+        captured += b[last];
+        b[last] = 0;
+        last--;
+    }
+
+    int own = tb_row_sum(b, 0);
+    int opp = tb_row_sum(b, HOLES_PER_PLAYER);
+    if (own == 0 || opp == 0) {
+        *gain = captured + own - opp;
+        return 1;
+    }
+    for (int i = 0; i < HOLES_PER_PLAYER; i++) {
+        child->holes[i] = b[i + HOLES_PER_PLAYER];
+        child->holes[i + HOLES_PER_PLAYER] = b[i];
+    }
+    *gain = captured;
+    return 0;
+}
+
+/* ---- Generation ---- */
+
+typedef struct {
+    int8_t *all;            /* every level solved so far, at tb_level_offset[] */
+    int seeds;              /* level being solved */
+    uint64_t size;
+    int8_t *fixed;          /* best over moves that leave the level, TB_NONE if none */
+    uint8_t *cyclic;        /* bitmask of moves that stay in the level */
+    int8_t *cur;
+    int8_t *next;
+} tb_level_t;
+
+typedef struct {
+    tb_level_t *level;
+    uint64_t begin, end;
+    uint64_t changed;
+    int pass;               /* 0 = classify moves, 1 = value iteration sweep */
+} tb_slice_t;
+
+static void tb_classify(tb_level_t *lv, uint64_t begin, uint64_t end)
+{
+    awale_game_t pos, child;
+    child.current_player = 0;
+    for (uint64_t p = begin; p < end; p++) {
+        awale_unrank(p, lv->seeds, &pos);
+        int own = tb_row_sum(pos.holes, 0);
+        int opp = tb_row_sum(pos.holes, HOLES_PER_PLAYER);
+
+        lv->cyclic[p] = 0;
+        if (own == 0 || opp == 0) {
+            /* Already finished: each side collects its own row */
+            lv->fixed[p] = (int8_t)(own - opp);
+            lv->cur[p] = lv->fixed[p];
+            continue;
+        }
+
+        int best = TB_NONE;
+        for (int m = 0; m < HOLES_PER_PLAYER; m++) {
+            if (pos.holes[m] == 0) continue;
+            int gain;
+            int value;
+            if (tb_play(&pos, m, &child, &gain)) {
+                value = gain;
+            } else if (gain > 0) {
+                int n = lv->seeds - gain;
+                value = gain - lv->all[tb_level_offset[n] + awale_rank(&child)];
+            } else {
+                lv->cyclic[p] |= (uint8_t)(1 << m);
+                continue;
+            }
+            if (value > best) best = value;
+        }
+        lv->fixed[p] = (int8_t)best;
+
+        /* Starting guess for cycles: the rows are split as they stand */
+        int guess = own - opp;
+        lv->cur[p] = (int8_t)(lv->cyclic[p] ? (best > guess ? best : guess) : best);
+    }
+}
+
+static uint64_t tb_sweep(tb_level_t *lv, uint64_t begin, uint64_t end)
+{
+    awale_game_t pos, child;
+    child.current_player = 0;
+    uint64_t changed = 0;
+    for (uint64_t p = begin; p < end; p++) {
+        int best = lv->fixed[p];
+        uint8_t mask = lv->cyclic[p];
+        if (mask) {
+            awale_unrank(p, lv->seeds, &pos);
+            for (int m = 0; m < HOLES_PER_PLAYER; m++) {
+                if (!(mask & (1 << m))) continue;
+                int gain;
+                tb_play(&pos, m, &child, &gain);
+                int value = -lv->cur[awale_rank(&child)];
+                if (value > best) best = value;
+            }
+        }
+        lv->next[p] = (int8_t)best;
+        changed += (best != lv->cur[p]);
+    }
+    return changed;
+}
+
+static void *tb_slice_main(void *arg)
+{
+    tb_slice_t *s = (tb_slice_t*)arg;
+    if (s->pass == 0) tb_classify(s->level, s->begin, s->end);
+    else s->changed = tb_sweep(s->level, s->begin, s->end);
+    return NULL;
+}
+
+// Run one pass over the level split across `threads` threads; returns the number of changed entries.
+static uint64_t tb_run_pass(tb_level_t *lv, int pass, int threads)
+{
+    tb_slice_t slices[64];
+    pthread_t tids[64];
+    if (threads < 1) threads = 1;
+    if (threads > 64) threads = 64;
+    if ((uint64_t)threads > lv->size) threads = (int)lv->size;
+
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        slices[i].level = lv;
+        slices[i].begin = lv->size * i / threads;
+        slices[i].end = lv->size * (i + 1) / threads;
+        slices[i].changed = 0;
+        slices[i].pass = pass;
+    }
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&tids[i], NULL, tb_slice_main, &slices[i]) != 0) break;
+        started++;
+    }
+    /* Slices whose thread failed to start run here */
+    tb_slice_main(&slices[0]);
+    for (int i = started + 1; i < threads; i++) tb_slice_main(&slices[i]);
+    for (int i = 1; i <= started; i++) pthread_join(tids[i], NULL);
+
+    uint64_t changed = 0;
+    for (int i = 0; i < threads; i++) changed += slices[i].changed;
+    return changed;
+}
+
+// Solve levels 0..max_seeds bottom-up and write them to `path`.
+int tb_generate(const char *path, int max_seeds, int threads)
+{
+    if (!path || max_seeds < 0 || max_seeds > TB_MAX_SEEDS) return -1;
+    tb_compute_offsets(max_seeds);
+
+    uint64_t total = tb_level_offset[max_seeds + 1];
+    uint64_t largest = tb_level_size(max_seeds);
+    int8_t *all = (int8_t*)malloc(total);
+    int8_t *fixed = (int8_t*)malloc(largest);
+    uint8_t *cyclic = (uint8_t*)malloc(largest);
+    int8_t *scratch = (int8_t*)malloc(largest);
+    if (!all || !fixed || !cyclic || !scratch) {
+        perror("malloc");
+        free(all); free(fixed); free(cyclic); free(scratch);
+        return -1;
+    }
+
+    for (int n = 0; n <= max_seeds; n++) {
+        tb_level_t lv;
+        lv.all = all;
+        lv.seeds = n;
+        lv.size = tb_level_size(n);
+        lv.fixed = fixed;
+        lv.cyclic = cyclic;
+        lv.cur = all + tb_level_offset[n];
+        lv.next = scratch;
+
+        tb_run_pass(&lv, 0, threads);
+        int sweeps = 0;
+        uint64_t changed = 1;
+        while (changed && sweeps < TB_SWEEP_LIMIT) {
+            changed = tb_run_pass(&lv, 1, threads);
+            /* The level always lives in `all`; swap by copying back */
+            memcpy(lv.cur, lv.next, lv.size);
+            sweeps++;
+        }
+        printf("Level %2d: %12llu positions, %d sweeps%s\n", n, (unsigned long long)lv.size, sweeps,
+               changed ? " (sweep limit reached)" : "");
+        fflush(stdout);
+    }
+
+    int status = 0;
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror("fopen");
+        status = -1;
+    } else {
+        tb_header_t header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, TB_MAGIC, 4);
+        header.version = TB_VERSION;
+        header.max_seeds = (uint32_t)max_seeds;
+        if (fwrite(&header, sizeof(header), 1, f) != 1 || fwrite(all, 1, total, f) != total) {
+            perror("fwrite");
+            status = -1;
+        }
+        if (fclose(f) != 0) status = -1;
+    }
+
+    free(all);
+    free(fixed);
+    free(cyclic);
+    free(scratch);
+    return status;
+}
+
+/* ---- Probing ---- */
+
+// Map a tablebase file. Returns the number of seeds it covers, or -1.
+int tb_open(const char *path)
+{
+    tb_close();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(tb_header_t)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    const tb_header_t *header = (const tb_header_t*)map;
+    int max_seeds = (int)header->max_seeds;
+    if (memcmp(header->magic, TB_MAGIC, 4) != 0 || header->version != TB_VERSION ||
+        max_seeds < 0 || max_seeds > TB_MAX_SEEDS) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    tb_compute_offsets(max_seeds);
+    if ((size_t)st.st_size < sizeof(tb_header_t) + tb_level_offset[max_seeds + 1]) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+
+    tb_map = map;
+    tb_map_size = (size_t)st.st_size;
+    tb_values = (const int8_t*)map + sizeof(tb_header_t);
+    tb_loaded_seeds = max_seeds;
+    return max_seeds;
+}
+
+void tb_close(void)
+{
+    if (tb_map) munmap(tb_map, tb_map_size);
+    tb_map = NULL;
+    tb_map_size = 0;
+    tb_values = NULL;
+    tb_loaded_seeds = -1;
+}
+
+// Seeds covered by the mapped tables, -1 if none are loaded.
+int tb_max_seeds(void)
+{
+    return tb_loaded_seeds;
+}
+
+// Normalize `game` so the side to move owns holes 0-5; returns the seed count.
+static int tb_normalize(const awale_game_t *game, awale_game_t *pos)
+{
+    int shift = game->current_player ? HOLES_PER_PLAYER : 0;
+    int seeds = 0;
+    for (int i = 0; i < TOTAL_HOLES; i++) {
+        pos->holes[i] = game->holes[(i + shift) % TOTAL_HOLES];
+        seeds += pos->holes[i];
+    }
+    pos->current_player = 0;
+    return seeds;
+}
+
+// Look up an unfinished position. On a hit returns 1 and stores in *value the
+// net seeds the side to move still gains with perfect play.
+int tb_probe(const awale_game_t *game, int *value)
+{
+    if (!tb_values || !game || game->game_over || game->variant != AWALE_VARIANT_STANDARD) return 0;
+    awale_game_t pos;
+    int seeds = tb_normalize(game, &pos);
+    if (seeds > tb_loaded_seeds) return 0;
+    *value = tb_values[tb_level_offset[seeds] + awale_rank(&pos)];
+    return 1;
+}
+
+// Pick the move that keeps the tablebase value. Returns 1 on a hit.
+int tb_best_move(const awale_game_t *game, int *move, int *value)
+{
+    if (!tb_values || !game || game->game_over || game->variant != AWALE_VARIANT_STANDARD) return 0;
+    awale_game_t pos, child;
+    int seeds = tb_normalize(game, &pos);
+    child.current_player = 0;
+    if (seeds > tb_loaded_seeds) return 0;
+
+    int best = TB_NONE - 1;
+    int best_move = -1;
+    for (int m = 0; m < HOLES_PER_PLAYER; m++) {
+        if (pos.holes[m] == 0) continue;
+        int gain;
+        int v;
+        if (tb_play(&pos, m, &child, &gain)) {
+            v = gain;
+        } else {
+            int n = seeds - gain;
+            v = gain - tb_values[tb_level_offset[n] + awale_rank(&child)];
+        }
+        if (v > best) {
+            best = v;
+            best_move = m;
+        }
+    }
+    if (best_move < 0) return 0;
+    *move = best_move + game->current_player * HOLES_PER_PLAYER;
+    *value = best;
+    return 1;
+}
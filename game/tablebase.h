@@ -0,0 +1,25 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include "awale.h"
+
+/* Endgame tablebase file probed by the server and the bots when present */
+#define TB_DEFAULT_FILE "awale.tb"
+#define TB_MAGIC "AWTB"
+#define TB_VERSION 1
+
+/* Largest table the generator accepts (C(n+11, 11) one-byte entries per level) */
+#define TB_MAX_SEEDS 24
+
+/* Generation: solve every position with up to `max_seeds` seeds on the board
+ * using `threads` threads, and write the tables to `path`. Returns 0 on success. */
+int tb_generate(const char *path, int max_seeds, int threads);
+
+/* Probing: the file is memory-mapped once and shared by every thread */
+int tb_open(const char *path);
+void tb_close(void);
+int tb_max_seeds(void);
+int tb_probe(const awale_game_t *game, int *value);
+int tb_best_move(const awale_game_t *game, int *move, int *value);
+
+#endif /* TABLEBASE_H */
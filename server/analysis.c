@@ -0,0 +1,322 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../game/awale.h"
+#include "../game/ai.h"
+#include "../game/tablebase.h"
+#include "../game/book.h"
+#include "workers.h"
+#include "analysis.h"
+
+#define ANALYSIS_TIME_MS 500
+#define ANALYSIS_CACHE_SIZE 4096    /* cached positions, a power of two */
+#define ANALYSIS_QUEUE_SIZE 64      /* positions waiting for the background search */
+
+/* Cache slot, chained per hash bucket and linked in LRU order (most recent first) */
+typedef struct {
+    uint64_t key;
+    int prev, next;
+    int chain;
+    analysis_t result;
+} cache_slot_t;
+
+/* The background search, owned by the worker pool until its completion runs */
+typedef struct {
+    uint64_t key;
+    awale_game_t game;
+    analysis_t result;
+} analysis_job_t;
+
+static analysis_ready_t ready_handler = NULL;
+static analysis_wanted_t wanted_handler = NULL;
+static volatile int analysis_stopping = 0;
+static int search_threads = 1;
+
+/* Games look positions up from the threads running them, searches finish on
+ * the lobby: the cache and the queue are under the lock */
+static pthread_mutex_t analysis_lock = PTHREAD_MUTEX_INITIALIZER;
+static cache_slot_t cache[ANALYSIS_CACHE_SIZE];
+static int buckets[ANALYSIS_CACHE_SIZE];
+static int cache_used = 0;
+static int lru_head = -1, lru_tail = -1;
+
+static awale_game_t queue[ANALYSIS_QUEUE_SIZE];
+static int queue_head = 0, queue_count = 0;
+static int job_running = 0;
+static uint64_t job_key = 0;
+
+void analysis_init(analysis_ready_t on_ready, analysis_wanted_t wanted)
+{
+    ready_handler = on_ready;
+    wanted_handler = wanted;
+    analysis_stopping = 0;
+    for (int i = 0; i < ANALYSIS_CACHE_SIZE; i++) buckets[i] = -1;
+    cache_used = 0;
+    lru_head = lru_tail = -1;
+    queue_head = queue_count = 0;
+    job_running = 0;
+}
+
+// Search each queued position on `threads` Lazy SMP threads.
+void analysis_set_threads(int threads)
+{
+    if (threads < 1) threads = 1;
+    if (threads > AI_MAX_THREADS) threads = AI_MAX_THREADS;
+    search_threads = threads;
+}
+
+void analysis_shutdown(void)
+{
+    analysis_stopping = 1;
+    pthread_mutex_lock(&analysis_lock);
+    queue_count = 0;
+    pthread_mutex_unlock(&analysis_lock);
+}
+
+static int cache_find(uint64_t key)
+{
+    for (int i = buckets[key & (ANALYSIS_CACHE_SIZE - 1)]; i >= 0; i = cache[i].chain) {
+        if (cache[i].key == key) return i;
+    }
+    return -1;
+}
+
+static void lru_unlink(int i)
+{
+    if (cache[i].prev >= 0) cache[cache[i].prev].next = cache[i].next;
+    else lru_head = cache[i].next;
+    if (cache[i].next >= 0) cache[cache[i].next].prev = cache[i].prev;
+    else lru_tail = cache[i].prev;
+}
+
+static void lru_push_front(int i)
+{
+    cache[i].prev = -1;
+    cache[i].next = lru_head;
+    if (lru_head >= 0) cache[lru_head].prev = i;
+    lru_head = i;
+    if (lru_tail < 0) lru_tail = i;
+}
+
+// Store a result, evicting the least recently used position when full.
+static void cache_insert(uint64_t key, const analysis_t *result)
+{
+    int i = cache_find(key);
+    if (i >= 0) {
+        lru_unlink(i);
+    } else {
+        if (cache_used < ANALYSIS_CACHE_SIZE) {
+            i = cache_used++;
+        } else {
+            i = lru_tail;
+            lru_unlink(i);
+            int *link = &buckets[cache[i].key & (ANALYSIS_CACHE_SIZE - 1)];
+            while (*link != i) link = &cache[*link].chain;
+            *link = cache[i].chain;
+        }
+        int *bucket = &buckets[key & (ANALYSIS_CACHE_SIZE - 1)];
+        cache[i].key = key;
+        cache[i].chain = *bucket;
+        *bucket = i;
+    }
+    cache[i].result = *result;
+    lru_push_front(i);
+}
+
+// Fill `out` from the tablebase or the opening book. Returns 1 if either covers the position.
+static int analysis_instant(const awale_game_t *game, analysis_t *out)
+{
+    int move, value;
+    book_entry_t stats;
+    memset(out, 0, sizeof(*out));
+    if (tb_best_move(game, &move, &value)) {
+        int me = game->current_player;
+        out->source = ANALYSIS_TABLEBASE;
+        out->best_move = move;
+        out->score = game->scores[me] - game->scores[1 - me] + value;
+        return 1;
+    }
+    if (book_best_move(game, &move, &stats)) {
+        out->source = ANALYSIS_BOOK;
+        out->best_move = move;
+        out->wins = stats.wins;
+        out->draws = stats.draws;
+        out->losses = stats.losses;
+        return 1;
+    }
+    return 0;
+}
+
+// Return 1 and fill `out` if the analysis of `game` is known (cached, tablebase or book).
+int analysis_lookup(const awale_game_t *game, analysis_t *out)
+{
+    if (!game || game->game_over) return 0;
+    uint64_t key = awale_hash(game);
+    pthread_mutex_lock(&analysis_lock);
+    int i = cache_find(key);
+    if (i >= 0) {
+        lru_unlink(i);
+        lru_push_front(i);
+        *out = cache[i].result;
+        pthread_mutex_unlock(&analysis_lock);
+        return 1;
+    }
+    pthread_mutex_unlock(&analysis_lock);
+    if (!analysis_instant(game, out)) return 0;
+    pthread_mutex_lock(&analysis_lock);
+    if (cache_find(key) < 0) cache_insert(key, out);
+    pthread_mutex_unlock(&analysis_lock);
+    return 1;
+}
+
+// Worker thread: search the position within the analysis budget.
+static void analysis_job(void *arg)
+{
+    analysis_job_t *job = (analysis_job_t*)arg;
+
+    ai_config_t cfg;
+    ai_config_default(&cfg);
+    cfg.threads = search_threads;
+    cfg.max_depth = AI_MAX_DEPTH - 1;
+    cfg.time_ms = ANALYSIS_TIME_MS;
+    cfg.stop = &analysis_stopping;
+
+    ai_result_t result;
+    ai_search(&job->game, &cfg, &result);
+    job->result.source = ANALYSIS_SEARCH;
+    job->result.best_move = result.best_move;
+    job->result.score = result.score;
+    job->result.depth = result.depth;
+    job->result.pv_len = result.pv_len;
+    for (int i = 0; i < result.pv_len; i++) job->result.pv[i] = (signed char)result.pv[i];
+}
+
+static void analysis_done(void *arg);
+
+// Start the background search on the oldest queued position still watched.
+// Called with analysis_lock held.
+static void analysis_pump(void)
+{
+    while (!job_running && !analysis_stopping && queue_count > 0) {
+        const awale_game_t *game = &queue[queue_head];
+        queue_head = (queue_head + 1) % ANALYSIS_QUEUE_SIZE;
+        queue_count--;
+
+        uint64_t key = awale_hash(game);
+        if (cache_find(key) >= 0 || (wanted_handler && !wanted_handler(key))) continue;
+
+        analysis_job_t *job = (analysis_job_t*)calloc(1, sizeof(analysis_job_t));
+        if (!job) return;
+        job->key = key;
+        job->game = *game;
+        if (workers_submit(analysis_job, analysis_done, job) < 0) {
+            free(job);
+            return;
+        }
+        job_running = 1;
+        job_key = key;
+    }
+}
+
+// Event loop: cache the result, tell the watchers and move on to the next position.
+static void analysis_done(void *arg)
+{
+    analysis_job_t *job = (analysis_job_t*)arg;
+    pthread_mutex_lock(&analysis_lock);
+    job_running = 0;
+    int stopping = analysis_stopping;
+    if (!stopping) cache_insert(job->key, &job->result);
+    pthread_mutex_unlock(&analysis_lock);
+    if (!stopping && ready_handler) ready_handler(job->key);
+    free(job);
+    pthread_mutex_lock(&analysis_lock);
+    analysis_pump();
+    pthread_mutex_unlock(&analysis_lock);
+}
+
+// Queue `game` for the background search unless it is known or already pending.
+// The ready handler is called once it is cached. Returns 0 on success.
+int analysis_queue(const awale_game_t *game)
+{
+    if (!game || game->game_over || analysis_stopping) return -1;
+    uint64_t key = awale_hash(game);
+    pthread_mutex_lock(&analysis_lock);
+    if (cache_find(key) >= 0 || (job_running && job_key == key)) {
+        pthread_mutex_unlock(&analysis_lock);
+        return 0;
+    }
+    for (int i = 0; i < queue_count; i++) {
+        if (awale_hash(&queue[(queue_head + i) % ANALYSIS_QUEUE_SIZE]) == key) {
+            pthread_mutex_unlock(&analysis_lock);
+            return 0;
+        }
+    }
+
+    /* Full: the oldest request is the most likely to be stale */
+    if (queue_count == ANALYSIS_QUEUE_SIZE) {
+        queue_head = (queue_head + 1) % ANALYSIS_QUEUE_SIZE;
+        queue_count--;
+    }
+    queue[(queue_head + queue_count) % ANALYSIS_QUEUE_SIZE] = *game;
+    queue_count++;
+    analysis_pump();
+    pthread_mutex_unlock(&analysis_lock);
+    return 0;
+}
+
+// Describe a search score (side to move's point of view) for humans.
+static void describe_score(char *out, int size, int score, const char *mover, const char *other)
+{
+    if (score >= AI_WIN - AI_MAX_DEPTH) {
+        snprintf(out, size, "%s wins in %d plies", mover, AI_WIN - score);
+    } else if (score <= -AI_WIN + AI_MAX_DEPTH) {
+        snprintf(out, size, "%s wins in %d plies", other, AI_WIN + score);
+    } else if (score > AI_TB_WIN) {
+        snprintf(out, size, "%s wins by %d seeds", mover, score - AI_TB_WIN);
+    } else if (score < -AI_TB_WIN) {
+        snprintf(out, size, "%s wins by %d seeds", other, -AI_TB_WIN - score);
+    } else {
+        snprintf(out, size, "score %+d for %s", score, mover);
+    }
+}
+
+// Render an analysis of `game` with the players' names.
+void analysis_format(const analysis_t *a, const awale_game_t *game,
+                     const char *player0, const char *player1, char *text, int size)
+{
+    const char *names[2] = { player0 ? player0 : "Player 0", player1 ? player1 : "Player 1" };
+    const char *mover = names[game->current_player];
+    const char *other = names[1 - game->current_player];
+
+    if (a->best_move < 0) {
+        snprintf(text, size, "No move available for %s", mover);
+        return;
+    }
+    if (a->source == ANALYSIS_TABLEBASE) {
+        if (a->score > 0) {
+            snprintf(text, size, "Tablebase (exact): %s to move plays %d and wins by %d seeds", mover, a->best_move, a->score);
+        } else if (a->score < 0) {
+            snprintf(text, size, "Tablebase (exact): %s to move plays %d, %s wins by %d seeds", mover, a->best_move, other, -a->score);
+        } else {
+            snprintf(text, size, "Tablebase (exact): %s to move plays %d, the game is drawn", mover, a->best_move);
+        }
+        return;
+    }
+    if (a->source == ANALYSIS_BOOK) {
+        snprintf(text, size, "Opening book: %s to move plays %d (%u wins, %u draws, %u losses in archived games)",
+                 mover, a->best_move, a->wins, a->draws, a->losses);
+        return;
+    }
+
+    char verdict[160];
+    describe_score(verdict, sizeof(verdict), a->score, mover, other);
+    int offset = snprintf(text, size, "Search depth %d: %s to move plays %d, %s. Line:",
+                          a->depth, mover, a->best_move, verdict);
+    for (int i = 0; i < a->pv_len && offset < size; i++) {
+        offset += snprintf(text + offset, size - offset, " %d", a->pv[i]);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef SERVER_ANALYSIS_H
+#define SERVER_ANALYSIS_H
+
+#include <stdint.h>
+#include "../game/awale.h"
+#include "../game/ai.h"
+
+/* Live position analysis for spectators. Results are cached by position
+ * (awale_hash) in a bounded LRU table, so a position is analysed once however
+ * many spectators or sessions reach it. Tablebase and opening book positions
+ * are answered at once; anything else is queued and searched in the
+ * background, one position at a time. Lookups and queueing may come from
+ * any thread running a game; the handlers are called on the event loop,
+ * except `wanted`, which any of those threads may call. */
+
+typedef enum {
+    ANALYSIS_SEARCH,
+    ANALYSIS_TABLEBASE,
+    ANALYSIS_BOOK
+} analysis_source_t;
+
+/* Player-independent result for the side to move */
+typedef struct {
+    analysis_source_t source;
+    int best_move;              /* -1 if the side to move has no move */
+    int score;                  /* search score, or final seed margin from the tablebase */
+    int depth;                  /* search depth */
+    uint32_t wins, draws, losses;   /* book statistics */
+    int pv_len;
+    signed char pv[AI_MAX_PV];
+} analysis_t;
+
+/* Called when the analysis of position `key` has been cached */
+typedef void (*analysis_ready_t)(uint64_t key);
+/* Asked before a queued position is searched: is it still being watched? */
+typedef int (*analysis_wanted_t)(uint64_t key);
+
+void analysis_init(analysis_ready_t on_ready, analysis_wanted_t wanted);
+void analysis_shutdown(void);
+void analysis_set_threads(int threads);
+
+int analysis_lookup(const awale_game_t *game, analysis_t *out);
+int analysis_queue(const awale_game_t *game);
+void analysis_format(const analysis_t *a, const awale_game_t *game,
+                     const char *player0, const char *player1, char *text, int size);
+
+#endif
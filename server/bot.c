@@ -0,0 +1,440 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../game/awale.h"
+#include "../game/ai.h"
+#include "../game/mcts.h"
+#include "../game/tablebase.h"
+#include "../game/book.h"
+#include "../game/nn.h"
+#include "workers.h"
+#include "bot.h"
+
+#define BOT_TT_MB 64
+#define BOT_MCTS_NODES (1 << 20)
+#define BOT_MCTS_TREES 64           /* idle trees kept for reuse */
+#define BOT_PONDER_PREDICT_DEPTH 8
+#define BOT_PONDER_DEFAULT_MS 10000
+
+typedef enum {
+    BOT_ENGINE_ALPHABETA,
+    BOT_ENGINE_MCTS
+} bot_engine_t;
+
+/* Bot profiles: reserved username, engine, per-move search budget and
+ * whether the neural evaluation is used (when awale.nn is loaded) */
+typedef struct {
+    const char *name;
+    bot_engine_t engine;
+    int max_depth;
+    int time_ms;
+    int use_nn;
+} bot_profile_t;
+
+static const bot_profile_t bot_profiles[] = {
+    { "bot_easy", BOT_ENGINE_ALPHABETA, 2, 0, 0 },
+    { "bot", BOT_ENGINE_ALPHABETA, 12, 300, 0 },
+    { "bot_hard", BOT_ENGINE_ALPHABETA, AI_MAX_DEPTH - 1, 1500, 0 },
+    { "bot_mcts", BOT_ENGINE_MCTS, 0, 500, 0 },
+    { "bot_nn", BOT_ENGINE_ALPHABETA, AI_MAX_DEPTH - 1, 1500, 1 },
+};
+#define NUM_BOT_PROFILES ((int)(sizeof(bot_profiles) / sizeof(bot_profiles[0])))
+
+/* One pending search, owned by the worker pool until its completion runs */
+typedef struct {
+    int session_id;
+    unsigned int serial;
+    const bot_profile_t *profile;
+    awale_game_t game;
+    int hole;
+} bot_job_t;
+
+/* One ponder search. It is shared while `listed` (waiting for the human's
+ * move) or `running` (on a worker), and freed once it is neither. */
+typedef struct ponder_job {
+    int session_id;
+    unsigned int serial;
+    const bot_profile_t *profile;
+    awale_game_t game;          /* the human to move */
+    int predicted;              /* human reply being pondered, set by the worker */
+    int hole;                   /* the bot's answer to `predicted` */
+    volatile int pondering;     /* cleared on a ponder hit: the bot's clock starts */
+    volatile int stop;
+    int running;
+    int listed;
+    int hit;
+    struct ponder_job *next;
+} ponder_job_t;
+
+static bot_move_handler_t move_handler = NULL;
+static volatile int bot_stopping = 0;
+static ai_weights_t tuned_weights;
+static int have_tuned_weights = 0;
+static int search_threads = 1;      /* threads per bot search */
+
+/* Monte Carlo trees are big (BOT_MCTS_NODES nodes): a search borrows an idle
+ * one, which mcts_search resets, instead of allocating its own */
+static pthread_mutex_t tree_lock = PTHREAD_MUTEX_INITIALIZER;
+static mcts_tree_t *idle_trees[BOT_MCTS_TREES];
+static int num_idle_trees = 0;
+
+/* Pending real searches and the ponder budget. Games run on the lobby or on
+ * the reactors and searches finish on the lobby: all of it is under the lock. */
+static pthread_mutex_t state_lock = PTHREAD_MUTEX_INITIALIZER;
+static int searches_pending = 0;
+static int ponder_slots = 0;
+static int ponder_ms = BOT_PONDER_DEFAULT_MS;
+static int ponder_running = 0;
+static ponder_job_t *ponder_jobs = NULL;
+
+static const bot_profile_t *find_profile(const char *name)
+{
+    if (!name) return NULL;
+    for (int i = 0; i < NUM_BOT_PROFILES; i++) {
+        if (strcmp(bot_profiles[i].name, name) == 0) return &bot_profiles[i];
+    }
+    return NULL;
+}
+
+// Start the worker pool (one worker per spare core) and the shared search table.
+int bot_init(bot_move_handler_t on_move)
+{
+    move_handler = on_move;
+    bot_stopping = 0;
+    if (ai_init(BOT_TT_MB) < 0) return -1;
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int nworkers = (cores > 1) ? (int)cores - 1 : 1;
+    if (workers_init(nworkers) < 0) {
+        ai_cleanup();
+        return -1;
+    }
+    printf("Bot worker pool started (%d workers)\n", workers_count());
+    return 0;
+}
+
+void bot_shutdown(void)
+{
+    bot_stopping = 1;
+    pthread_mutex_lock(&state_lock);
+    for (ponder_job_t *job = ponder_jobs; job; job = job->next) {
+        __atomic_store_n(&job->stop, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&state_lock);
+    workers_shutdown();
+    ai_cleanup();
+    while (num_idle_trees > 0) mcts_free(idle_trees[--num_idle_trees]);
+}
+
+// Return 1 if `name` is reserved for a built-in bot.
+int bot_is_bot_name(const char *name)
+{
+    return find_profile(name) != NULL;
+}
+
+// Return 1 if bot `name` can play rule variant `variant`. The Monte Carlo
+// playouts only know the standard rules.
+int bot_plays_variant(const char *name, int variant)
+{
+    const bot_profile_t *profile = find_profile(name);
+    if (!profile) return 0;
+    return profile->engine != BOT_ENGINE_MCTS || variant == AWALE_VARIANT_STANDARD;
+}
+
+// Append one line per available bot to `buffer`.
+void bot_list(char *buffer, int size)
+{
+    int offset = (int)strlen(buffer);
+    for (int i = 0; i < NUM_BOT_PROFILES && offset < size; i++) {
+        offset += snprintf(buffer + offset, size - offset, "%s (bot)\n", bot_profiles[i].name);
+    }
+}
+
+// Use tuned evaluation weights (from awale_selfplay -T) in the alpha-beta bots.
+void bot_set_weights(const ai_weights_t *weights)
+{
+    tuned_weights = *weights;
+    have_tuned_weights = 1;
+}
+
+// Let each bot search (moves and pondering) run on `threads` threads.
+void bot_set_threads(int threads)
+{
+    if (threads < 1) threads = 1;
+    if (threads > AI_MAX_THREADS) threads = AI_MAX_THREADS;
+    search_threads = threads;
+}
+
+// Worker thread: take an idle Monte Carlo tree, or allocate one.
+static mcts_tree_t *tree_acquire(void)
+{
+    mcts_tree_t *tree = NULL;
+    pthread_mutex_lock(&tree_lock);
+    if (num_idle_trees > 0) tree = idle_trees[--num_idle_trees];
+    pthread_mutex_unlock(&tree_lock);
+    return tree ? tree : mcts_create(BOT_MCTS_NODES);
+}
+
+static void tree_release(mcts_tree_t *tree)
+{
+    pthread_mutex_lock(&tree_lock);
+    if (num_idle_trees < BOT_MCTS_TREES) {
+        idle_trees[num_idle_trees++] = tree;
+        tree = NULL;
+    }
+    pthread_mutex_unlock(&tree_lock);
+    mcts_free(tree);
+}
+
+// Worker thread: run a Monte Carlo search within the bot's time budget.
+static int bot_mcts_move(bot_job_t *job)
+{
+    mcts_tree_t *tree = tree_acquire();
+    if (!tree) return -1;
+
+    mcts_config_t cfg;
+    mcts_config_default(&cfg);
+    cfg.threads = search_threads;
+    cfg.time_ms = job->profile->time_ms;
+    cfg.seed = job->serial * 2654435761u ^ (unsigned int)awale_hash(&job->game);
+    cfg.stop = &bot_stopping;
+
+    mcts_result_t result;
+    mcts_search(tree, &job->game, &cfg, &result);
+    tree_release(tree);
+    return result.best_move;
+}
+
+// Worker thread: search the position with the bot's budget.
+static void bot_search_job(void *arg)
+{
+    bot_job_t *job = (bot_job_t*)arg;
+    int value;
+    if (book_best_move(&job->game, &job->hole, NULL)) return;
+    if (tb_best_move(&job->game, &job->hole, &value)) return;
+
+    if (job->profile->engine == BOT_ENGINE_MCTS) {
+        job->hole = bot_mcts_move(job);
+        return;
+    }
+
+    ai_config_t cfg;
+    ai_config_default(&cfg);
+    cfg.threads = search_threads;
+    cfg.max_depth = job->profile->max_depth;
+    cfg.time_ms = job->profile->time_ms;
+    cfg.stop = &bot_stopping;
+    cfg.use_nn = job->profile->use_nn;
+    cfg.weights = have_tuned_weights ? &tuned_weights : NULL;
+
+    ai_result_t result;
+    ai_search(&job->game, &cfg, &result);
+    job->hole = result.best_move;
+}
+
+// Event loop: hand the chosen move back to the server.
+static void bot_search_done(void *arg)
+{
+    bot_job_t *job = (bot_job_t*)arg;
+    pthread_mutex_lock(&state_lock);
+    searches_pending--;
+    pthread_mutex_unlock(&state_lock);
+    if (job->hole >= 0 && move_handler) {
+        move_handler(job->session_id, job->serial, job->profile->name, job->hole);
+    }
+    free(job);
+}
+
+// Queue a search for `bot_name` to move in `game`. The result is delivered to the
+// move handler together with `session_id`/`serial` so stale results can be dropped.
+int bot_request_move(int session_id, unsigned int serial, const awale_game_t *game, const char *bot_name)
+{
+    const bot_profile_t *profile = find_profile(bot_name);
+    if (!profile || !game) return -1;
+
+    bot_job_t *job = (bot_job_t*)malloc(sizeof(bot_job_t));
+    if (!job) return -1;
+    job->session_id = session_id;
+    job->serial = serial;
+    job->profile = profile;
+    job->game = *game;
+    job->hole = -1;
+
+    pthread_mutex_lock(&state_lock);
+    if (workers_submit(bot_search_job, bot_search_done, job) < 0) {
+        pthread_mutex_unlock(&state_lock);
+        free(job);
+        return -1;
+    }
+
+    /* Real moves come first: give up the oldest ponder search if workers run short */
+    searches_pending++;
+    if (searches_pending + ponder_running > workers_count()) {
+        ponder_job_t *oldest = NULL;
+        for (ponder_job_t *p = ponder_jobs; p; p = p->next) {
+            if (p->running && !p->stop) oldest = p;
+        }
+        if (oldest) __atomic_store_n(&oldest->stop, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&state_lock);
+    return 0;
+}
+
+// Set the global ponder budget: concurrent ponder searches (0 = off) and time per search.
+void bot_set_ponder(int max_searches, int max_ms)
+{
+    ponder_slots = max_searches > 0 ? max_searches : 0;
+    ponder_ms = max_ms > 0 ? max_ms : BOT_PONDER_DEFAULT_MS;
+}
+
+// Worker thread: predict the human's reply, then search the bot's answer until
+// the reply is confirmed (then within the bot's budget) or ponder_ms runs out.
+static void bot_ponder_job(void *arg)
+{
+    ponder_job_t *job = (ponder_job_t*)arg;
+    ai_config_t cfg;
+    ai_result_t result;
+
+    /* The bot's own search just filled the table, so this is mostly hash hits */
+    ai_config_default(&cfg);
+    cfg.max_depth = BOT_PONDER_PREDICT_DEPTH;
+    cfg.stop = &job->stop;
+    ai_search(&job->game, &cfg, &result);
+    if (result.best_move < 0 || __atomic_load_n(&job->stop, __ATOMIC_RELAXED)) return;
+
+    awale_game_t pos = job->game;
+    awale_play_move(&pos, result.best_move);
+    if (pos.game_over) return;
+    __atomic_store_n(&job->predicted, result.best_move, __ATOMIC_RELEASE);
+
+    int value;
+    if (book_best_move(&pos, &job->hole, NULL)) return;
+    if (tb_best_move(&pos, &job->hole, &value)) return;
+
+    cfg.threads = search_threads;
+    cfg.max_depth = job->profile->max_depth;
+    cfg.time_ms = job->profile->time_ms;
+    cfg.use_nn = job->profile->use_nn;
+    cfg.weights = have_tuned_weights ? &tuned_weights : NULL;
+    cfg.ponder = &job->pondering;
+    cfg.ponder_ms = ponder_ms;
+    ai_search(&pos, &cfg, &result);
+    job->hole = result.best_move;
+}
+
+// Event loop: a confirmed ponder result becomes the bot's move.
+static void bot_ponder_finish(void *arg)
+{
+    ponder_job_t *job = (ponder_job_t*)arg;
+    if (job->hit && job->hole >= 0 && move_handler) {
+        move_handler(job->session_id, job->serial, job->profile->name, job->hole);
+    }
+    free(job);
+}
+
+// Event loop: the worker is done. Keep the answer if the human has not moved yet.
+static void bot_ponder_done(void *arg)
+{
+    ponder_job_t *job = (ponder_job_t*)arg;
+    pthread_mutex_lock(&state_lock);
+    job->running = 0;
+    ponder_running--;
+    int finished = !job->listed;
+    pthread_mutex_unlock(&state_lock);
+    if (finished) bot_ponder_finish(job);
+}
+
+/* Called with state_lock held */
+static ponder_job_t *ponder_unlink(int session_id)
+{
+    for (ponder_job_t **p = &ponder_jobs; *p; p = &(*p)->next) {
+        if ((*p)->session_id == session_id) {
+            ponder_job_t *job = *p;
+            *p = job->next;
+            job->listed = 0;
+            return job;
+        }
+    }
+    return NULL;
+}
+
+// Start pondering after `bot_name` moved in `game`, if the budget allows it.
+// Returns 0 if a ponder search was queued.
+int bot_ponder_start(int session_id, unsigned int serial, const awale_game_t *game, const char *bot_name)
+{
+    const bot_profile_t *profile = find_profile(bot_name);
+    bot_ponder_cancel(session_id);
+    if (!profile || !game || game->game_over || profile->engine != BOT_ENGINE_ALPHABETA) return -1;
+
+    ponder_job_t *job = (ponder_job_t*)calloc(1, sizeof(ponder_job_t));
+    if (!job) return -1;
+    job->session_id = session_id;
+    job->serial = serial;
+    job->profile = profile;
+    job->game = *game;
+    job->predicted = -1;
+    job->hole = -1;
+    job->pondering = 1;
+    job->running = 1;
+    job->listed = 1;
+
+    pthread_mutex_lock(&state_lock);
+    if (ponder_running >= ponder_slots || searches_pending + ponder_running >= workers_count() ||
+        workers_submit(bot_ponder_job, bot_ponder_done, job) < 0) {
+        pthread_mutex_unlock(&state_lock);
+        free(job);
+        return -1;
+    }
+    ponder_running++;
+    job->next = ponder_jobs;
+    ponder_jobs = job;
+    pthread_mutex_unlock(&state_lock);
+    return 0;
+}
+
+// The human played `hole`. Returns 1 if the pondered answer will be delivered
+// to the move handler, 0 if the caller must request a normal search.
+int bot_ponder_resolve(int session_id, unsigned int serial, int hole)
+{
+    pthread_mutex_lock(&state_lock);
+    ponder_job_t *job = ponder_unlink(session_id);
+    if (!job) {
+        pthread_mutex_unlock(&state_lock);
+        return 0;
+    }
+
+    job->hit = job->serial == serial && !__atomic_load_n(&job->stop, __ATOMIC_RELAXED) &&
+               __atomic_load_n(&job->predicted, __ATOMIC_ACQUIRE) == hole;
+    int hit = job->hit, running = job->running;
+    if (!hit) __atomic_store_n(&job->stop, 1, __ATOMIC_RELAXED);
+    /* Ponder hit: the search goes on with the bot's own time budget */
+    else if (running) __atomic_store_n(&job->pondering, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&state_lock);
+
+    if (!hit) {
+        if (!running) free(job);
+        return 0;
+    }
+    if (running) return 1;
+    if (job->hole < 0 || workers_defer(bot_ponder_finish, job) < 0) {
+        free(job);
+        return 0;
+    }
+    return 1;
+}
+
+// Drop the ponder search of a session (new move, game over or abandoned).
+void bot_ponder_cancel(int session_id)
+{
+    pthread_mutex_lock(&state_lock);
+    ponder_job_t *job = ponder_unlink(session_id);
+    int running = job ? job->running : 0;
+    if (job) __atomic_store_n(&job->stop, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&state_lock);
+    if (job && !running) free(job);
+}
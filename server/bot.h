@@ -0,0 +1,35 @@
+#ifndef SERVER_BOT_H
+#define SERVER_BOT_H
+
+#include "../game/awale.h"
+#include "../game/ai.h"
+
+/* Built-in bot players. Bots have reserved usernames, are challenged like any
+ * player and play through session_handle_move; their searches run on the
+ * worker pool, never on the event loop thread. */
+
+/* Called on the event loop once a bot has picked its move */
+typedef void (*bot_move_handler_t)(int session_id, unsigned int serial, const char *bot_name, int hole);
+
+int bot_init(bot_move_handler_t on_move);
+void bot_shutdown(void);
+
+int bot_is_bot_name(const char *name);
+int bot_plays_variant(const char *name, int variant);
+void bot_list(char *buffer, int size);
+void bot_set_weights(const ai_weights_t *weights);
+void bot_set_threads(int threads);
+int bot_request_move(int session_id, unsigned int serial, const awale_game_t *game, const char *bot_name);
+
+/* Pondering (opt-in): once an alpha-beta bot has moved, a worker predicts the
+ * human's reply and searches the bot's answer to it while the human thinks.
+ * At most `max_searches` ponder searches run at once over all sessions, each
+ * for at most `max_ms`, and only on workers no real bot search needs.
+ * bot_ponder_resolve() is called with the human's actual move: on a hit the
+ * ponder search becomes the bot's move (returns 1), otherwise it is dropped. */
+void bot_set_ponder(int max_searches, int max_ms);
+int bot_ponder_start(int session_id, unsigned int serial, const awale_game_t *game, const char *bot_name);
+int bot_ponder_resolve(int session_id, unsigned int serial, int hole);
+void bot_ponder_cancel(int session_id);
+
+#endif
@@ -0,0 +1,97 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mailbox.h"
+
+/* Intrusive MPSC queue (Vyukov): producers swap themselves in as the tail and
+ * then link the previous tail to them; the consumer follows the links from a
+ * stub node. Between the swap and the link a producer is "in progress" and
+ * the consumer sees the queue end early, which is why a producer only
+ * signals once its node is linked. */
+
+int mailbox_init(mailbox_t *mb)
+{
+    mb->stub.next = NULL;
+    mb->head = &mb->stub;
+    mb->tail = &mb->stub;
+    mb->signaled = 0;
+    if (pipe(mb->pipe) < 0) {
+        perror("pipe");
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(mb->pipe[i], F_SETFL, fcntl(mb->pipe[i], F_GETFL) | O_NONBLOCK);
+    }
+    return 0;
+}
+
+void mailbox_destroy(mailbox_t *mb)
+{
+    close(mb->pipe[0]);
+    close(mb->pipe[1]);
+    mb->pipe[0] = mb->pipe[1] = -1;
+}
+
+static void link_node(mailbox_t *mb, mailbox_node_t *node)
+{
+    __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+    mailbox_node_t *prev = __atomic_exchange_n(&mb->tail, node, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+}
+
+// Push from any thread; wakes the consumer unless a wakeup is already pending.
+void mailbox_push(mailbox_t *mb, mailbox_node_t *node)
+{
+    link_node(mb, node);
+    if (!__atomic_exchange_n(&mb->signaled, 1, __ATOMIC_SEQ_CST)) {
+        char b = 1;
+        if (write(mb->pipe[1], &b, 1) < 0 && errno != EAGAIN) perror("write");
+    }
+}
+
+// Consumer only: the oldest node, or NULL when none is (fully) pushed yet.
+mailbox_node_t *mailbox_pop(mailbox_t *mb)
+{
+    mailbox_node_t *head = mb->head;
+    mailbox_node_t *next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    if (head == &mb->stub) {
+        if (!next) return NULL;
+        mb->head = next;
+        head = next;
+        next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    }
+    if (next) {
+        mb->head = next;
+        return head;
+    }
+    /* `head` looks last: put the stub behind it so it can be handed out */
+    if (head != __atomic_load_n(&mb->tail, __ATOMIC_ACQUIRE)) return NULL;
+    link_node(mb, &mb->stub);
+    next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    if (next) {
+        mb->head = next;
+        return head;
+    }
+    return NULL;
+}
+
+int mailbox_fd(const mailbox_t *mb)
+{
+    return mb->pipe[0];
+}
+
+/* Consumer only, before popping: empty the pipe and rearm the wakeup. Mail
+ * pushed from here on signals again, so none is left behind when the
+ * consumer pops until NULL and goes back to sleep. */
+void mailbox_ack(mailbox_t *mb)
+{
+    char buf[64];
+    while (read(mb->pipe[0], buf, sizeof(buf)) > 0) {
+    }
+    __atomic_store_n(&mb->signaled, 0, __ATOMIC_SEQ_CST);
+}
@@ -0,0 +1,31 @@
+#ifndef SERVER_MAILBOX_H
+#define SERVER_MAILBOX_H
+
+/* Lock-free multi-producer, single-consumer mailbox between threads.
+ *
+ * Any thread pushes nodes embedded in its own structures; the owning thread
+ * pops them in push order. A push costs one atomic exchange; the consumer is
+ * woken through a pipe only when it may be asleep, so a burst of mail costs
+ * one wakeup. The consumer selects (or polls) on mailbox_fd() and, once it
+ * is readable, calls mailbox_ack() before popping everything. */
+
+typedef struct mailbox_node {
+    struct mailbox_node *next;
+} mailbox_node_t;
+
+typedef struct {
+    mailbox_node_t *head;           /* consumer side */
+    mailbox_node_t *tail;           /* last pushed, swapped by the producers */
+    mailbox_node_t stub;
+    int signaled;                   /* a wakeup is on its way */
+    int pipe[2];
+} mailbox_t;
+
+int mailbox_init(mailbox_t *mb);
+void mailbox_destroy(mailbox_t *mb);
+void mailbox_push(mailbox_t *mb, mailbox_node_t *node);
+mailbox_node_t *mailbox_pop(mailbox_t *mb);
+int mailbox_fd(const mailbox_t *mb);
+void mailbox_ack(mailbox_t *mb);
+
+#endif
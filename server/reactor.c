@@ -0,0 +1,666 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/select.h>
+
+#include "mailbox.h"
+#include "reactor.h"
+#include "uring.h"
+
+#define MAX_REACTORS 64
+
+/* Mail between the lobby and the reactors. Messages travel as copies of
+ * their fields, sender\0recipient\0data\0 in `text`. */
+typedef enum {
+    MAIL_MESSAGE,       /* reactor -> lobby: a message was received */
+    MAIL_CLOSED,        /* reactor -> lobby: the connection is lost */
+    MAIL_SEND,          /* lobby -> reactor: send a message; reactor -> lobby:
+                           pass it on to the reactor owning the socket */
+    MAIL_ENCODING,      /* lobby -> reactor: switch the frame encoding */
+    MAIL_CLOSE,         /* lobby -> reactor: send what is queued and close */
+    MAIL_MIGRATE,       /* lobby -> reactor: hand the connection to another reactor */
+    MAIL_EXPECT,        /* lobby -> reactor: the connection is on its way here */
+    MAIL_ADOPT,         /* reactor -> reactor: take the connection over */
+    MAIL_CALL           /* any thread -> lobby or reactor: run a function there */
+} mail_kind_t;
+
+typedef struct mail {
+    mailbox_node_t node;            /* first, a mail is its node */
+    struct mail *next;              /* held until the connection is adopted */
+    mail_kind_t kind;
+    SOCKET sock;
+    uint32_t serial;                /* connection on `sock` the mail is about */
+    int reactor;                    /* to the lobby: the reactor posting it */
+    int value;                      /* ENCODING: the encoding, MIGRATE: the new reactor,
+                                       ADOPT: 1 if the connection is lost */
+    void (*call)(void *arg);        /* CALL: the function and its argument */
+    void *arg;
+    msg_type_t type;
+    uint32_t request_id;
+    size_t sender_len, recipient_len, data_len;
+    char text[];
+} mail_t;
+
+typedef struct {
+    pthread_t thread;
+    int index;
+    int use_uring;
+    SOCKET listeners[NET_MAX_LISTENERS];
+    int num_listeners;
+    mailbox_t inbox;
+    fd_set socks;                   /* select loop: connections being read */
+    int max_fd;
+    unsigned char owned[FD_SETSIZE];    /* connections read and written here */
+    unsigned char closing[FD_SETSIZE];  /* lost, waiting for the lobby's close */
+    unsigned char moving[FD_SETSIZE];   /* released, waiting for the end of its io_uring receive */
+    int moving_to[FD_SETSIZE];          /* ... to be handed to that reactor */
+    uint32_t arriving[FD_SETSIZE];      /* connection on its way here from another reactor */
+    mail_t *held[FD_SETSIZE];           /* mail for it, carried out once it is here */
+    mail_t *held_tail[FD_SETSIZE];
+    uint32_t peer[FD_SETSIZE];          /* connection the sessions here send to (reactors_address) */
+} reactor_t;
+
+static reactor_t reactors[MAX_REACTORS];
+static int num_reactors = 0;
+static mailbox_t lobby_inbox;
+static reactor_filter_t filter = NULL;
+static __thread reactor_t *self = NULL;     /* the reactor running this thread */
+
+/* Per descriptor, shared by all threads: the serial of the connection,
+ * bumped on each accept. Mail carries the serial, so a late mail about a
+ * closed connection is told from one about the next connection reusing its
+ * descriptor. */
+static uint32_t conn_serial[FD_SETSIZE];
+
+/* Lobby side: the reactor its mail for each descriptor goes to, the last
+ * connection heard of and the last one it closed, whose mail still in flight
+ * is dropped */
+static int lobby_owner[FD_SETSIZE];
+static uint32_t known_serial[FD_SETSIZE];
+static uint32_t closed_serial[FD_SETSIZE];
+
+static mail_t *new_mail(mail_kind_t kind, SOCKET sock, uint32_t serial, msg_type_t type, uint32_t request_id,
+                        const char *sender, size_t sender_len, const char *recipient, size_t recipient_len,
+                        const char *data, size_t data_len)
+{
+    mail_t *mail = malloc(sizeof(*mail) + sender_len + recipient_len + data_len + 3);
+    if (!mail) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    mail->next = NULL;
+    mail->kind = kind;
+    mail->sock = sock;
+    mail->serial = serial;
+    mail->reactor = self ? self->index : -1;
+    mail->value = 0;
+    mail->call = NULL;
+    mail->arg = NULL;
+    mail->type = type;
+    mail->request_id = request_id;
+    mail->sender_len = sender_len;
+    mail->recipient_len = recipient_len;
+    mail->data_len = data_len;
+    char *p = mail->text;
+    memcpy(p, sender, sender_len);
+    p[sender_len] = '\0';
+    p += sender_len + 1;
+    memcpy(p, recipient, recipient_len);
+    p[recipient_len] = '\0';
+    p += recipient_len + 1;
+    memcpy(p, data, data_len);
+    p[data_len] = '\0';
+    return mail;
+}
+
+static mail_t *new_notice(mail_kind_t kind, SOCKET sock, uint32_t serial)
+{
+    return new_mail(kind, sock, serial, MSG_ERROR, 0, "", 0, "", 0, "", 0);
+}
+
+static mail_t *new_frame_mail(SOCKET sock, uint32_t serial, const message_t *frame, size_t data_len)
+{
+    return new_mail(MAIL_SEND, sock, serial, frame->type, frame->request_id,
+                    frame->sender, strnlen(frame->sender, sizeof(frame->sender)),
+                    frame->recipient, strnlen(frame->recipient, sizeof(frame->recipient)),
+                    frame->data, data_len);
+}
+
+static uint32_t current_serial(SOCKET sock)
+{
+    return __atomic_load_n(&conn_serial[sock], __ATOMIC_ACQUIRE);
+}
+
+/* Lobby routes: its sends become mail to the reactor owning the socket */
+
+static reactor_t *owner_of(SOCKET sock)
+{
+    if (sock < 0 || sock >= FD_SETSIZE) return NULL;
+    return &reactors[lobby_owner[sock]];
+}
+
+static int route_send(SOCKET sock, const message_t *frame, size_t data_len)
+{
+    reactor_t *r = owner_of(sock);
+    if (!r) return -1;
+    mail_t *mail = new_frame_mail(sock, known_serial[sock], frame, data_len);
+    mailbox_push(&r->inbox, &mail->node);
+    return 0;
+}
+
+static void route_set_encoding(SOCKET sock, protocol_encoding_t encoding)
+{
+    reactor_t *r = owner_of(sock);
+    if (!r) return;
+    mail_t *mail = new_notice(MAIL_ENCODING, sock, known_serial[sock]);
+    mail->value = (int)encoding;
+    mailbox_push(&r->inbox, &mail->node);
+}
+
+static void route_close(SOCKET sock)
+{
+    reactor_t *r = owner_of(sock);
+    if (!r) return;
+    closed_serial[sock] = known_serial[sock];
+    mail_t *mail = new_notice(MAIL_CLOSE, sock, known_serial[sock]);
+    mailbox_push(&r->inbox, &mail->node);
+}
+
+static const protocol_route_t lobby_route = { route_send, route_set_encoding, route_close, NULL };
+
+/* Reactor side */
+
+static void post(mail_t *mail)
+{
+    mailbox_push(&lobby_inbox, &mail->node);
+}
+
+// Keep a mail for a connection on its way here, until it is adopted.
+static void hold(mail_t *mail)
+{
+    SOCKET sock = mail->sock;
+    mail->next = NULL;
+    if (self->held_tail[sock]) self->held_tail[sock]->next = mail;
+    else self->held[sock] = mail;
+    self->held_tail[sock] = mail;
+}
+
+/* Reactor routes: the sessions running here write their own connections
+ * directly. What they send to a connection of another reactor, such as a
+ * player also in a game there, is passed on by the lobby, which knows where
+ * the connection is; a connection on its way here waits for its adoption. */
+
+static int reactor_local(SOCKET sock)
+{
+    return sock >= 0 && sock < FD_SETSIZE && self->owned[sock];
+}
+
+static int reactor_route_send(SOCKET sock, const message_t *frame, size_t data_len)
+{
+    if (sock < 0 || sock >= FD_SETSIZE) return -1;
+    mail_t *mail = new_frame_mail(sock, self->peer[sock], frame, data_len);
+    if (self->arriving[sock] && self->arriving[sock] == mail->serial) {
+        hold(mail);
+    } else {
+        post(mail);
+    }
+    return 0;
+}
+
+/* Encodings and closes are the lobby's */
+static void reactor_route_set_encoding(SOCKET sock, protocol_encoding_t encoding)
+{
+    (void)sock;
+    (void)encoding;
+}
+
+static void reactor_route_close(SOCKET sock)
+{
+    (void)sock;
+}
+
+static const protocol_route_t reactor_route = {
+    reactor_route_send, reactor_route_set_encoding, reactor_route_close, reactor_local
+};
+
+// The peer is gone or sent garbage: stop reading and tell the lobby, which
+// answers with a close.
+static void connection_lost(SOCKET sock)
+{
+    if (self->closing[sock]) return;
+    self->closing[sock] = 1;
+    uring_forget(sock);
+    FD_CLR(sock, &self->socks);
+    post(new_notice(MAIL_CLOSED, sock, current_serial(sock)));
+}
+
+// Handle every complete message buffered for the socket: those the filter
+// does not take here go to the lobby.
+static void forward_messages(SOCKET sock)
+{
+    uint32_t serial = current_serial(sock);
+    message_view_t msg;
+    int status;
+    while ((status = protocol_next(sock, &msg)) > 0) {
+        if (filter && filter(sock, msg)) continue;
+        post(new_mail(MAIL_MESSAGE, sock, serial, msg.type, msg.request_id,
+                      msg.sender, strlen(msg.sender), msg.recipient, strlen(msg.recipient),
+                      msg.data, strlen(msg.data)));
+    }
+    if (status < 0) {
+        printf("Malformed message on connection %d\n", sock);
+        connection_lost(sock);
+    }
+}
+
+// Start reading a connection, unless it is lost.
+static void watch(SOCKET sock)
+{
+    if (self->closing[sock]) return;
+    if (self->use_uring) {
+        if (uring_recv(sock) < 0) connection_lost(sock);
+    } else {
+        FD_SET(sock, &self->socks);
+        if (sock > self->max_fd) self->max_fd = sock;
+    }
+}
+
+// Take a new connection: from now on this reactor reads and writes it.
+static void accept_connection(SOCKET sock)
+{
+    if (sock >= FD_SETSIZE) {
+        fprintf(stderr, "Too many connections, refusing one\n");
+        net_close(sock);
+        return;
+    }
+    if (protocol_reset(sock) < 0) {
+        fprintf(stderr, "Out of memory, refusing a connection\n");
+        net_close(sock);
+        return;
+    }
+    char from[64];
+    net_peer_name(sock, from, sizeof(from));
+    printf("New connection from %s\n", from);
+
+    __atomic_add_fetch(&conn_serial[sock], 1, __ATOMIC_ACQ_REL);
+    self->owned[sock] = 1;
+    self->closing[sock] = 0;
+    self->moving[sock] = 0;
+    net_set_nodelay(sock);
+    watch(sock);
+}
+
+// Give a connection no longer read here to the reactor `to`: what is queued
+// goes out first, the receive buffer and encoding go along.
+static void hand_off(SOCKET sock, int to)
+{
+    protocol_release(sock);
+    self->owned[sock] = 0;
+    self->moving[sock] = 0;
+    mail_t *mail = new_notice(MAIL_ADOPT, sock, current_serial(sock));
+    mail->value = self->closing[sock];
+    mailbox_push(&reactors[to].inbox, &mail->node);
+}
+
+static void take_mail(mail_t *mail);
+
+// Carry out one mail about a connection owned here.
+static void carry_out(mail_t *mail)
+{
+    SOCKET sock = mail->sock;
+    switch (mail->kind) {
+    case MAIL_SEND:
+        if (!self->closing[sock]) {
+            const char *recipient = mail->text + mail->sender_len + 1;
+            protocol_set_request_id(sock, mail->request_id);
+            protocol_send_n(sock, mail->type, mail->text, recipient,
+                            recipient + mail->recipient_len + 1, mail->data_len);
+            protocol_set_request_id(sock, 0);
+        }
+        break;
+    case MAIL_ENCODING:
+        protocol_set_encoding(sock, (protocol_encoding_t)mail->value);
+        break;
+    case MAIL_CLOSE:
+        if (self->closing[sock]) {
+            protocol_sent(sock);    /* nobody left to send to */
+        } else {
+            self->closing[sock] = 1;
+            uring_forget(sock);
+            FD_CLR(sock, &self->socks);
+        }
+        protocol_close(sock);
+        self->owned[sock] = 0;
+        break;
+    case MAIL_MIGRATE:
+        FD_CLR(sock, &self->socks);
+        /* A live io_uring receive first delivers what it already has */
+        if (self->use_uring && !self->closing[sock]) {
+            self->moving[sock] = 1;
+            self->moving_to[sock] = mail->value;
+            uring_release(sock);
+        } else {
+            hand_off(sock, mail->value);
+        }
+        break;
+    case MAIL_ADOPT: {
+        self->owned[sock] = 1;
+        self->arriving[sock] = 0;
+        self->closing[sock] = (unsigned char)mail->value;
+        self->moving[sock] = 0;
+        watch(sock);
+        /* Then what was sent to it meanwhile, in order, and what it sent */
+        mail_t *held = self->held[sock];
+        self->held[sock] = self->held_tail[sock] = NULL;
+        while (held) {
+            mail_t *next = held->next;
+            take_mail(held);
+            held = next;
+        }
+        if (!self->closing[sock]) forward_messages(sock);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// Carry out a mail, or hold it while its connection is still on its way here
+// from another reactor; the lobby already sends there.
+static void take_mail(mail_t *mail)
+{
+    SOCKET sock = mail->sock;
+    if (mail->kind == MAIL_CALL) {
+        mail->call(mail->arg);
+        free(mail);
+        return;
+    }
+    if (mail->serial != current_serial(sock)) {
+        free(mail);     /* for a connection already closed */
+        return;
+    }
+    if (mail->kind == MAIL_EXPECT) {
+        self->arriving[sock] = mail->serial;
+        free(mail);
+        return;
+    }
+    if (mail->kind != MAIL_ADOPT && !self->owned[sock]) {
+        if (self->arriving[sock] == mail->serial) {
+            hold(mail);
+        } else {
+            free(mail);     /* closed here */
+        }
+        return;
+    }
+    carry_out(mail);
+    free(mail);
+}
+
+// Carry out what the lobby and the other reactors asked, in the order they asked.
+static void read_mail(void)
+{
+    mailbox_ack(&self->inbox);
+    mailbox_node_t *node;
+    while ((node = mailbox_pop(&self->inbox)) != NULL) {
+        take_mail((mail_t*)node);
+    }
+}
+
+/* io_uring loop handlers */
+static void reactor_accepted(SOCKET sock)
+{
+    accept_connection(sock);
+}
+
+static void reactor_received(SOCKET sock, const char *data, size_t len)
+{
+    if (sock < 0 || sock >= FD_SETSIZE || self->closing[sock]) return;
+    if (len == 0) {
+        connection_lost(sock);
+    } else if (protocol_feed(sock, data, len) < 0) {
+        printf("Receive buffer overflow on connection %d\n", sock);
+        connection_lost(sock);
+    } else if (!self->moving[sock]) {
+        forward_messages(sock);     /* else decoded by the next reactor, in order */
+    }
+}
+
+static void reactor_ready(int fd)
+{
+    (void)fd;
+    read_mail();
+}
+
+static void reactor_released(SOCKET sock)
+{
+    hand_off(sock, self->moving_to[sock]);
+}
+
+static int run_uring_loop(void)
+{
+    static const uring_handlers_t handlers = { reactor_accepted, reactor_received, reactor_ready, reactor_released };
+    for (int i = 0; i < self->num_listeners; i++) {
+        if (uring_accept(self->listeners[i]) < 0) return -1;
+    }
+    if (uring_poll(mailbox_fd(&self->inbox)) < 0) return -1;
+    while (1) {
+        uring_flush();
+        if (uring_wait(&handlers) < 0) return -1;
+    }
+}
+
+static int run_select_loop(void)
+{
+    int inbox_fd = mailbox_fd(&self->inbox);
+    FD_ZERO(&self->socks);
+    self->max_fd = inbox_fd;
+    for (int i = 0; i < self->num_listeners; i++) {
+        if (self->listeners[i] > self->max_fd) self->max_fd = self->listeners[i];
+    }
+
+    while (1) {
+        protocol_flush_all();
+
+        fd_set readfds = self->socks;
+        for (int i = 0; i < self->num_listeners; i++) FD_SET(self->listeners[i], &readfds);
+        FD_SET(inbox_fd, &readfds);
+        if (select(self->max_fd + 1, &readfds, NULL, NULL, NULL) < 0) {
+            if (errno == EINTR) continue;
+            perror("select");
+            return -1;
+        }
+
+        for (int i = 0; i < self->num_listeners; i++) {
+            if (!FD_ISSET(self->listeners[i], &readfds)) continue;
+            SOCKET sock = net_accept_connection(self->listeners[i]);
+            if (sock != INVALID_SOCKET) accept_connection(sock);
+        }
+        if (FD_ISSET(inbox_fd, &readfds)) {
+            read_mail();
+        }
+        for (SOCKET sock = 0; sock <= self->max_fd; sock++) {
+            if (!FD_ISSET(sock, &readfds) || !FD_ISSET(sock, &self->socks)) continue;
+            if (protocol_fill(sock) <= 0) {
+                connection_lost(sock);
+            } else {
+                forward_messages(sock);
+            }
+        }
+    }
+}
+
+// Reactor thread body: the event loop over its listening socket, its
+// connections and its inbox. Never returns but on a fatal error.
+static void *reactor_main(void *arg)
+{
+    self = arg;
+    protocol_set_route(&reactor_route);
+    if (self->use_uring && uring_init() < 0) {
+        printf("Reactor %d: io_uring unavailable (%s), using select\n", self->index, strerror(errno));
+        self->use_uring = 0;
+    }
+    int status = self->use_uring ? run_uring_loop() : run_select_loop();
+    if (status < 0) {
+        fprintf(stderr, "Reactor %d: event loop failed\n", self->index);
+        exit(EXIT_FAILURE);
+    }
+    return NULL;
+}
+
+// Start `count` reactors listening on `port` at each of the `num_hosts`
+// addresses in `hosts` (all interfaces when there are none), on io_uring
+// when `use_uring` and the kernel allows it. Every reactor has its own
+// sockets on each address. The first one also accepts on `unix_sock`, a
+// listening Unix domain socket (INVALID_SOCKET for none): local clients are
+// few, and sessions spread their connections anyway. Reactors offer each
+// message they decode to `local` first. From then on the calling thread is
+// the lobby: its sends are routed to the reactors. Returns 0, or -1 on error.
+int reactors_start(int count, const char *const *hosts, int num_hosts, int port, SOCKET unix_sock, int use_uring,
+                   reactor_filter_t local)
+{
+    if (count < 1 || count > MAX_REACTORS) {
+        fprintf(stderr, "The number of reactors must be between 1 and %d\n", MAX_REACTORS);
+        return -1;
+    }
+    if (mailbox_init(&lobby_inbox) < 0) return -1;
+    filter = local;
+
+    /* Bind every listening socket before any reactor accepts */
+    for (int i = 0; i < count; i++) {
+        reactor_t *r = &reactors[i];
+        r->index = i;
+        r->use_uring = use_uring;
+        if (mailbox_init(&r->inbox) < 0) return -1;
+        r->num_listeners = 0;
+        for (int h = 0; h < (num_hosts > 0 ? num_hosts : 1); h++) {
+            int n = net_listen_address(num_hosts > 0 ? hosts[h] : NULL, port, MAX_CLIENTS, 1,
+                                       r->listeners + r->num_listeners, NET_MAX_LISTENERS - 1 - r->num_listeners);
+            if (n <= 0) return -1;
+            r->num_listeners += n;
+        }
+        if (i == 0 && unix_sock != INVALID_SOCKET) r->listeners[r->num_listeners++] = unix_sock;
+        num_reactors++;
+    }
+
+    protocol_set_route(&lobby_route);
+    for (int i = 0; i < count; i++) {
+        int err = pthread_create(&reactors[i].thread, NULL, reactor_main, &reactors[i]);
+        if (err != 0) {
+            fprintf(stderr, "pthread_create: %s\n", strerror(err));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int reactors_count(void)
+{
+    return num_reactors;
+}
+
+// The reactor running the calling thread, -1 on the lobby.
+int reactors_self(void)
+{
+    return self ? self->index : -1;
+}
+
+// Run `fn(arg)` on the reactor `reactor`, or on the lobby for -1, after
+// what the caller already asked of it.
+void reactors_call(int reactor, void (*fn)(void *arg), void *arg)
+{
+    mail_t *mail = new_notice(MAIL_CALL, INVALID_SOCKET, 0);
+    mail->call = fn;
+    mail->arg = arg;
+    mailbox_push(reactor < 0 ? &lobby_inbox : &reactors[reactor].inbox, &mail->node);
+}
+
+// Lobby side: the reactor doing the I/O of a connection, -1 without reactors.
+int reactors_owner(SOCKET sock)
+{
+    if (num_reactors == 0 || sock < 0 || sock >= FD_SETSIZE) return -1;
+    return lobby_owner[sock];
+}
+
+// Lobby side: the connection on `sock`, for a session to address it
+// (reactors_address). 0 without reactors.
+uint32_t reactors_serial(SOCKET sock)
+{
+    if (num_reactors == 0 || sock < 0 || sock >= FD_SETSIZE) return 0;
+    return known_serial[sock];
+}
+
+// Lobby side: move a connection to another reactor. The lobby's mail for it
+// goes there from now on; the new reactor holds it until the old one is
+// done with the connection and hands it over.
+void reactors_migrate(SOCKET sock, int reactor)
+{
+    if (num_reactors == 0 || sock < 0 || sock >= FD_SETSIZE) return;
+    if (reactor < 0 || reactor >= num_reactors || lobby_owner[sock] == reactor) return;
+    if (closed_serial[sock] == known_serial[sock]) return;
+    mail_t *mail = new_notice(MAIL_EXPECT, sock, known_serial[sock]);
+    mailbox_push(&reactors[reactor].inbox, &mail->node);
+    mail = new_notice(MAIL_MIGRATE, sock, known_serial[sock]);
+    mail->value = reactor;
+    mailbox_push(&reactors[lobby_owner[sock]].inbox, &mail->node);
+    lobby_owner[sock] = reactor;
+}
+
+// Before sending to `sock` from a reactor: what follows goes to connection
+// `serial` (from reactors_serial) wherever it is. Returns 0 if that
+// connection is known to be gone, 1 otherwise, and always 1 off the reactors.
+int reactors_address(SOCKET sock, uint32_t serial)
+{
+    if (!self || sock < 0 || sock >= FD_SETSIZE) return 1;
+    self->peer[sock] = serial;
+    if (self->owned[sock]) return !self->closing[sock] && current_serial(sock) == serial;
+    return 1;
+}
+
+int reactors_fd(void)
+{
+    return mailbox_fd(&lobby_inbox);
+}
+
+// Lobby side: hand every message and lost connection posted by the reactors
+// to the handlers, dropping mail about connections the lobby already closed.
+// Calls are run, and frames a reactor sends to a connection of another one
+// passed on to it.
+void reactors_dispatch(const reactor_handlers_t *handlers)
+{
+    mailbox_ack(&lobby_inbox);
+    mailbox_node_t *node;
+    while ((node = mailbox_pop(&lobby_inbox)) != NULL) {
+        mail_t *mail = (mail_t*)node;
+        SOCKET sock = mail->sock;
+        if (mail->kind == MAIL_CALL) {
+            mail->call(mail->arg);
+        } else if (mail->kind == MAIL_SEND) {
+            if (mail->serial == known_serial[sock] && mail->serial != closed_serial[sock]) {
+                mailbox_push(&reactors[lobby_owner[sock]].inbox, &mail->node);
+                continue;
+            }
+        } else if (mail->serial != closed_serial[sock]) {
+            if (mail->serial != known_serial[sock]) {
+                known_serial[sock] = mail->serial;      /* a new connection */
+                lobby_owner[sock] = mail->reactor;
+            }
+            if (mail->kind == MAIL_MESSAGE) {
+                message_view_t msg;
+                msg.type = mail->type;
+                msg.request_id = mail->request_id;
+                msg.sender = mail->text;
+                msg.recipient = msg.sender + mail->sender_len + 1;
+                msg.data = msg.recipient + mail->recipient_len + 1;
+                handlers->message(sock, msg);
+            } else if (mail->kind == MAIL_CLOSED) {
+                handlers->closed(sock);
+            }
+        }
+        free(mail);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef SERVER_REACTOR_H
+#define SERVER_REACTOR_H
+
+#include <stdint.h>
+#include "../common/net.h"
+#include "../common/protocol.h"
+
+/* Network reactors: threads that own the client connections.
+ *
+ * Each reactor has its own listening sockets on the server port, one per
+ * listening address (SO_REUSEPORT, so the kernel spreads new connections
+ * over the reactors) and its own event loop, on io_uring or select. It reads and decodes the messages of its
+ * connections and encodes and writes what is sent to them, so the system
+ * calls and the protocol work scale with the number of reactors.
+ *
+ * Players and accounts stay owned by the thread that called reactors_start
+ * (the lobby). Reactors post it the messages received, and its sends are
+ * routed (protocol_set_route) to the reactor owning the socket; both ways go
+ * through lock-free mailboxes. A connection is only closed by its reactor,
+ * once the lobby answers its `closed` handler with protocol_close, so a
+ * descriptor is never reused while the lobby still knows it.
+ *
+ * Game sessions run on reactors: the lobby moves the connections of a game
+ * to one reactor (reactors_migrate) and hands it the game (reactors_call).
+ * That reactor's filter takes the messages of the game it decodes, and the
+ * game writes to its connections without any mail. A connection held on
+ * another reactor, by a player in several games, is written through the
+ * lobby, which passes the frames on. */
+
+typedef struct {
+    void (*message)(SOCKET sock, message_view_t msg);
+    void (*closed)(SOCKET sock);    /* peer gone or malformed input */
+} reactor_handlers_t;
+
+/* Reactor side: handle a decoded message on the reactor and return 1, or
+ * return 0 to post it to the lobby */
+typedef int (*reactor_filter_t)(SOCKET sock, message_view_t msg);
+
+int reactors_start(int count, const char *const *hosts, int num_hosts, int port, SOCKET unix_sock, int use_uring,
+                   reactor_filter_t local);
+int reactors_count(void);
+int reactors_self(void);
+void reactors_call(int reactor, void (*fn)(void *arg), void *arg);
+
+/* Lobby side: select on reactors_fd(), then call reactors_dispatch() */
+int reactors_fd(void);
+void reactors_dispatch(const reactor_handlers_t *handlers);
+
+/* Lobby side: where connections are, and moving them */
+int reactors_owner(SOCKET sock);
+uint32_t reactors_serial(SOCKET sock);
+void reactors_migrate(SOCKET sock, int reactor);
+
+/* Reactor side: before writing to a connection it may not own */
+int reactors_address(SOCKET sock, uint32_t serial);
+
+#endif
@@ -9,9 +9,18 @@
 #include "../common/net.h"
 #include "../common/protocol.h"
 #include "../game/awale.h"
+#include "../game/tablebase.h"
+#include "../game/book.h"
+#include "../game/nn.h"
 #include "session.h"
+#include "workers.h"
+#include "bot.h"
+#include "analysis.h"
+#include "uring.h"
+#include "reactor.h"
 
 #define MAX_PLAYERS 100 // Maximum connected players
+#define MAX_LISTEN_HOSTS 8      /* --listen addresses */
 #define MAX_PENDING_CHALLENGES 10 /* Max pending challengers stored per player */
 
 typedef struct {
@@ -20,6 +29,7 @@ typedef struct {
     int in_game; /* 0 = not in game, 1+ = in game */
     int num_pending_challengers;
     char pending_challengers[MAX_PENDING_CHALLENGES][64];
+    int pending_variants[MAX_PENDING_CHALLENGES]; /* rule variant each challenger asked for */
     int num_pending_friend_requests;
     char pending_friend_requests[MAX_PENDING_CHALLENGES][64];
     char bio[BUF_SIZE];
@@ -29,6 +39,17 @@ typedef struct {
 static player_t players[MAX_PLAYERS];
 static int num_players = 0;
 
+/* Command line options */
+static int opt_ponder = 0;      /* concurrent ponder searches, 0 = no pondering */
+static int opt_ponder_ms = 0;   /* per-search ponder cap, 0 = bot default */
+static int opt_search_threads = 1;  /* threads per bot or analysis search */
+static int opt_select = 0;      /* keep the select loop even where io_uring works */
+static int opt_reactors = 0;    /* network threads, 0 = all I/O on the main thread */
+static const char *opt_unix_path = NULL;    /* Unix domain socket to listen on too */
+static const char *opt_listen[MAX_LISTEN_HOSTS];    /* addresses to listen on, none = all */
+static int opt_num_listen = 0;
+static int opt_port = DEFAULT_PORT;
+
 
 #define ACCOUNTS_FILE "accounts.db"
 #define MAX_ACCOUNTS 1000 
@@ -50,14 +71,31 @@ static int add_account(const char *name, const char *hash, const char *bio);
 static int save_accounts(void);
 static void escape_string(const char *in, char *out, int out_size);
 static void unescape_string(const char *in, char *out, int out_size);
+static void parse_args(int argc, char **argv);
 static void init_server(void);
 static void cleanup_server(void);
 static void run_server(void);
+static SOCKET open_unix_listener(const char *path);
+static int open_listeners(SOCKET *socks, int max);
+static void run_select_loop(const SOCKET *listeners, int num_listeners);
+static void run_uring_loop(const SOCKET *listeners, int num_listeners);
+static void run_lobby_loop(void);
 static int add_player(SOCKET sock, const char *name);
 static void remove_player(int index);
 static player_t* find_player_by_name(const char *name);
-static void handle_new_connection(SOCKET server_sock);
-static void handle_client_message(int player_index);
+static int find_player_index_by_sock(SOCKET sock);
+static void handle_new_connection(SOCKET listen_sock);
+static int start_connection(SOCKET client_sock);
+static void close_connection(SOCKET client_sock);
+static void handle_login(SOCKET client_sock);
+static void process_login(SOCKET client_sock, message_view_t msg);
+static void handle_client_input(int player_index);
+static void dispatch_client_messages(int player_index);
+static void disconnect_player(int player_index);
+static void accept_login(int player_index, const char *text, const char *client_hello);
+static void handle_client_message(int player_index, message_view_t msg);
+static void session_ended(int session_id);
+static int reactor_message(SOCKET sock, message_view_t msg);
 void hash_password(const char *password, char *hashed_password);
 
 /* Account store helpers */
@@ -109,7 +147,7 @@ static int find_account_index(const char *name)
 // Add a new account to memory and persist to disk.
 static int add_account(const char *name, const char *hash, const char *bio)
 {
-    if (num_accounts >= MAX_ACCOUNTS) return -1;
+    if (num_accounts >= MAX_ACCOUNTS || strlen(name) > PROTOCOL_NAME_MAX) return -1;
     strncpy(accounts[num_accounts].name, name, sizeof(accounts[num_accounts].name)-1);
     accounts[num_accounts].name[sizeof(accounts[num_accounts].name)-1] = '\0';
     strncpy(accounts[num_accounts].hash, hash, sizeof(accounts[num_accounts].hash)-1);
@@ -239,8 +277,9 @@ static void unescape_string(const char *in, char *out, int out_size)
 }
 
 // Program entry point: initialize server, run main loop, cleanup on exit.
-int main()
+int main(int argc, char **argv)
 {
+    parse_args(argc, argv);
     printf("=== Awale Game Server ===\n");
     printf("Initializing...\n");
     
@@ -251,57 +290,200 @@ int main()
     return EXIT_SUCCESS;
 }
 
+// Parse command line options; exits with a usage message on error.
+static void parse_args(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ponder") == 0 && i + 1 < argc) {
+            opt_ponder = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ponder-ms") == 0 && i + 1 < argc) {
+            opt_ponder_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--search-threads") == 0 && i + 1 < argc) {
+            opt_search_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--select") == 0) {
+            opt_select = 1;
+        } else if (strcmp(argv[i], "--reactors") == 0 && i + 1 < argc) {
+            opt_reactors = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--unix") == 0 && i + 1 < argc) {
+            opt_unix_path = argv[++i];
+        } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc && opt_num_listen < MAX_LISTEN_HOSTS) {
+            opt_listen[opt_num_listen++] = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            opt_port = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--ponder searches] [--ponder-ms ms] [--search-threads threads]\n"
+                            "       [--select] [--reactors threads] [--listen address]... [--port port] [--unix path]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
 // Initialize networking, sessions and load persistent data.
 static void init_server(void)
 {
     net_init();
-    sessions_init();
+    sessions_init(session_ended);
     load_accounts();
     srand((unsigned)time(NULL));
     memset(players, 0, sizeof(players));
     num_players = 0;
+    if (bot_init(session_bot_move) < 0) {
+        fprintf(stderr, "Failed to start bot workers\n");
+        exit(EXIT_FAILURE);
+    }
+    if (opt_ponder > 0) {
+        bot_set_ponder(opt_ponder, opt_ponder_ms);
+        printf("Bot pondering enabled (%d concurrent searches)\n", opt_ponder);
+    }
+    analysis_init(session_analysis_ready, session_analysis_wanted);
+    if (opt_search_threads > 1) {
+        bot_set_threads(opt_search_threads);
+        analysis_set_threads(opt_search_threads);
+        printf("Bot and analysis searches use %d threads each\n", opt_search_threads);
+    }
+
+    /* Endgame tablebase is optional: bots and analysis just search without it */
+    int tb_seeds = tb_open(TB_DEFAULT_FILE);
+    if (tb_seeds >= 0) {
+        printf("Loaded endgame tablebase %s (up to %d seeds)\n", TB_DEFAULT_FILE, tb_seeds);
+    } else {
+        printf("No endgame tablebase (%s), generate one with awale_tbgen\n", TB_DEFAULT_FILE);
+    }
+    if (book_open(BOOK_DEFAULT_FILE) == 0) {
+        printf("Loaded opening book %s (%zu entries)\n", BOOK_DEFAULT_FILE, book_size());
+    }
+    if (nn_load(NN_DEFAULT_FILE) == 0) {
+        printf("Loaded evaluation network %s\n", NN_DEFAULT_FILE);
+    }
+    ai_weights_t weights;
+    if (ai_weights_load(AI_WEIGHTS_FILE, &weights) == 0) {
+        bot_set_weights(&weights);
+        printf("Loaded tuned evaluation weights %s\n", AI_WEIGHTS_FILE);
+    }
 }
 
 // Close client sockets and clean up networking resources.
 static void cleanup_server(void)
 {
     for (int i = 0; i < num_players; i++) {
-        net_close(players[i].sock);
+        protocol_close(players[i].sock);
     }
     
+    if (opt_unix_path) unlink(opt_unix_path);
+    uring_shutdown();
+    analysis_shutdown();
+    bot_shutdown();
+    tb_close();
+    book_close();
+    nn_unload();
     net_cleanup();
 }
 
-// Main server loop: accept connections and dispatch client messages.
+// Main server loop: listen, then accept connections and dispatch client
+// messages on io_uring where the kernel supports it, on select otherwise.
+// With reactors, they do the listening and the network I/O instead and this
+// thread handles the messages they pass on.
 static void run_server(void)
 {
-    SOCKET server_sock = net_create_socket();
-    if (server_sock == INVALID_SOCKET) {
-        fprintf(stderr, "Failed to create server socket\n");
+    SOCKET unix_sock = INVALID_SOCKET;
+    if (opt_unix_path) {
+        unix_sock = open_unix_listener(opt_unix_path);
+        printf("Server listening on %s\n", opt_unix_path);
+    }
+
+    if (opt_reactors > 0) {
+        if (reactors_start(opt_reactors, opt_listen, opt_num_listen, opt_port, unix_sock, !opt_select, reactor_message) < 0) {
+            fprintf(stderr, "Failed to start the network reactors\n");
+            exit(EXIT_FAILURE);
+        }
+        printf("Server listening on port %d with %d reactor(s) on %s\n",
+               opt_port, opt_reactors, opt_select ? "select" : "io_uring");
+        printf("Press Ctrl+C to stop\n\n");
+        run_lobby_loop();
+        return;
+    }
+
+    SOCKET listeners[NET_MAX_LISTENERS];
+    int num_listeners = open_listeners(listeners, NET_MAX_LISTENERS - 1);
+    if (num_listeners <= 0) {
+        fprintf(stderr, "Failed to listen on port %d\n", opt_port);
         exit(EXIT_FAILURE);
     }
+    if (unix_sock != INVALID_SOCKET) listeners[num_listeners++] = unix_sock;
+
+    if (!opt_select && uring_init() == 0) {
+        printf("Network I/O: io_uring\n");
+        printf("Press Ctrl+C to stop\n\n");
+        run_uring_loop(listeners, num_listeners);
+    } else {
+        if (!opt_select) printf("io_uring unavailable (%s)\n", strerror(errno));
+        printf("Network I/O: select\n");
+        printf("Press Ctrl+C to stop\n\n");
+        run_select_loop(listeners, num_listeners);
+    }
     
-    if (net_bind_socket(server_sock, DEFAULT_PORT) < 0) {
-        fprintf(stderr, "Failed to bind to port %d\n", DEFAULT_PORT);
-        net_close(server_sock);
+    for (int i = 0; i < num_listeners; i++) net_close(listeners[i]);
+}
+
+// Listen on the port at each --listen address (every address a name resolves
+// to), or on all interfaces over IPv4 and IPv6. Returns the number of
+// sockets, or -1 on error.
+static int open_listeners(SOCKET *socks, int max)
+{
+    if (opt_num_listen == 0) {
+        int count = net_listen_address(NULL, opt_port, MAX_PLAYERS, 0, socks, max);
+        if (count > 0) printf("Server listening on port %d\n", opt_port);
+        return count;
+    }
+    int total = 0;
+    for (int i = 0; i < opt_num_listen; i++) {
+        int count = net_listen_address(opt_listen[i], opt_port, MAX_PLAYERS, 0, socks + total, max - total);
+        if (count <= 0) {
+            for (int k = 0; k < total; k++) net_close(socks[k]);
+            return -1;
+        }
+        printf("Server listening on %s port %d\n", opt_listen[i], opt_port);
+        total += count;
+    }
+    return total;
+}
+
+// Listen on a Unix domain socket too, for bots and gateways on this host:
+// their connections skip the TCP/IP stack and are handled like the others.
+static SOCKET open_unix_listener(const char *path)
+{
+    SOCKET sock = net_create_unix_socket();
+    if (sock == INVALID_SOCKET) {
+        fprintf(stderr, "Failed to create the Unix domain socket\n");
         exit(EXIT_FAILURE);
     }
-    
-    if (net_listen_socket(server_sock, MAX_PLAYERS) < 0) {
-        fprintf(stderr, "Failed to listen on socket\n");
-        net_close(server_sock);
+    if (net_bind_unix(sock, path) < 0 || net_listen_socket(sock, MAX_PLAYERS) < 0) {
+        fprintf(stderr, "Failed to listen on %s\n", path);
+        net_close(sock);
         exit(EXIT_FAILURE);
     }
-    
-    printf("Server listening on port %d\n", DEFAULT_PORT);
-    printf("Press Ctrl+C to stop\n\n");
-    
+    return sock;
+}
+
+// Event loop on select: one scan of the descriptors, then one read per ready socket.
+static void run_select_loop(const SOCKET *listeners, int num_listeners)
+{
     fd_set readfds;
-    int max_fd = server_sock;
+    int worker_fd = workers_fd();
+    int max_fd = worker_fd;
+    for (int i = 0; i < num_listeners; i++) {
+        if (listeners[i] > max_fd) max_fd = listeners[i];
+    }
     
     while (1) {
+        /* Everything the last events produced goes out now, one write per socket */
+        protocol_flush_all();
+
         FD_ZERO(&readfds);
-        FD_SET(server_sock, &readfds);
+        FD_SET(worker_fd, &readfds);
+        for (int i = 0; i < num_listeners; i++) {
+            FD_SET(listeners[i], &readfds);
+        }
         
         for (int i = 0; i < num_players; i++) {
             FD_SET(players[i].sock, &readfds);
@@ -315,155 +497,347 @@ static void run_server(void)
             break;
         }
         
-        if (FD_ISSET(server_sock, &readfds)) {
-            handle_new_connection(server_sock);
+        for (int i = 0; i < num_listeners; i++) {
+            if (FD_ISSET(listeners[i], &readfds)) {
+                handle_new_connection(listeners[i]);
+            }
+        }
+
+        /* Bot searches finished on the worker pool */
+        if (FD_ISSET(worker_fd, &readfds)) {
+            workers_dispatch();
         }
         
         for (int i = 0; i < num_players; i++) {
             if (FD_ISSET(players[i].sock, &readfds)) {
-                handle_client_message(i);
+                handle_client_input(i);
             }
         }
     }
-    
-    net_close(server_sock);
 }
 
-// Accept a new TCP connection and handle initial login/registration.
-static void handle_new_connection(SOCKET server_sock)
+/* io_uring loop handlers. A new connection is read like any other and
+ * logged in by its first message, so no client waits on another's login. */
+static void uring_accepted(SOCKET sock)
+{
+    if (start_connection(sock) < 0 || uring_recv(sock) < 0) protocol_close(sock);
+}
+
+static void uring_received(SOCKET sock, const char *data, size_t len)
+{
+    int index = find_player_index_by_sock(sock);
+    if (len == 0 || protocol_feed(sock, data, len) < 0) {
+        if (index >= 0) disconnect_player(index);
+        else close_connection(sock);
+        return;
+    }
+    if (index < 0) {
+        message_view_t msg;
+        int status = protocol_next(sock, &msg);
+        if (status == 0) return;        /* the login is not all there yet */
+        if (status < 0) {
+            close_connection(sock);
+            return;
+        }
+        process_login(sock, msg);
+        index = find_player_index_by_sock(sock);
+        if (index < 0) return;
+    }
+    dispatch_client_messages(index);
+}
+
+static void uring_ready(int fd)
+{
+    (void)fd;
+    workers_dispatch();
+}
+
+// Event loop on io_uring: completions instead of readiness, so no descriptor
+// scan, no read per socket and all of an iteration's sends in one submission.
+static void run_uring_loop(const SOCKET *listeners, int num_listeners)
+{
+    static const uring_handlers_t handlers = { uring_accepted, uring_received, uring_ready, NULL };
+    for (int i = 0; i < num_listeners; i++) {
+        if (uring_accept(listeners[i]) < 0) {
+            fprintf(stderr, "Failed to start the io_uring loop\n");
+            return;
+        }
+    }
+    if (uring_poll(workers_fd()) < 0) {
+        fprintf(stderr, "Failed to start the io_uring loop\n");
+        return;
+    }
+    while (1) {
+        uring_flush();
+        if (uring_wait(&handlers) < 0) break;
+    }
+}
+
+/* Lobby loop handlers: reactors own the sockets, this thread the players */
+static void lobby_message(SOCKET sock, message_view_t msg)
+{
+    int index = find_player_index_by_sock(sock);
+    protocol_set_request_id(sock, msg.request_id);
+    if (index >= 0) {
+        handle_client_message(index, msg);
+    } else {
+        process_login(sock, msg);
+    }
+    protocol_set_request_id(sock, 0);
+}
+
+static void lobby_closed(SOCKET sock)
+{
+    int index = find_player_index_by_sock(sock);
+    if (index >= 0) {
+        disconnect_player(index);
+    } else {
+        protocol_close(sock);
+    }
+}
+
+// Reactor filter: moves and give ups of a game running on this reactor are
+// handled where they were decoded. Everything else goes to the lobby.
+static int reactor_message(SOCKET sock, message_view_t msg)
+{
+    int handled = 0;
+    protocol_set_request_id(sock, msg.request_id);
+    if (msg.type == MSG_PLAY_MOVE && isdigit((unsigned char)msg.recipient[0])) {
+        handled = session_move_here(atoi(msg.recipient), sock, atoi(msg.data));
+    } else if (msg.type == MSG_GIVE_UP && isdigit((unsigned char)msg.data[0])) {
+        handled = session_give_up_here(atoi(msg.data), sock);
+    }
+    protocol_set_request_id(sock, 0);
+    return handled;
+}
+
+// Event loop of the lobby: messages decoded by the reactors and finished bot
+// searches. Nothing here touches a socket; sends are routed to the reactors.
+static void run_lobby_loop(void)
+{
+    static const reactor_handlers_t handlers = { lobby_message, lobby_closed };
+    fd_set readfds;
+    int mail_fd = reactors_fd();
+    int worker_fd = workers_fd();
+    int max_fd = mail_fd > worker_fd ? mail_fd : worker_fd;
+
+    while (1) {
+        FD_ZERO(&readfds);
+        FD_SET(mail_fd, &readfds);
+        FD_SET(worker_fd, &readfds);
+        if (select(max_fd + 1, &readfds, NULL, NULL, NULL) < 0) {
+            if (errno == EINTR) continue;
+            perror("select");
+            break;
+        }
+        if (FD_ISSET(mail_fd, &readfds)) {
+            reactors_dispatch(&handlers);
+        }
+        if (FD_ISSET(worker_fd, &readfds)) {
+            workers_dispatch();
+        }
+    }
+}
+
+// Accept a new TCP or Unix domain connection and handle initial login/registration.
+static void handle_new_connection(SOCKET listen_sock)
 {
-    SOCKADDR_IN client_addr;
-    SOCKET client_sock = net_accept_connection(server_sock, &client_addr);
+    SOCKET client_sock = net_accept_connection(listen_sock);
     
     if (client_sock == INVALID_SOCKET) {
         return;
     }
-    
-    printf("New connection from %s\n", inet_ntoa(client_addr.sin_addr));
-    
-    message_t msg;
-    if (protocol_recv_message(client_sock, &msg) < 0) {
-        net_close(client_sock);
+    handle_login(client_sock);
+}
+
+// Log a new connection and prepare it for its login message. Returns 0, or
+// -1 when its buffers cannot be allocated.
+static int start_connection(SOCKET client_sock)
+{
+    char from[64];
+    net_peer_name(client_sock, from, sizeof(from));
+    printf("New connection from %s\n", from);
+    net_set_nodelay(client_sock);
+    return protocol_reset(client_sock);
+}
+
+// Close a connection that has no player (yet), stopping its io_uring receive first.
+static void close_connection(SOCKET client_sock)
+{
+    uring_forget(client_sock);
+    protocol_close(client_sock);
+}
+
+// Wait for the login of a new connection, on the select loop.
+static void handle_login(SOCKET client_sock)
+{
+    message_view_t msg;
+    if (start_connection(client_sock) < 0 || protocol_recv(client_sock, &msg) <= 0) {
+        protocol_close(client_sock);
         return;
     }
-    
+    process_login(client_sock, msg);
+
+    /* Handle what the client pipelined behind its login */
+    int index = find_player_index_by_sock(client_sock);
+    if (index >= 0) dispatch_client_messages(index);
+}
+
+// Register or log in the player named by the first message of a connection;
+// the connection is closed when the login is refused.
+static void process_login(SOCKET client_sock, message_view_t msg)
+{
     if (msg.type == MSG_LOGIN) {
         const char *username = msg.sender;
+        protocol_set_request_id(client_sock, msg.request_id);
         const char *password = msg.data;
 
         int acc = find_account_index(username);
-        if (acc >= 0) {
+        if (strlen(username) > PROTOCOL_NAME_MAX) {
+            protocol_sendf(client_sock, MSG_ERROR, "server", username, "Usernames are limited to %d characters", PROTOCOL_NAME_MAX);
+            close_connection(client_sock);
+        } else if (bot_is_bot_name(username)) {
+            protocol_send(client_sock, MSG_ERROR, "server", username, "This username is reserved for a bot");
+            close_connection(client_sock);
+        } else if (acc >= 0) {
             if (strcmp(accounts[acc].hash, password) != 0) {
-                message_t err;
-                protocol_create_message(&err, MSG_ERROR, "server", username, "Invalid password");
-                protocol_send_message(client_sock, &err);
-                net_close(client_sock);
+                protocol_send(client_sock, MSG_ERROR, "server", username, "Invalid password");
+                close_connection(client_sock);
             } else {
                 if (find_player_by_name(username) != NULL) {
-                    message_t err;
-                    protocol_create_message(&err, MSG_ERROR, "server", username, "User already online");
-                    protocol_send_message(client_sock, &err);
-                    net_close(client_sock);
+                    protocol_send(client_sock, MSG_ERROR, "server", username, "User already online");
+                    close_connection(client_sock);
                 } else {
                     int idx = add_player(client_sock, username);
                     if (idx >= 0) {
                         printf("Player '%s' logged in\n", username);
-                        message_t ok_msg;
                         char msg_content[128];
                         snprintf(msg_content, sizeof(msg_content), "Logged as %s", username);
-                        protocol_create_message(&ok_msg, MSG_LOGIN_SUCCESS, "server", username, msg_content);
-                        protocol_send_message(client_sock, &ok_msg);
+                        accept_login(idx, msg_content, msg.recipient);
                     } else {
-                        message_t err;
-                        protocol_create_message(&err, MSG_ERROR, "server", username, "Failed to add player");
-                        protocol_send_message(client_sock, &err);
-                        net_close(client_sock);
+                        protocol_send(client_sock, MSG_ERROR, "server", username, "Failed to add player");
+                        close_connection(client_sock);
                     }
                 }
             }
         } else {
             if (add_account(username, password, "") != 0) {
-                message_t err;
-                protocol_create_message(&err, MSG_ERROR, "server", username, "Failed to register account");
-                protocol_send_message(client_sock, &err);
-                net_close(client_sock);
+                protocol_send(client_sock, MSG_ERROR, "server", username, "Failed to register account");
+                close_connection(client_sock);
             } else {
                 int idx = add_player(client_sock, username);
                 if (idx >= 0) {
                     printf("Registered and logged in new player '%s'\n", username);
-                    message_t ok_msg;
                     char msg_content[128];
                     snprintf(msg_content, sizeof(msg_content), "Account created and logged in");
-                    protocol_create_message(&ok_msg, MSG_LOGIN_SUCCESS, "server", username, msg_content);
-                    protocol_send_message(client_sock, &ok_msg);
+                    accept_login(idx, msg_content, msg.recipient);
                 } else {
-                    message_t err;
-                    protocol_create_message(&err, MSG_ERROR, "server", username, "Failed to add player");
-                    protocol_send_message(client_sock, &err);
-                    net_close(client_sock);
+                    protocol_send(client_sock, MSG_ERROR, "server", username, "Failed to add player");
+                    close_connection(client_sock);
                 }
             }
         }
     } else {
         fprintf(stderr, "Expected login message\n");
-        net_close(client_sock);
+        close_connection(client_sock);
     }
 }
 
-// Process an incoming message from the client at players[player_index].
-static void handle_client_message(int player_index)
+// Confirm a login on the best protocol both sides speak. The confirmation is
+// sent in the legacy encoding; an agreed encoding applies from the next frame on.
+static void accept_login(int player_index, const char *text, const char *client_hello)
 {
-    message_t msg;
-    int result = protocol_recv_message(players[player_index].sock, &msg);
-    
-    if (result <= 0) {
-        printf("Player '%s' disconnected\n", players[player_index].name);
-       
-        if (players[player_index].in_game) {
-            int games[MAX_SESSIONS];
-            int count = session_find_by_player(games, players[player_index].name);
-            for (int i = 0; i < count; i++) {
-                int sid = games[i];
-                const char *opponent_name = (sid >= 0) ? session_get_opponent_name(sid, players[player_index].name) : NULL;
-                player_t *opponent = opponent_name ? find_player_by_name(opponent_name) : NULL;
-
-                if (sid >= 0) {
-                    session_give_up(sid, players[player_index].name);
-                }
+    SOCKET sock = players[player_index].sock;
+    unsigned version, features;
+    if (protocol_parse_hello(client_hello, &version, &features)) {
+        char hello[32];
+        if (version > PROTOCOL_VERSION) version = PROTOCOL_VERSION;
+        features &= PROTOCOL_FEATURES;
+        protocol_format_hello(hello, sizeof(hello), version, features);
+        protocol_send(sock, MSG_LOGIN_SUCCESS, "server", hello, text);
+        if (features & PROTOCOL_FEATURE_COMPACT) protocol_set_encoding(sock, PROTOCOL_COMPACT);
+    } else {
+        protocol_send(sock, MSG_LOGIN_SUCCESS, "server", players[player_index].name, text);
+    }
+}
 
-                if (opponent) {
-                      opponent->in_game--;
-                }
+// Read what the client at players[player_index] sent in one call, then
+// handle every complete message in it; a partial one waits for more data.
+static void handle_client_input(int player_index)
+{
+    if (protocol_fill(players[player_index].sock) <= 0) {
+        disconnect_player(player_index);
+        return;
+    }
+    dispatch_client_messages(player_index);
+}
+
+// Handle the messages already buffered for players[player_index], such as
+// requests pipelined behind the login. Whatever goes back to the player
+// meanwhile carries the request's ID; other recipients see no ID.
+static void dispatch_client_messages(int player_index)
+{
+    SOCKET sock = players[player_index].sock;
+    message_view_t msg;
+    int status;
+    while ((status = protocol_next(sock, &msg)) > 0) {
+        protocol_set_request_id(sock, msg.request_id);
+        handle_client_message(player_index, msg);
+    }
+    protocol_set_request_id(sock, 0);
+    if (status < 0) {
+        printf("Malformed message from '%s'\n", players[player_index].name);
+        disconnect_player(player_index);
+    }
+}
+
+// Give up the games of a player whose connection closed and forget them.
+static void disconnect_player(int player_index)
+{
+    printf("Player '%s' disconnected\n", players[player_index].name);
+   
+    if (players[player_index].in_game) {
+        int games[MAX_SESSIONS];
+        int count = session_find_by_player(games, players[player_index].name);
+        for (int i = 0; i < count; i++) {
+            int sid = games[i];
+            if (sid >= 0) {
+                session_give_up(sid, players[player_index].name);
             }
         }
+    }
 
-        net_close(players[player_index].sock);
-        for (int i = 0; i < num_players; i++) {
-            if (i == player_index) continue;
-            for (int p = 0; p < players[i].num_pending_challengers; p++) {
-                if (strcmp(players[i].pending_challengers[p], players[player_index].name) == 0) {
-                    for (int q = p; q < players[i].num_pending_challengers - 1; q++) {
-                        strncpy(players[i].pending_challengers[q], players[i].pending_challengers[q+1], sizeof(players[i].pending_challengers[q]));
-                    }
-                    players[i].num_pending_challengers--;
-                    p--;
+    uring_forget(players[player_index].sock);
+    protocol_close(players[player_index].sock);
+    for (int i = 0; i < num_players; i++) {
+        if (i == player_index) continue;
+        for (int p = 0; p < players[i].num_pending_challengers; p++) {
+            if (strcmp(players[i].pending_challengers[p], players[player_index].name) == 0) {
+                for (int q = p; q < players[i].num_pending_challengers - 1; q++) {
+                    strncpy(players[i].pending_challengers[q], players[i].pending_challengers[q+1], sizeof(players[i].pending_challengers[q]));
+                    players[i].pending_variants[q] = players[i].pending_variants[q+1];
                 }
+                players[i].num_pending_challengers--;
+                p--;
             }
-            for (int p = 0; p < players[i].num_pending_friend_requests; p++) {
-                if (strcmp(players[i].pending_friend_requests[p], players[player_index].name) == 0) {
-                    for (int q = p; q < players[i].num_pending_friend_requests - 1; q++) {
-                        strncpy(players[i].pending_friend_requests[q], players[i].pending_friend_requests[q+1], sizeof(players[i].pending_friend_requests[q]));
-                    }
-                    players[i].num_pending_friend_requests--;
-                    p--;
+        }
+        for (int p = 0; p < players[i].num_pending_friend_requests; p++) {
+            if (strcmp(players[i].pending_friend_requests[p], players[player_index].name) == 0) {
+                for (int q = p; q < players[i].num_pending_friend_requests - 1; q++) {
+                    strncpy(players[i].pending_friend_requests[q], players[i].pending_friend_requests[q+1], sizeof(players[i].pending_friend_requests[q]));
                 }
+                players[i].num_pending_friend_requests--;
+                p--;
             }
         }
-
-        remove_player(player_index);
-        return;
     }
-    
+
+    remove_player(player_index);
+}
+
+// Process an incoming message from the client at players[player_index].
+static void handle_client_message(int player_index, message_view_t msg)
+{
     switch (msg.type) {
         case MSG_LIST_PLAYERS:
         {
@@ -474,9 +848,8 @@ static void handle_client_message(int player_index)
                 if (offset >= (int)sizeof(list)) break;
             }
             if (offset == 0) snprintf(list, sizeof(list), "No players online\n");
-            message_t out;
-            protocol_create_message(&out, MSG_PLAYER_LIST, "server", players[player_index].name, list);
-            protocol_send_message(players[player_index].sock, &out);
+            bot_list(list, sizeof(list));
+            protocol_send(players[player_index].sock, MSG_PLAYER_LIST, "server", players[player_index].name, list);
         }
             break;
 
@@ -484,9 +857,7 @@ static void handle_client_message(int player_index)
         {
             char list[BUF_SIZE];
             session_list_games(list, sizeof(list));
-            message_t out;
-            protocol_create_message(&out, MSG_GAME_LIST, "server", players[player_index].name, list);
-            protocol_send_message(players[player_index].sock, &out);
+            protocol_send(players[player_index].sock, MSG_GAME_LIST, "server", players[player_index].name, list);
         }
             break;
 
@@ -519,9 +890,7 @@ static void handle_client_message(int player_index)
                     tok = strtok(NULL, ",");
                 }
             }
-            message_t out;
-            protocol_create_message(&out, MSG_FRIENDS_LIST, "server", players[player_index].name, list);
-            protocol_send_message(players[player_index].sock, &out);
+            protocol_send(players[player_index].sock, MSG_FRIENDS_LIST, "server", players[player_index].name, list);
         }
             break;
 
@@ -530,33 +899,27 @@ static void handle_client_message(int player_index)
 
             const char *toadd = msg.data;
             int acc = find_account_index(players[player_index].name);
-            message_t out;
             if (acc < 0) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "Your account was not found. Try later.");
-                protocol_send_message(players[player_index].sock, &out);
+                protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", players[player_index].name, "Your account was not found. Try later.");
                 break;
             }
             int target_acc = find_account_index(toadd);
             if (target_acc < 0) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "User not found");
-                protocol_send_message(players[player_index].sock, &out);
+                protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", players[player_index].name, "User not found");
                 break;
             }
             if (target_acc == acc) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "You cannot add yourself");
-                protocol_send_message(players[player_index].sock, &out);
+                protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", players[player_index].name, "You cannot add yourself");
                 break;
             }
             if (account_has_friend_idx(acc, target_acc)) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "Already a friend");
-                protocol_send_message(players[player_index].sock, &out);
+                protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", players[player_index].name, "Already a friend");
                 break;
             }
 
             player_t *target_player = find_player_by_name(accounts[target_acc].name);
             if (!target_player) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "User is not online");
-                protocol_send_message(players[player_index].sock, &out);
+                protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", players[player_index].name, "User is not online");
                 break;
             }
 
@@ -571,12 +934,9 @@ static void handle_client_message(int player_index)
                 target_player->num_pending_friend_requests++;
             }
 
-            message_t req;
-            protocol_create_message(&req, MSG_FRIEND_REQUEST, players[player_index].name, target_player->name, "");
-            protocol_send_message(target_player->sock, &req);
+            protocol_send(target_player->sock, MSG_FRIEND_REQUEST, players[player_index].name, target_player->name, "");
 
-            protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "Friend request sent");
-            protocol_send_message(players[player_index].sock, &out);
+            protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", players[player_index].name, "Friend request sent");
         }
             break;
 
@@ -585,7 +945,6 @@ static void handle_client_message(int player_index)
             /* msg.sender = acceptor, msg.recipient = original requester */
             int acc_acceptor = find_account_index(msg.sender);
             int acc_requester = find_account_index(msg.recipient);
-            message_t out;
             /* Ensure there was a pending friend request from requester to acceptor */
             player_t *acceptor_player = &players[player_index];
             int found = 0;
@@ -593,26 +952,22 @@ static void handle_client_message(int player_index)
                 if (strcmp(acceptor_player->pending_friend_requests[p], msg.recipient) == 0) { found = 1; break; }
             }
             if (!found) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", msg.sender, "No pending friend request from this user");
-                protocol_send_message(acceptor_player->sock, &out);
+                protocol_send(acceptor_player->sock, MSG_FRIEND_RESULT, "server", msg.sender, "No pending friend request from this user");
                 break;
             }
             if (acc_acceptor < 0 || acc_requester < 0) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", msg.sender, "Account not found");
-                protocol_send_message(players[player_index].sock, &out);
+                protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", msg.sender, "Account not found");
                 break;
             }
 
             /* Add both sides; account_add_friend_idx persists */
             if (account_add_friend_idx(acc_acceptor, acc_requester) != 0) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", msg.sender, "Failed to add friend");
-                protocol_send_message(players[player_index].sock, &out);
+                protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", msg.sender, "Failed to add friend");
                 break;
             }
             if (account_add_friend_idx(acc_requester, acc_acceptor) != 0) {
                 /* best-effort: try to roll back the first add (optional) */
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", msg.sender, "Failed to add friend on other side");
-                protocol_send_message(players[player_index].sock, &out);
+                protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", msg.sender, "Failed to add friend on other side");
                 break;
             }
 
@@ -620,14 +975,12 @@ static void handle_client_message(int player_index)
             player_t *requester_player = find_player_by_name(accounts[acc_requester].name);
             acceptor_player = find_player_by_name(accounts[acc_acceptor].name);
             if (acceptor_player) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", acceptor_player->name, "Friend added");
-                protocol_send_message(acceptor_player->sock, &out);
+                protocol_send(acceptor_player->sock, MSG_FRIEND_RESULT, "server", acceptor_player->name, "Friend added");
             }
             if (requester_player) {
                 char buf[BUF_SIZE];
                 snprintf(buf, sizeof(buf), "%s accepted your friend request", msg.sender);
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", requester_player->name, buf);
-                protocol_send_message(requester_player->sock, &out);
+                protocol_send(requester_player->sock, MSG_FRIEND_RESULT, "server", requester_player->name, buf);
             }
             /* Remove the pending entry from acceptor */
             for (int p = 0; p < acceptor_player->num_pending_friend_requests; p++) {
@@ -645,7 +998,6 @@ static void handle_client_message(int player_index)
         case MSG_FRIEND_REQUEST_REFUSE:
         {
             /* msg.sender = refuser, msg.recipient = original requester */
-            message_t out;
             player_t *refuser = &players[player_index];
             /* Ensure there was a pending request from requester to this refuser */
             int foundr = 0;
@@ -653,16 +1005,14 @@ static void handle_client_message(int player_index)
                 if (strcmp(refuser->pending_friend_requests[p], msg.recipient) == 0) { foundr = 1; break; }
             }
             if (!foundr) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", msg.sender, "No pending friend request from this user");
-                protocol_send_message(refuser->sock, &out);
+                protocol_send(refuser->sock, MSG_FRIEND_RESULT, "server", msg.sender, "No pending friend request from this user");
                 break;
             }
             player_t *requester_player = find_player_by_name(msg.recipient);
             if (requester_player) {
                 char buf[BUF_SIZE];
                 snprintf(buf, sizeof(buf), "%s refused your friend request", msg.sender);
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", msg.recipient, buf);
-                protocol_send_message(requester_player->sock, &out);
+                protocol_send(requester_player->sock, MSG_FRIEND_RESULT, "server", msg.recipient, buf);
             }
             /* Remove the pending entry from refuser */
             for (int p = 0; p < refuser->num_pending_friend_requests; p++) {
@@ -675,8 +1025,7 @@ static void handle_client_message(int player_index)
                 }
             }
             /* Acknowledge to the refuser */
-            protocol_create_message(&out, MSG_FRIEND_RESULT, "server", msg.sender, "Friend request refused");
-            protocol_send_message(players[player_index].sock, &out);
+            protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", msg.sender, "Friend request refused");
         }
             break;
 
@@ -684,51 +1033,70 @@ static void handle_client_message(int player_index)
         {
             const char *torm = msg.data;
             int acc = find_account_index(players[player_index].name);
-            message_t out;
             if (acc < 0) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "Your account was not found. Try later.");
-                protocol_send_message(players[player_index].sock, &out);
+                protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", players[player_index].name, "Your account was not found. Try later.");
                 break;
             }
             int target_acc = find_account_index(torm);
             if (target_acc < 0) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "User not found");
-                protocol_send_message(players[player_index].sock, &out);
+                protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", players[player_index].name, "User not found");
                 break;
             }
             if (!account_has_friend_idx(acc, target_acc)) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "Not in your friends list");
-                protocol_send_message(players[player_index].sock, &out);
+                protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", players[player_index].name, "Not in your friends list");
                 break;
             }
             // remove both sides
+            const char *result;
             if (account_remove_friend_idx(acc, target_acc) == 0 && account_remove_friend_idx(target_acc, acc) == 0) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "Friend removed");
+                result = "Friend removed";
             } else {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "Failed to remove friend");
+                result = "Failed to remove friend";
             }
-            protocol_send_message(players[player_index].sock, &out);
+            protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", players[player_index].name, result);
         }
             break;
             
         case MSG_CHALLENGE:
             {
                 printf("Received challenge from %s to %s\n", msg.sender, msg.recipient);
+                /* The data names the rule variant; empty for the standard rules */
+                int variant = awale_variant_by_name(msg.data);
+                if (variant < 0) {
+                    char reason[BUF_SIZE];
+                    int offset = snprintf(reason, sizeof(reason), "Unknown rules '%s'. Available:", msg.data);
+                    for (int v = 0; v < AWALE_VARIANT_COUNT && offset < (int)sizeof(reason); v++) {
+                        offset += snprintf(reason + offset, sizeof(reason) - offset, " %s", awale_variant_info(v)->name);
+                    }
+                    protocol_send(players[player_index].sock, MSG_ERROR, "server", msg.sender, reason);
+                    break;
+                }
+                /* Bots accept every challenge right away */
+                if (bot_is_bot_name(msg.recipient)) {
+                    if (!bot_plays_variant(msg.recipient, variant)) {
+                        protocol_send(players[player_index].sock, MSG_ERROR, "server", msg.sender, "This bot only plays the standard rules");
+                        break;
+                    }
+                    int session_slot = session_create(players[player_index].name, players[player_index].sock, msg.recipient, INVALID_SOCKET, variant);
+                    if (session_slot == -1) {
+                        protocol_send(players[player_index].sock, MSG_ERROR, "server", msg.sender, "There is no free session slot");
+                        break;
+                    }
+                    players[player_index].in_game++;
+                    printf("%s accepted challenge from %s, session %d created\n", msg.recipient, msg.sender, session_slot);
+                    break;
+                }
                 /* Find the opponent */
                 player_t *opponent = find_player_by_name(msg.recipient);
                 
                 if (!opponent) {
                     /* Player not found */
-                    message_t error;
-                    protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "Player not found");
-                    protocol_send_message(players[player_index].sock, &error);
+                    protocol_send(players[player_index].sock, MSG_ERROR, "server", msg.sender, "Player not found");
                     break;
                 }
                 
                 if (opponent == &(players[player_index])) {
-                    message_t error;
-                    protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "You can't challenge yourself !");
-                    protocol_send_message(players[player_index].sock, &error);
+                    protocol_send(players[player_index].sock, MSG_ERROR, "server", msg.sender, "You can't challenge yourself !");
                     break;
                 }
                 
@@ -736,15 +1104,20 @@ static void handle_client_message(int player_index)
                    Keep a small list (avoid duplicates). */
                 int exists = 0;
                 for (int p = 0; p < opponent->num_pending_challengers; p++) {
-                    if (strcmp(opponent->pending_challengers[p], msg.sender) == 0) { exists = 1; break; }
+                    if (strcmp(opponent->pending_challengers[p], msg.sender) == 0) {
+                        opponent->pending_variants[p] = variant; /* a new challenge replaces the old rules */
+                        exists = 1;
+                        break;
+                    }
                 }
                 if (!exists && opponent->num_pending_challengers < MAX_PENDING_CHALLENGES) {
                     strncpy(opponent->pending_challengers[opponent->num_pending_challengers], msg.sender, sizeof(opponent->pending_challengers[0]) - 1);
                     opponent->pending_challengers[opponent->num_pending_challengers][sizeof(opponent->pending_challengers[0]) - 1] = '\0';
+                    opponent->pending_variants[opponent->num_pending_challengers] = variant;
                     opponent->num_pending_challengers++;
                 }
                 /* Forward challenge to opponent */
-                protocol_send_message(opponent->sock, &msg);
+                protocol_send_challenge(opponent->sock, msg.sender, msg.recipient, msg.data);
                 printf("%s challenges %s\n", msg.sender, msg.recipient);
             }
             break;
@@ -754,33 +1127,31 @@ static void handle_client_message(int player_index)
             player_t *acceptor = &players[player_index];
             player_t *challenger = find_player_by_name(msg.recipient);
             if (!challenger) {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "Challenger not found");
-                protocol_send_message(players[player_index].sock, &error);
+                protocol_send(players[player_index].sock, MSG_ERROR, "server", msg.sender, "Challenger not found");
                 break;
             }
             /* Ensure the acceptor was actually challenged by this challenger (check the pending list) */
             int found = 0;
+            int variant = AWALE_VARIANT_STANDARD;
             for (int p = 0; p < acceptor->num_pending_challengers; p++) {
-                if (strcmp(acceptor->pending_challengers[p], challenger->name) == 0) { found = 1; break; }
+                if (strcmp(acceptor->pending_challengers[p], challenger->name) == 0) {
+                    variant = acceptor->pending_variants[p];
+                    found = 1;
+                    break;
+                }
             }
             if (!found) {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "No pending challenge from this player");
-                protocol_send_message(acceptor->sock, &error);
+                protocol_send(acceptor->sock, MSG_ERROR, "server", msg.sender, "No pending challenge from this player");
                 break;
             }
 
             /* Create session: challenger should be player0 (first argument) */
-            int session_slot = session_create(challenger->name, challenger->sock, acceptor->name, acceptor->sock);
+            int session_slot = session_create(challenger->name, challenger->sock, acceptor->name, acceptor->sock, variant);
             if (session_slot == -1) {
-                message_t error;
                 char reason[BUF_SIZE];
                 snprintf(reason, sizeof(reason), "There is no free session slot");
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, reason);
-                protocol_send_message(acceptor->sock, &error);
-                protocol_create_message(&error, MSG_ERROR, "server", msg.recipient, reason);
-                protocol_send_message(challenger->sock, &error);
+                protocol_send(acceptor->sock, MSG_ERROR, "server", msg.sender, reason);
+                protocol_send(challenger->sock, MSG_ERROR, "server", msg.recipient, reason);
                 break;
             }
 
@@ -792,6 +1163,7 @@ static void handle_client_message(int player_index)
                 if (strcmp(acceptor->pending_challengers[p], challenger->name) == 0) {
                     for (int q = p; q < acceptor->num_pending_challengers - 1; q++) {
                         strncpy(acceptor->pending_challengers[q], acceptor->pending_challengers[q+1], sizeof(acceptor->pending_challengers[q]));
+                        acceptor->pending_variants[q] = acceptor->pending_variants[q+1];
                     }
                     acceptor->num_pending_challengers--;
                     break;
@@ -802,6 +1174,7 @@ static void handle_client_message(int player_index)
                 if (strcmp(challenger->pending_challengers[p], acceptor->name) == 0) {
                     for (int q = p; q < challenger->num_pending_challengers - 1; q++) {
                         strncpy(challenger->pending_challengers[q], challenger->pending_challengers[q+1], sizeof(challenger->pending_challengers[q]));
+                        challenger->pending_variants[q] = challenger->pending_variants[q+1];
                     }
                     challenger->num_pending_challengers--;
                     break;
@@ -816,9 +1189,7 @@ static void handle_client_message(int player_index)
         {
             player_t *challenger = find_player_by_name(msg.recipient);
             if (!challenger) {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "Challenger not found");
-                protocol_send_message(players[player_index].sock, &error);
+                protocol_send(players[player_index].sock, MSG_ERROR, "server", msg.sender, "Challenger not found");
                 break;
             }
 
@@ -831,6 +1202,7 @@ static void handle_client_message(int player_index)
                 if (strcmp(refuser->pending_challengers[p], challenger->name) == 0) {
                     for (int q = p; q < refuser->num_pending_challengers - 1; q++) {
                         strncpy(refuser->pending_challengers[q], refuser->pending_challengers[q+1], sizeof(refuser->pending_challengers[q]));
+                        refuser->pending_variants[q] = refuser->pending_variants[q+1];
                     }
                     refuser->num_pending_challengers--;
                     found = 1;
@@ -839,17 +1211,13 @@ static void handle_client_message(int player_index)
             }
 
             if (!found) {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "No pending challenge from this player");
-                protocol_send_message(refuser->sock, &error);
+                protocol_send(refuser->sock, MSG_ERROR, "server", msg.sender, "No pending challenge from this player");
                 break;
             }
 
-            message_t refuse_msg;
             char reason[BUF_SIZE];
             snprintf(reason, sizeof(reason), "%s refused your challenge", msg.sender);
-            protocol_create_message(&refuse_msg, MSG_CHALLENGE_REFUSE, msg.sender, challenger->name, reason);
-            protocol_send_message(challenger->sock, &refuse_msg);
+            protocol_send(challenger->sock, MSG_CHALLENGE_REFUSE, msg.sender, challenger->name, reason);
             printf("%s refused the challenge from %s\n", msg.sender, challenger->name);
         }
             break;
@@ -863,9 +1231,7 @@ static void handle_client_message(int player_index)
             if (msg.recipient[0] != '\0' && isdigit((unsigned char)msg.recipient[0])) {
                 sid = atoi(msg.recipient);
             } else {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "Invalid session id");
-                protocol_send_message(player.sock, &error);
+                protocol_send(player.sock, MSG_ERROR, "server", msg.sender, "Invalid session id");
                 printf("Did not send session chat from %s: %s because session id was invalid\n", msg.sender, msg.data);
                 break;
             }
@@ -873,35 +1239,18 @@ static void handle_client_message(int player_index)
             /* Verify sender is part of session */
             char p1[64], p2[64];
             if (session_get_players(sid, p1, sizeof(p1), p2, sizeof(p2)) != 0) {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "Invalid session id");
-                protocol_send_message(player.sock, &error);
+                protocol_send(player.sock, MSG_ERROR, "server", msg.sender, "Invalid session id");
                 break;
             }
             if (strcmp(p1, msg.sender) != 0 && strcmp(p2, msg.sender) != 0) {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "You are not part of this session");
-                protocol_send_message(player.sock, &error);
+                protocol_send(player.sock, MSG_ERROR, "server", msg.sender, "You are not part of this session");
                 break;
             }
 
-            const char *opponent_name = session_get_opponent_name(sid, player.name);
-            player_t *opponent = opponent_name ? find_player_by_name(opponent_name) : NULL;
-
+            /* Played on the thread running the game; session_ended clears the in_game flags */
             int move = atoi(msg.data);
-            int flag = session_handle_move(sid, player.name, move);
+            session_play(sid, player.name, move, msg.request_id);
             printf("Move handled for '%s' in session %d\n", player.name, sid);
-            if (flag >= 0) session_broadcast_state(sid);
-
-            // Check for game over
-            if (flag == 1) {
-                    printf("Session %d ended. Clearing in_game flags for '%s'%s\n",
-                        sid, player.name, opponent ? opponent->name : "(unknown opponent)");
-                    player.in_game--;
-                    if (opponent) {
-                        opponent->in_game--;
-                    }
-            }
         }
             break;
 
@@ -915,39 +1264,23 @@ static void handle_client_message(int player_index)
             if (msg.data[0] != '\0' && isdigit((unsigned char)msg.data[0])) {
                 sid = atoi(msg.data);
             } else {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "Invalid session id");
-                protocol_send_message(player.sock, &error);
+                protocol_send(player.sock, MSG_ERROR, "server", msg.sender, "Invalid session id");
                 break;
             }
             /* Verify sender is part of session */
             char p1[64], p2[64];
             if (session_get_players(sid, p1, sizeof(p1), p2, sizeof(p2)) != 0) {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "Invalid session id");
-                protocol_send_message(player.sock, &error);
+                protocol_send(player.sock, MSG_ERROR, "server", msg.sender, "Invalid session id");
                 break;
             }
             if (strcmp(p1, msg.sender) != 0 && strcmp(p2, msg.sender) != 0) {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "You are not part of this session");
-                protocol_send_message(player.sock, &error);
+                protocol_send(player.sock, MSG_ERROR, "server", msg.sender, "You are not part of this session");
                 break;
             }
 
-            /* Determine opponent name before session is destroyed */
-            const char *opponent_name = session_get_opponent_name(sid, player.name);
-            player_t *opponent = opponent_name ? find_player_by_name(opponent_name) : NULL;
-
             /* Perform give up inside session module */
-            if (session_give_up(sid, player.name) == 0) {
-                /* Clear player in_game flags for both participants */
-                player.in_game--;
-                if (opponent) { opponent->in_game--; }
-            } else {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "Failed to process give up");
-                protocol_send_message(player.sock, &error);
+            if (session_give_up(sid, player.name) != 0) {
+                protocol_send(player.sock, MSG_ERROR, "server", msg.sender, "Failed to process give up");
             }
             printf("%s gave up the game\n", player.name);
         }
@@ -958,14 +1291,10 @@ static void handle_client_message(int player_index)
             /* If recipient matches an online player name, treat as private chat */
             player_t *target = find_player_by_name(msg.recipient);
             if (target) {
-                message_t chat;
-                protocol_create_private_chat(&chat, msg.sender, msg.recipient, msg.data);
-                protocol_send_message(target->sock, &chat);
+                protocol_send_private_chat(target->sock, msg.sender, msg.recipient, msg.data);
                 printf("Private message from %s to %s\n", msg.sender, msg.recipient);
             } else {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "No online player with that name");
-                protocol_send_message(players[player_index].sock, &error);
+                protocol_send(players[player_index].sock, MSG_ERROR, "server", msg.sender, "No online player with that name");
                 printf("Private message from %s to unknown recipient %s\n", msg.sender, msg.recipient);
             }
         }
@@ -980,9 +1309,7 @@ static void handle_client_message(int player_index)
             if (msg.recipient[0] != '\0' && isdigit((unsigned char)msg.recipient[0])) {
                 sid = atoi(msg.recipient);
             } else {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "Invalid session id");
-                protocol_send_message(player.sock, &error);
+                protocol_send(player.sock, MSG_ERROR, "server", msg.sender, "Invalid session id");
                 printf("Did not send session chat from %s: %s because session id was invalid\n", msg.sender, msg.data);
                 break;
             }
@@ -990,28 +1317,22 @@ static void handle_client_message(int player_index)
             /* Verify sender is part of session */
             char p1[64], p2[64];
             if (session_get_players(sid, p1, sizeof(p1), p2, sizeof(p2)) != 0) {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "Invalid session id");
-                protocol_send_message(player.sock, &error);
+                protocol_send(player.sock, MSG_ERROR, "server", msg.sender, "Invalid session id");
                 break;
             }
             if (strcmp(p1, msg.sender) != 0 && strcmp(p2, msg.sender) != 0) {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, "Only participants can send session chat");
-                protocol_send_message(player.sock, &error);
+                protocol_send(player.sock, MSG_ERROR, "server", msg.sender, "Only participants can send session chat");
                 break;
             }
 
             /* Build chat message and send to opponent */
-            message_t chat;
             char sid_str[32];
             snprintf(sid_str, sizeof(sid_str), "%d", sid);
-            protocol_create_private_chat(&chat, msg.sender, sid_str, msg.data);
 
             const char *opponent_name = session_get_opponent_name(sid, msg.sender);
             player_t *opponent = opponent_name ? find_player_by_name(opponent_name) : NULL;
             if (opponent) {
-                protocol_send_message(opponent->sock, &chat);
+                protocol_send_private_chat(opponent->sock, msg.sender, sid_str, msg.data);
             }
         }
             break;
@@ -1024,9 +1345,7 @@ static void handle_client_message(int player_index)
             else if (msg.data[0] != '\0') sid = atoi(msg.data);
 
             if (sid < 0) {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", players[player_index].name, "Invalid session id");
-                protocol_send_message(players[player_index].sock, &error);
+                protocol_send(players[player_index].sock, MSG_ERROR, "server", players[player_index].name, "Invalid session id");
                 break;
             }
             /* Privacy checks: retrieve the two players in the session and verify their private flags.
@@ -1034,9 +1353,7 @@ static void handle_client_message(int player_index)
              * least one private player. */
             char p1[64], p2[64];
             if (session_get_players(sid, p1, sizeof(p1), p2, sizeof(p2)) != 0) {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", players[player_index].name, "Invalid session id");
-                protocol_send_message(players[player_index].sock, &error);
+                protocol_send(players[player_index].sock, MSG_ERROR, "server", players[player_index].name, "Invalid session id");
                 break;
             }
 
@@ -1066,17 +1383,13 @@ static void handle_client_message(int player_index)
             }
 
             if (!allowed) {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", players[player_index].name, "Cannot spectate: one or more players set their game to private");
-                protocol_send_message(players[player_index].sock, &error);
+                protocol_send(players[player_index].sock, MSG_ERROR, "server", players[player_index].name, "Cannot spectate: one or more players set their game to private");
                 break;
             }
 
             /* Allowed -> add observer and notify */
             if (session_add_observer(sid, players[player_index].name, players[player_index].sock) == 0) {
-                message_t ok;
-                protocol_create_message(&ok, MSG_SPECTATE, "server", players[player_index].name, "Now observing session");
-                protocol_send_message(players[player_index].sock, &ok);
+                protocol_send(players[player_index].sock, MSG_SPECTATE, "server", players[player_index].name, "Now observing session");
 
                 /* Server terminal notice */
                 printf("%s is now spectating session %d (%s vs %s)\n", players[player_index].name, sid, p1, p2);
@@ -1084,17 +1397,12 @@ static void handle_client_message(int player_index)
                 /* Notify the two players in the game that someone is observing */
                 char notice[BUF_SIZE];
                 snprintf(notice, sizeof(notice), "%s is observing your game", players[player_index].name);
-                message_t nmsg;
                 char senderName[64];
                 snprintf(senderName, sizeof(senderName), "Session %d", sid);
-                protocol_create_message(&nmsg, MSG_PRIVATE_CHAT, senderName, p1, notice);
-                if (player_a) protocol_send_message(player_a->sock, &nmsg);
-                protocol_create_message(&nmsg, MSG_PRIVATE_CHAT, senderName, p2, notice);
-                if (player_b) protocol_send_message(player_b->sock, &nmsg);
+                if (player_a) protocol_send(player_a->sock, MSG_PRIVATE_CHAT, senderName, p1, notice);
+                if (player_b) protocol_send(player_b->sock, MSG_PRIVATE_CHAT, senderName, p2, notice);
             } else {
-                message_t error;
-                protocol_create_message(&error, MSG_ERROR, "server", players[player_index].name, "Failed to observe session");
-                protocol_send_message(players[player_index].sock, &error);
+                protocol_send(players[player_index].sock, MSG_ERROR, "server", players[player_index].name, "Failed to observe session");
             }
         }
             break;
@@ -1114,15 +1422,15 @@ static void handle_client_message(int player_index)
                 newval = 0;
             }
 
-            message_t out;
+            const char *result;
             if (newval == 1) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "Private mode enabled");
+                result = "Private mode enabled";
             } else if (newval == 0) {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "Private mode disabled");
+                result = "Private mode disabled";
             } else {
-                protocol_create_message(&out, MSG_FRIEND_RESULT, "server", players[player_index].name, "Unknown parameter for private command (use '1','0' or 'toggle')");
+                result = "Unknown parameter for private command (use '1','0' or 'toggle')";
             }
-            protocol_send_message(players[player_index].sock, &out);
+            protocol_send(players[player_index].sock, MSG_FRIEND_RESULT, "server", players[player_index].name, result);
         }
             break;
 
@@ -1130,16 +1438,12 @@ static void handle_client_message(int player_index)
         {
             player_t *player = find_player_by_name(msg.recipient);
             if (!player) {
-                message_t error;
                 char reason[BUF_SIZE];
                 snprintf(reason, sizeof(reason), "%s is not a player !", msg.recipient);
-                protocol_create_message(&error, MSG_ERROR, "server", msg.sender, reason);
-                protocol_send_message(players[player_index].sock, &error);
+                protocol_send(players[player_index].sock, MSG_ERROR, "server", msg.sender, reason);
                 break;
             }
-            message_t bio;
-            protocol_create_message(&bio, MSG_BIO_VIEW, msg.recipient, msg.sender, player->bio);
-            protocol_send_message(players[player_index].sock, &bio);
+            protocol_send(players[player_index].sock, MSG_BIO_VIEW, msg.recipient, msg.sender, player->bio);
         }
             break;
 
@@ -1159,12 +1463,43 @@ static void handle_client_message(int player_index)
             break;
         
 
+        case MSG_ANALYZE:
+        {
+            /* Live engine analysis is for spectators only, players get no hints.
+             * Data "off" unsubscribes; anything else subscribes. */
+            int sid = -1;
+            if (msg.recipient[0] != '\0' && isdigit((unsigned char)msg.recipient[0])) {
+                sid = atoi(msg.recipient);
+            }
+            if (session_get_serial(sid) == 0) {
+                protocol_send(players[player_index].sock, MSG_ERROR, "server", players[player_index].name, "Invalid session id");
+                break;
+            }
+            int on = strcmp(msg.data, "off") != 0;
+            if (session_set_analysis(sid, players[player_index].sock, on) < 0) {
+                protocol_send(players[player_index].sock, MSG_ERROR, "server", players[player_index].name, "Only spectators can analyze a game");
+            }
+        }
+            break;
+
         default:
             fprintf(stderr, "Unknown message type: %d\n", msg.type);
             break;
     }
 }
 
+// A game is over: its players may be challenged again.
+static void session_ended(int session_id)
+{
+    char p1[64], p2[64];
+    if (session_get_players(session_id, p1, sizeof(p1), p2, sizeof(p2)) != 0) return;
+    player_t *first = find_player_by_name(p1);
+    player_t *second = find_player_by_name(p2);
+    printf("Session %d ended. Clearing in_game flags for '%s' and '%s'\n", session_id, p1, p2);
+    if (first && first->in_game > 0) first->in_game--;
+    if (second && second->in_game > 0) second->in_game--;
+}
+
 // Add a connected player to the in-memory players list.
 static int add_player(SOCKET sock, const char *name)
 {
@@ -1230,3 +1565,13 @@ static player_t* find_player_by_name(const char *name)
     }
     return NULL;
 }
+
+static int find_player_index_by_sock(SOCKET sock)
+{
+    for (int i = 0; i < num_players; i++) {
+        if (players[i].sock == sock) {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -1,21 +1,162 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <time.h>
 
 #include "../common/net.h"
 #include "../common/protocol.h"
 #include "../game/awale.h"
+#include "bot.h"
+#include "analysis.h"
+#include "reactor.h"
 #include "session.h"
 
 static game_session_t sessions[MAX_SESSIONS];
+static unsigned int next_serial = 1;
+static session_ended_t ended_handler = NULL;
+
+/* Serial of the game each slot runs on the calling thread, 0 for none: a
+ * message or task for a game that ended here, or runs elsewhere, finds 0 */
+static __thread unsigned int running[MAX_SESSIONS];
+
+/* Work the lobby hands to the thread running a session */
+typedef struct session_task {
+    void (*run)(int session_id, const struct session_task *task);
+    int session_id;
+    unsigned int serial;
+    SOCKET sock;
+    uint32_t conn;
+    uint32_t request_id;
+    int value;
+    char name[64];
+} session_task_t;
+
+static session_task_t *session_task(int session_id, void (*run)(int, const session_task_t *))
+{
+    session_task_t *task = (session_task_t*)calloc(1, sizeof(session_task_t));
+    if (!task) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    task->run = run;
+    task->session_id = session_id;
+    task->serial = sessions[session_id].serial;
+    task->sock = INVALID_SOCKET;
+    return task;
+}
+
+/* On the thread running the session: run the task unless the game is over */
+static void session_task_run(void *arg)
+{
+    session_task_t *task = (session_task_t*)arg;
+    if (running[task->session_id] == task->serial) task->run(task->session_id, task);
+    free(task);
+}
+
+/* Lobby: hand a task to the thread running its session, through the
+ * mailbox of its reactor, or at once when the lobby runs it */
+static void session_post(session_task_t *task, void (*call)(void *arg))
+{
+    int reactor = sessions[task->session_id].reactor;
+    if (reactor < 0) call(task);
+    else reactors_call(reactor, call, task);
+}
+
+/* Send to a participant; bots have no socket, and a connection closed
+ * since it joined the game gets nothing */
+static void session_send(SOCKET sock, uint32_t conn, msg_type_t type, const char *recipient, const char *data, size_t len)
+{
+    if (sock != INVALID_SOCKET && reactors_address(sock, conn)) {
+        protocol_send_n(sock, type, "server", recipient, data, len);
+    }
+}
+
+static void session_send_player(const game_session_t *s, int player_num, msg_type_t type,
+                                const char *recipient, const char *data, size_t len)
+{
+    SOCKET sock = (player_num == 0) ? s->player1_sock : s->player2_sock;
+    session_send(sock, s->player_conn[player_num], type, recipient, data, len);
+}
+
+/* The session if it runs on the calling thread, else NULL */
+static game_session_t *session_here(int session_id)
+{
+    if (session_id < 0 || session_id >= MAX_SESSIONS || !running[session_id]) return NULL;
+    return &sessions[session_id];
+}
+
+/* If a bot is to move, hand the position to the worker pool */
+static void session_schedule_bot(int session_id)
+{
+    game_session_t *s = session_here(session_id);
+    if (!s || s->game.game_over) return;
+
+    int cur = s->game.current_player;
+    if (!s->is_bot[cur]) return;
+    const char *bot_name = (cur == 0) ? s->player1_name : s->player2_name;
+    if (bot_request_move(session_id, s->serial, &s->game, bot_name) < 0) {
+        fprintf(stderr, "Failed to schedule %s in session %d\n", bot_name, session_id);
+    }
+}
+
+/* After a bot move, let it ponder the human's reply (no-op unless enabled) */
+static void session_schedule_ponder(int session_id, int bot_num)
+{
+    game_session_t *s = session_here(session_id);
+    if (!s || s->game.game_over || s->is_bot[1 - bot_num]) return;
+
+    const char *bot_name = (bot_num == 0) ? s->player1_name : s->player2_name;
+    bot_ponder_start(session_id, s->serial, &s->game, bot_name);
+}
+
+/* Count the spectators of a session who asked for live analysis */
+static int session_analysis_subscribers(const game_session_t *s)
+{
+    int count = 0;
+    for (int i = 0; i < s->num_observers; i++) count += s->observers[i].analysis;
+    return count;
+}
+
+/* Show the lobby's analysis callbacks the position the subscribers look at */
+static void session_update_watched(game_session_t *s)
+{
+    uint64_t key = 0;
+    if (!s->game.game_over && session_analysis_subscribers(s) > 0) key = awale_hash(&s->game);
+    __atomic_store_n(&s->watched, key, __ATOMIC_RELAXED);
+}
+
+/* Send the analysis of the current position to its subscribers (or only to
+ * `only`). Unknown positions are queued; session_analysis_ready sends them. */
+static void session_publish_analysis(int session_id, SOCKET only)
+{
+    game_session_t *s = session_here(session_id);
+    if (!s || s->game.game_over || session_analysis_subscribers(s) == 0) return;
+
+    analysis_t analysis;
+    if (!analysis_lookup(&s->game, &analysis)) {
+        analysis_queue(&s->game);
+        return;
+    }
+
+    /* Formatted once, whatever the number of spectators */
+    char text[512];
+    analysis_format(&analysis, &s->game, s->player1_name, s->player2_name, text, sizeof(text));
+    size_t len = strlen(text);
+    char sid_str[32];
+    snprintf(sid_str, sizeof(sid_str), "%d", session_id);
+    for (int i = 0; i < s->num_observers; i++) {
+        if (s->observers[i].analysis && (only == INVALID_SOCKET || s->observers[i].sock == only)) {
+            session_send(s->observers[i].sock, s->observers[i].conn, MSG_ANALYSIS, sid_str, text, len);
+        }
+    }
+}
 
 /* Save session to a simple text .awale file in ./saved_games */
 static int session_save_game(int session_id)
 {
-    if (session_id < 0 || session_id >= MAX_SESSIONS) return -1;
-    game_session_t *s = &sessions[session_id];
-    if (!s->active || !s->game) return -1;
+    game_session_t *s = session_here(session_id);
+    if (!s) return -1;
 
     char p1[128] = {0}, p2[128] = {0};
     for (size_t i = 0; i < sizeof(p1)-1 && s->player1_name[i]; i++) {
@@ -25,24 +166,26 @@ static int session_save_game(int session_id)
         char c = s->player2_name[i]; p2[i] = (c=='/'||c=='\\'||c==':'||c==' ') ? '_' : c;
     }
 
+    /* Created exclusively: games of the same players may end at once on two reactors */
     char fname[1024];
     snprintf(fname, sizeof(fname), "saved_games/%s_vs_%s.awale", p1, p2);
+    FILE *f = NULL;
     for (int suffix = 1; suffix < 1000; suffix++) {
-        FILE *fcheck = fopen(fname, "r");
-        if (!fcheck) break;
-        fclose(fcheck);
+        f = fopen(fname, "wx");
+        if (f || errno != EEXIST) break;
         snprintf(fname, sizeof(fname), "saved_games/%s_vs_%s_%d.awale", p1, p2, suffix);
     }
-
-    FILE *f = fopen(fname, "w");
     if (!f) return -1;
 
     fprintf(f, "# Awale saved game v1\n");
     fprintf(f, "players: %s|%s\n", s->player1_name, s->player2_name);
-    fprintf(f, "winner: %d\n", s->game->winner);
-    fprintf(f, "scores: %d %d\n", s->game->scores[0], s->game->scores[1]);
+    if (s->game.variant != AWALE_VARIANT_STANDARD) {
+        fprintf(f, "variant: %s\n", awale_variant_info(s->game.variant)->name);
+    }
+    fprintf(f, "winner: %d\n", s->game.winner);
+    fprintf(f, "scores: %d %d\n", s->game.scores[0], s->game.scores[1]);
     fprintf(f, "holes:");
-    for (int i = 0; i < TOTAL_HOLES; i++) fprintf(f, " %d", s->game->holes[i]);
+    for (int i = 0; i < TOTAL_HOLES; i++) fprintf(f, " %d", s->game.holes[i]);
     fprintf(f, "\n");
 
     fprintf(f, "moves_count: %d\n", s->move_count);
@@ -56,20 +199,96 @@ static int session_save_game(int session_id)
     return 0;
 }
 
-void sessions_init(void)
+void sessions_init(session_ended_t on_ended)
 {
+    ended_handler = on_ended;
     memset(sessions, 0, sizeof(sessions));
     for (int i = 0; i < MAX_SESSIONS; i++) {
         sessions[i].active = 0;
-        sessions[i].game = NULL;
+        sessions[i].reactor = -1;
         sessions[i].num_observers = 0;
         sessions[i].move_count = 0;
         sessions[i].start_time = 0;
     }
 }
 
-/* create a session */
-int session_create(const char *player1, SOCKET sock1, const char *player2, SOCKET sock2)
+/* 1 if `sock` takes part in an active session other than `session_id` */
+static int session_socket_elsewhere(SOCKET sock, int session_id)
+{
+    for (int i = 0; i < MAX_SESSIONS; i++) {
+        const game_session_t *s = &sessions[i];
+        if (i == session_id || !s->active) continue;
+        if (s->player1_sock == sock || s->player2_sock == sock) return 1;
+        for (int o = 0; o < s->num_spectators; o++) {
+            if (s->spectators[o] == sock) return 1;
+        }
+    }
+    return 0;
+}
+
+/* Give the session one reactor and move its players' connections there, so
+ * that a move is received, played and broadcast by a single thread. A
+ * player still in another game stays where it is: the session then settles
+ * on that player's reactor, and what it sends to the other one is passed on
+ * by the lobby. Without reactors the lobby runs the session. */
+static void session_gather(int session_id)
+{
+    game_session_t *s = &sessions[session_id];
+    SOCKET socks[2] = { s->player1_sock, s->player2_sock };
+    int pinned[2];
+    for (int i = 0; i < 2; i++) {
+        s->player_conn[i] = socks[i] != INVALID_SOCKET ? reactors_serial(socks[i]) : 0;
+        pinned[i] = socks[i] != INVALID_SOCKET && session_socket_elsewhere(socks[i], session_id);
+    }
+
+    s->reactor = -1;
+    for (int i = 0; i < 2 && s->reactor < 0; i++) {
+        if (pinned[i]) s->reactor = reactors_owner(socks[i]);
+    }
+    for (int i = 0; i < 2 && s->reactor < 0; i++) {
+        if (socks[i] != INVALID_SOCKET) s->reactor = reactors_owner(socks[i]);
+    }
+    if (s->reactor < 0) return;
+    for (int i = 0; i < 2; i++) {
+        if (socks[i] != INVALID_SOCKET && !pinned[i]) reactors_migrate(socks[i], s->reactor);
+    }
+    printf("Game session %d runs on reactor %d\n", session_id, s->reactor);
+}
+
+/* On the thread running the game: announce it, show the board and let a bot
+ * starting the game think */
+static void session_start(void *arg)
+{
+    session_task_t *task = (session_task_t*)arg;
+    int slot = task->session_id;
+    game_session_t *s = &sessions[slot];
+    running[slot] = task->serial;
+    free(task);
+
+    const awale_variant_info_t *rules = awale_variant_info(s->game.variant);
+    char sid_str[32];
+    char start_data[160];
+    snprintf(sid_str, sizeof(sid_str), "%d", slot);
+    if (s->game.variant != AWALE_VARIANT_STANDARD) {
+        snprintf(start_data, sizeof(start_data), "%s (%s rules)", s->player2_name, rules->name);
+    } else {
+        snprintf(start_data, sizeof(start_data), "%s", s->player2_name);
+    }
+    session_send_player(s, 0, MSG_GAME_START, sid_str, start_data, strlen(start_data));
+    if (s->game.variant != AWALE_VARIANT_STANDARD) {
+        snprintf(start_data, sizeof(start_data), "%s (%s rules)", s->player1_name, rules->name);
+    } else {
+        snprintf(start_data, sizeof(start_data), "%s", s->player1_name);
+    }
+    session_send_player(s, 1, MSG_GAME_START, sid_str, start_data, strlen(start_data));
+
+    /* Send initial game state */
+    session_broadcast_state(slot);
+    session_schedule_bot(slot);
+}
+
+/* create a session playing rule variant `variant` */
+int session_create(const char *player1, SOCKET sock1, const char *player2, SOCKET sock2, int variant)
 {
     int slot = -1;
     for (int i = 0; i < MAX_SESSIONS; i++) {
@@ -85,32 +304,33 @@ int session_create(const char *player1, SOCKET sock1, const char *player2, SOCKE
     
     /* Initialize session */
     sessions[slot].active = 1;
+    sessions[slot].serial = next_serial++;
+    if (next_serial == 0) next_serial = 1;
+    sessions[slot].is_bot[0] = bot_is_bot_name(player1);
+    sessions[slot].is_bot[1] = bot_is_bot_name(player2);
+    memset(sessions[slot].player1_name, 0, sizeof(sessions[slot].player1_name));
+    memset(sessions[slot].player2_name, 0, sizeof(sessions[slot].player2_name));
     strncpy(sessions[slot].player1_name, player1, sizeof(sessions[slot].player1_name) - 1);
     strncpy(sessions[slot].player2_name, player2, sizeof(sessions[slot].player2_name) - 1);
     sessions[slot].player1_sock = sock1;
     sessions[slot].player2_sock = sock2;
-    sessions[slot].game = awale_create();
+    sessions[slot].num_spectators = 0;
+    session_gather(slot);
+    awale_reset_variant(&sessions[slot].game, variant);
+    __atomic_store_n(&sessions[slot].watched, 0, __ATOMIC_RELAXED);
     sessions[slot].num_observers = 0;
     sessions[slot].move_count = 0;
     sessions[slot].start_time = time(NULL);
 
     /* Randomly decide who starts */
-    sessions[slot].game->current_player = rand()%2;
-    
+    sessions[slot].game.current_player = rand()%2;
     
-    printf("Game session %d created: %s vs %s\n", slot, player1, player2);
-    
-    message_t msg;
-    char sid_str[32];
-    snprintf(sid_str, sizeof(sid_str), "%d", slot);
-    protocol_create_message(&msg, MSG_GAME_START, "server", sid_str, player2);
-    protocol_send_message(sock1, &msg);
-    protocol_create_message(&msg, MSG_GAME_START, "server", sid_str, player1);
-    protocol_send_message(sock2, &msg);
-    
-    /* Send initial game state */
-    session_broadcast_state(slot);
     
+    const awale_variant_info_t *rules = awale_variant_info(sessions[slot].game.variant);
+    printf("Game session %d created: %s vs %s (%s rules)\n", slot, player1, player2, rules->name);
+
+    /* From here on the game belongs to the thread running it */
+    session_post(session_task(slot, NULL), session_start);
     return slot;
 }
 
@@ -130,37 +350,51 @@ int session_find_by_player(int games[], const char *player_name)
     return count;
 }
 
-/* To clear/destroy a session */
+/* Lobby: the game is over on its thread, the players may start new ones */
+static void session_release(void *arg)
+{
+    session_task_t *task = (session_task_t*)arg;
+    game_session_t *s = &sessions[task->session_id];
+    if (s->active && s->serial == task->serial) {
+        if (ended_handler) ended_handler(task->session_id);
+        s->active = 0;
+        s->num_spectators = 0;
+        printf("Game session %d destroyed\n", task->session_id);
+    }
+    free(task);
+}
+
+/* To clear/destroy a session, on the thread running it; the lobby then frees its slot */
 void session_destroy(int session_id)
 {
-    if (session_id < 0 || session_id >= MAX_SESSIONS) {
+    game_session_t *s = session_here(session_id);
+    if (!s) {
         return;
     }
     
-    if (sessions[session_id].game) {
-        awale_free(sessions[session_id].game);
-        sessions[session_id].game = NULL;
-    }
-    for (int i = 0; i < sessions[session_id].num_observers; i++) {
-        message_t msg;
-        protocol_create_message(&msg, MSG_GAME_OVER, "server", sessions[session_id].observers[i].name, "Observed game ended");
-        protocol_send_message(sessions[session_id].observers[i].sock, &msg);
+    bot_ponder_cancel(session_id);
+    for (int i = 0; i < s->num_observers; i++) {
+        const char *text = "Observed game ended";
+        session_send(s->observers[i].sock, s->observers[i].conn, MSG_GAME_OVER,
+                     s->observers[i].name, text, strlen(text));
     }
-    sessions[session_id].num_observers = 0;
-    
-    sessions[session_id].active = 0;
-    printf("Game session %d destroyed\n", session_id);
+    s->num_observers = 0;
+    __atomic_store_n(&s->watched, 0, __ATOMIC_RELAXED);
+
+    running[session_id] = 0;
+    session_task_t *task = session_task(session_id, NULL);
+    if (s->reactor < 0) session_release(task);
+    else reactors_call(-1, session_release, task);
 }
 
 /* Handle the move of a player, especially if the game is over, also handle the save of the game*/
 int session_handle_move(int session_id, const char *player_name, int hole)
 {
-    if (session_id < 0 || session_id >= MAX_SESSIONS || !sessions[session_id].active) {
+    game_session_t *session = session_here(session_id);
+    if (!session) {
         return -1;
     }
     
-    game_session_t *session = &sessions[session_id];
-    
     int player_num;
     if (strcmp(player_name, session->player1_name) == 0) {
         player_num = 0;
@@ -170,24 +404,18 @@ int session_handle_move(int session_id, const char *player_name, int hole)
         return -1;
     }
     
-    if (player_num != session->game->current_player) {
-        message_t msg;
-        protocol_create_message(&msg, MSG_ERROR, "server", player_name, "Not your turn");
-        SOCKET sock = (player_num == 0) ? session->player1_sock : session->player2_sock;
-        protocol_send_message(sock, &msg);
+    if (player_num != session->game.current_player) {
+        session_send_player(session, player_num, MSG_ERROR, player_name, "Not your turn", strlen("Not your turn"));
         return -1;
     }
     
     /* Attempt to play the move */
-    awale_status_t status = awale_play_move(session->game, hole);
+    awale_status_t status = awale_play_move(&session->game, hole);
     
     if (status != AWALE_OK) {
         /* Invalid move */
-        message_t msg;
-        protocol_create_message(&msg, MSG_ERROR, "server", player_name, 
-                              awale_status_string(status));
-        SOCKET sock = (player_num == 0) ? session->player1_sock : session->player2_sock;
-        protocol_send_message(sock, &msg);
+        const char *reason = awale_status_string(status);
+        session_send_player(session, player_num, MSG_ERROR, player_name, reason, strlen(reason));
         return -1;
     }
     
@@ -201,7 +429,7 @@ int session_handle_move(int session_id, const char *player_name, int hole)
     }
 
     /* Check if game is over */
-    if (awale_is_game_over(session->game)) {
+    if (awale_is_game_over(&session->game)) {
         /* Save completed game before notifying/destroying */
         session_save_game(session_id);
         session_notify_game_over(session_id);
@@ -209,65 +437,80 @@ int session_handle_move(int session_id, const char *player_name, int hole)
         return 1; /* Indicate game over */
     }
     
+    /* A pondered bot answer to this very move is kept, anything else is dropped */
+    if (session->is_bot[player_num] || !bot_ponder_resolve(session_id, session->serial, hole)) {
+        session_schedule_bot(session_id);
+    }
+    if (session->is_bot[player_num]) {
+        session_schedule_ponder(session_id, player_num);
+    }
     return 0;
 }
 
+/* Play a move and show the board to everyone in the game */
+static int session_play_move(int session_id, const char *player_name, int hole)
+{
+    int flag = session_handle_move(session_id, player_name, hole);
+    if (flag >= 0) session_broadcast_state(session_id);
+    return flag;
+}
+
 void session_broadcast_state(int session_id)
 {
-    if (session_id < 0 || session_id >= MAX_SESSIONS || !sessions[session_id].active) {
+    game_session_t *session = session_here(session_id);
+    if (!session) {
         return;
     }
     
-    game_session_t *session = &sessions[session_id];
-    
     /* Convert game state to string (use player names) */
     char state_buffer[BUF_SIZE];
-    awale_print_to_buffer(session->game, state_buffer, sizeof(state_buffer),session->player1_name, session->player2_name);
+    awale_print_to_buffer(&session->game, state_buffer, sizeof(state_buffer),session->player1_name, session->player2_name);
     
     /* Send to both players; include session id in recipient so clients know which session */
-    message_t msg;
+    /* Printed once, copied with its length into each connection's frame */
+    size_t len = strlen(state_buffer);
     char sid_str[32];
     snprintf(sid_str, sizeof(sid_str), "%d", session_id);
-    protocol_create_message(&msg, MSG_GAME_STATE, "server", sid_str, state_buffer);
-    protocol_send_message(session->player1_sock, &msg);
-    protocol_send_message(session->player2_sock, &msg);
+    session_send_player(session, 0, MSG_GAME_STATE, sid_str, state_buffer, len);
+    session_send_player(session, 1, MSG_GAME_STATE, sid_str, state_buffer, len);
 
     for (int i = 0; i < session->num_observers; i++) {
-        protocol_send_message(session->observers[i].sock, &msg);
+        session_send(session->observers[i].sock, session->observers[i].conn, MSG_GAME_STATE, sid_str, state_buffer, len);
     }
+    session_update_watched(session);
+    session_publish_analysis(session_id, INVALID_SOCKET);
 }
 
 // notify the player that game is over with the name of the winner and the score
 void session_notify_game_over(int session_id)
 {
-    if (session_id < 0 || session_id >= MAX_SESSIONS || !sessions[session_id].active) {
+    game_session_t *session = session_here(session_id);
+    if (!session) {
         return;
     }
     
-    game_session_t *session = &sessions[session_id];
-    int winner = awale_get_winner(session->game);
+    int winner = awale_get_winner(&session->game);
     
     char result[256];
     if (winner == -1) {
         snprintf(result, sizeof(result), "Game Over - Draw! Scores: %d - %d",
-                awale_get_score(session->game, 0),
-                awale_get_score(session->game, 1));
+                awale_get_score(&session->game, 0),
+                awale_get_score(&session->game, 1));
     } else {
         const char *winner_name = (winner == 0) ? session->player1_name : session->player2_name;
         snprintf(result, sizeof(result), "Game Over - Winner: %s! Scores: %d - %d",
                 winner_name,
-                awale_get_score(session->game, 0),
-                awale_get_score(session->game, 1));
+                awale_get_score(&session->game, 0),
+                awale_get_score(&session->game, 1));
     }
     
-    message_t msg;
+    size_t len = strlen(result);
     char sid_str[32];
     snprintf(sid_str, sizeof(sid_str), "%d", session_id);
-    protocol_create_message(&msg, MSG_GAME_OVER, "server", sid_str, result);
-    protocol_send_message(session->player1_sock, &msg);
-    protocol_send_message(session->player2_sock, &msg);
+    session_send_player(session, 0, MSG_GAME_OVER, sid_str, result, len);
+    session_send_player(session, 1, MSG_GAME_OVER, sid_str, result, len);
     for (int i = 0; i < session->num_observers; i++) {
-        protocol_send_message(session->observers[i].sock, &msg);
+        session_send(session->observers[i].sock, session->observers[i].conn, MSG_GAME_OVER, sid_str, result, len);
     }
     
     printf("%s\n", result);
@@ -314,45 +557,150 @@ int session_get_players(int session_id, char *p1, int p1_size, char *p2, int p2_
     return 0;
 }
 
-/* Add an observer to a session. Observer keeps its own connection; server just stores sock/name. */
-int session_add_observer(int session_id, const char *observer_name, SOCKET sock)
+// Return the serial of an active session, or 0 if the slot is free.
+unsigned int session_get_serial(int session_id)
+{
+    if (session_id < 0 || session_id >= MAX_SESSIONS || !sessions[session_id].active) return 0;
+    return sessions[session_id].serial;
+}
+
+/* Index of `sock` in the lobby's list of spectators of a session, or -1 */
+static int session_find_spectator(const game_session_t *s, SOCKET sock)
+{
+    for (int i = 0; i < s->num_spectators; i++) {
+        if (s->spectators[i] == sock) return i;
+    }
+    return -1;
+}
+
+static void session_analysis_task(int session_id, const session_task_t *task)
 {
-    if (session_id < 0 || session_id >= MAX_SESSIONS) return -1;
     game_session_t *s = &sessions[session_id];
-    if (!s->active) return -1;
-    if (s->num_observers >= (int)(sizeof(s->observers)/sizeof(s->observers[0]))) return -1;
+    for (int i = 0; i < s->num_observers; i++) {
+        if (s->observers[i].sock == task->sock) {
+            s->observers[i].analysis = task->value;
+            session_update_watched(s);
+            if (task->value) session_publish_analysis(session_id, task->sock);
+            return;
+        }
+    }
+}
+
+// Turn live analysis on or off for the spectator on `sock`. Returns -1 if it is not one.
+int session_set_analysis(int session_id, SOCKET sock, int on)
+{
+    if (session_id < 0 || session_id >= MAX_SESSIONS || !sessions[session_id].active) return -1;
+    if (session_find_spectator(&sessions[session_id], sock) < 0) return -1;
+    session_task_t *task = session_task(session_id, session_analysis_task);
+    task->sock = sock;
+    task->value = on ? 1 : 0;
+    session_post(task, session_task_run);
+    return 0;
+}
+
+static void session_publish_task(int session_id, const session_task_t *task)
+{
+    (void)task;
+    session_publish_analysis(session_id, INVALID_SOCKET);
+}
+
+// Analysis callback: position `key` is now cached, publish it where it is on the board.
+void session_analysis_ready(uint64_t key)
+{
+    for (int i = 0; i < MAX_SESSIONS; i++) {
+        game_session_t *s = &sessions[i];
+        if (s->active && __atomic_load_n(&s->watched, __ATOMIC_RELAXED) == key) {
+            session_post(session_task(i, session_publish_task), session_task_run);
+        }
+    }
+}
+
+// Analysis callback: 1 if some watched session still shows position `key`.
+// Reads nothing but what the games publish, so any thread may ask.
+int session_analysis_wanted(uint64_t key)
+{
+    for (int i = 0; i < MAX_SESSIONS; i++) {
+        if (__atomic_load_n(&sessions[i].watched, __ATOMIC_RELAXED) == key) return 1;
+    }
+    return 0;
+}
+
+static void session_watch_task(int session_id, const session_task_t *task)
+{
+    game_session_t *s = &sessions[session_id];
+    if (s->num_observers >= (int)(sizeof(s->observers)/sizeof(s->observers[0]))) return;
 
-    strncpy(s->observers[s->num_observers].name, observer_name ? observer_name : "", sizeof(s->observers[s->num_observers].name)-1);
-    s->observers[s->num_observers].sock = sock;
+    memset(s->observers[s->num_observers].name, 0, sizeof(s->observers[s->num_observers].name));
+    strncpy(s->observers[s->num_observers].name, task->name, sizeof(s->observers[s->num_observers].name)-1);
+    s->observers[s->num_observers].sock = task->sock;
+    s->observers[s->num_observers].conn = task->conn;
+    s->observers[s->num_observers].analysis = 0;
     s->num_observers++;
 
-    /* Immediately send current state to new observer */
-    char state_buffer[BUF_SIZE];
-    awale_print_to_buffer(s->game, state_buffer, sizeof(state_buffer), s->player1_name, s->player2_name);
-    message_t msg;
+    /* Immediately send current state to new observer, printed straight into its frame */
+    if (!reactors_address(task->sock, task->conn)) return;
     char sid_str[32];
     snprintf(sid_str, sizeof(sid_str), "%d", session_id);
-    protocol_create_message(&msg, MSG_GAME_STATE, "server", sid_str, state_buffer);
-    protocol_send_message(sock, &msg);
-    return 0;
+    size_t room;
+    char *state = protocol_begin(task->sock, MSG_GAME_STATE, "server", sid_str, &room);
+    awale_print_to_buffer(&s->game, state, (int)room, s->player1_name, s->player2_name);
+    protocol_commit(task->sock, strlen(state));
 }
 
-//To remove an observer
-int session_remove_observer(int session_id, SOCKET sock)
+/* Add an observer to a session. Observer keeps its own connection; server just stores sock/name.
+ * The connection moves to the session's reactor unless it takes part in another game. */
+int session_add_observer(int session_id, const char *observer_name, SOCKET sock)
 {
     if (session_id < 0 || session_id >= MAX_SESSIONS) return -1;
     game_session_t *s = &sessions[session_id];
     if (!s->active) return -1;
+    if (s->num_spectators >= (int)(sizeof(s->spectators)/sizeof(s->spectators[0]))) return -1;
 
+    if (s->reactor >= 0 && !session_socket_elsewhere(sock, session_id)) {
+        reactors_migrate(sock, s->reactor);
+    }
+    s->spectators[s->num_spectators++] = sock;
+
+    session_task_t *task = session_task(session_id, session_watch_task);
+    strncpy(task->name, observer_name ? observer_name : "", sizeof(task->name)-1);
+    task->sock = sock;
+    task->conn = reactors_serial(sock);
+    session_post(task, session_task_run);
+    return 0;
+}
+
+static void session_unwatch_task(int session_id, const session_task_t *task)
+{
+    game_session_t *s = &sessions[session_id];
     int idx = -1;
     for (int i = 0; i < s->num_observers; i++) {
-        if (s->observers[i].sock == sock) { idx = i; break; }
+        if (s->observers[i].sock == task->sock) { idx = i; break; }
     }
-    if (idx == -1) return -1;
+    if (idx == -1) return;
     for (int i = idx; i < s->num_observers - 1; i++) {
         s->observers[i] = s->observers[i+1];
     }
     s->num_observers--;
+    session_update_watched(s);
+}
+
+//To remove an observer
+int session_remove_observer(int session_id, SOCKET sock)
+{
+    if (session_id < 0 || session_id >= MAX_SESSIONS) return -1;
+    game_session_t *s = &sessions[session_id];
+    if (!s->active) return -1;
+
+    int idx = session_find_spectator(s, sock);
+    if (idx == -1) return -1;
+    for (int i = idx; i < s->num_spectators - 1; i++) {
+        s->spectators[i] = s->spectators[i+1];
+    }
+    s->num_spectators--;
+
+    session_task_t *task = session_task(session_id, session_unwatch_task);
+    task->sock = sock;
+    session_post(task, session_task_run);
     return 0;
 }
 
@@ -369,31 +717,17 @@ void session_list_games(char *buffer, int size)
     if (offset == 0) snprintf(buffer, size, "No active games\n");
 }
 
-/* Handle a player giving up: mark opponent as winner, collect remaining seeds, notify and destroy session */
-int session_give_up(int session_id, const char *player_name)
+/* Player `player_num` gives up: mark opponent as winner, collect remaining seeds, notify and destroy session */
+static void session_forfeit(int session_id, int player_num)
 {
-    if (session_id < 0 || session_id >= MAX_SESSIONS || !sessions[session_id].active) return -1;
     game_session_t *session = &sessions[session_id];
-
-    int player_num;
-    if (strcmp(player_name, session->player1_name) == 0) player_num = 0;
-    else if (strcmp(player_name, session->player2_name) == 0) player_num = 1;
-    else return -1;
-
+    const char *player_name = (player_num == 0) ? session->player1_name : session->player2_name;
     int opponent = 1 - player_num;
 
-    /* Collect remaining seeds to opponent and clear holes */
-    int opp_start = opponent * HOLES_PER_PLAYER;
-    int opp_end = opp_start + HOLES_PER_PLAYER;
+    /* The opponent collects every seed left on the board */
     for (int i = 0; i < TOTAL_HOLES; i++) {
-        if (i >= opp_start && i < opp_end) {
-            session->game->scores[opponent] += session->game->holes[i];
-        } else {
-            /* leave other side's seeds as is or add to opponent as well */
-            /* we'll also collect them to opponent to finalize the score */
-            session->game->scores[opponent] += session->game->holes[i];
-        }
-        session->game->holes[i] = 0;
+        session->game.scores[opponent] += session->game.holes[i];
+        session->game.holes[i] = 0;
     }
 
     /* Record give-up event */
@@ -405,13 +739,106 @@ int session_give_up(int session_id, const char *player_name)
         session->move_count++;
     }
 
-    session->game->game_over = 1;
-    session->game->winner = opponent;
+    session->game.game_over = 1;
+    session->game.winner = opponent;
 
     /* Save completed game, then notify and cleanup */
     session_save_game(session_id);
     session_notify_game_over(session_id);
     session_destroy(session_id);
+}
 
+static void session_give_up_task(int session_id, const session_task_t *task)
+{
+    session_forfeit(session_id, task->value);
+}
+
+/* Handle a player giving up, on the thread running the game. Returns -1 if
+ * the player is not in the session. */
+int session_give_up(int session_id, const char *player_name)
+{
+    if (session_id < 0 || session_id >= MAX_SESSIONS || !sessions[session_id].active) return -1;
+    game_session_t *session = &sessions[session_id];
+
+    int player_num;
+    if (strcmp(player_name, session->player1_name) == 0) player_num = 0;
+    else if (strcmp(player_name, session->player2_name) == 0) player_num = 1;
+    else return -1;
+
+    session_task_t *task = session_task(session_id, session_give_up_task);
+    task->value = player_num;
+    session_post(task, session_task_run);
     return 0;
 }
+
+static void session_play_task(int session_id, const session_task_t *task)
+{
+    game_session_t *s = &sessions[session_id];
+    SOCKET sock = strcmp(task->name, s->player1_name) == 0 ? s->player1_sock : s->player2_sock;
+    if (sock != INVALID_SOCKET) protocol_set_request_id(sock, task->request_id);
+    session_play_move(session_id, task->name, task->value);
+    if (sock != INVALID_SOCKET) protocol_set_request_id(sock, 0);
+}
+
+/* Play the move of a player whose message reached the lobby, on the thread
+ * running the game; what goes back to the player answers `request_id` */
+void session_play(int session_id, const char *player_name, int hole, uint32_t request_id)
+{
+    if (session_id < 0 || session_id >= MAX_SESSIONS || !sessions[session_id].active) return;
+    session_task_t *task = session_task(session_id, session_play_task);
+    strncpy(task->name, player_name, sizeof(task->name)-1);
+    task->value = hole;
+    task->request_id = request_id;
+    session_post(task, session_task_run);
+}
+
+static void session_bot_move_task(int session_id, const session_task_t *task)
+{
+    session_play_move(session_id, task->name, task->value);
+}
+
+// Bot move handler: apply a move picked by a bot worker, exactly like a move from a player.
+void session_bot_move(int session_id, unsigned int serial, const char *bot_name, int hole)
+{
+    /* The game may have ended (give up, disconnect) while the bot was thinking */
+    if (session_get_serial(session_id) != serial) {
+        return;
+    }
+    session_task_t *task = session_task(session_id, session_bot_move_task);
+    strncpy(task->name, bot_name, sizeof(task->name)-1);
+    task->value = hole;
+    session_post(task, session_task_run);
+}
+
+/* Which player of a session running on the calling thread is on `sock`, or -1 */
+static int session_player_here(int session_id, SOCKET sock)
+{
+    game_session_t *s = session_here(session_id);
+    if (!s || sock == INVALID_SOCKET) return -1;
+    if (s->player1_sock == sock && reactors_address(sock, s->player_conn[0])) return 0;
+    if (s->player2_sock == sock && reactors_address(sock, s->player_conn[1])) return 1;
+    return -1;
+}
+
+// Reactor filter: play a move received on `sock` for a session running here.
+// Returns 0 if it is not a player's move for such a session; the lobby handles it.
+int session_move_here(int session_id, SOCKET sock, int hole)
+{
+    int player_num = session_player_here(session_id, sock);
+    if (player_num < 0) return 0;
+    const char *name = (player_num == 0) ? sessions[session_id].player1_name : sessions[session_id].player2_name;
+    session_play_move(session_id, name, hole);
+    printf("Move handled for '%s' in session %d\n", name, session_id);
+    return 1;
+}
+
+// Reactor filter: give up a session running here for the player on `sock`.
+// Returns 0 if it is not a player of such a session.
+int session_give_up_here(int session_id, SOCKET sock)
+{
+    int player_num = session_player_here(session_id, sock);
+    if (player_num < 0) return 0;
+    printf("%s gave up the game\n", (player_num == 0) ? sessions[session_id].player1_name : sessions[session_id].player2_name);
+    session_forfeit(session_id, player_num);
+    return 1;
+}
@@ -1,23 +1,39 @@
 #ifndef SERVER_SESSION_H
 #define SERVER_SESSION_H
 
+#include <stdint.h>
 #include "../common/net.h"
+#include "../game/awale.h"
 
-#define MAX_SESSIONS 50
+#define MAX_SESSIONS 256
 
-/* Game session structure */
+/* Game session structure. A game runs on one thread: a reactor when the
+ * server has some (see reactor.h), the lobby otherwise. The lobby sets up
+ * the players and keeps its own list of spectators; everything from `game`
+ * on belongs to the thread running the game, which the lobby reaches by
+ * handing it tasks. */
 typedef struct {
     int active;
+    unsigned int serial; /* unique per game, lets async results detect a reused slot */
+    int is_bot[2];       /* 1 if player1/player2 is a built-in bot */
     char player1_name[64];
     char player2_name[64];
     SOCKET player1_sock;
     SOCKET player2_sock;
-    awale_game_t *game;
+    uint32_t player_conn[2];    /* their connections, as reactors_address takes them */
+    int reactor;         /* reactor running the game, -1 = the lobby */
+    int num_spectators;
+    SOCKET spectators[10];      /* the lobby's copy of observers[].sock */
+
+    awale_game_t game;   /* embedded, reset in place by session_create */
+    uint64_t watched;    /* position shown to analysis subscribers, 0 = none; read by the lobby */
 
     int num_observers;
     struct {
         char name[64];
         SOCKET sock;
+        uint32_t conn;
+        int analysis;    /* 1 = receives the live analysis after every move */
     } observers[10];
 
     int move_count; // for the save
@@ -29,19 +45,32 @@ typedef struct {
     time_t start_time;
 } game_session_t;
 
-//function prototypes
-void sessions_init(void);
-int session_create(const char *player1, SOCKET sock1, const char *player2, SOCKET sock2);
+/* Called on the lobby once a game is over, before its slot is freed */
+typedef void (*session_ended_t)(int session_id);
+
+//function prototypes, for the lobby
+void sessions_init(session_ended_t on_ended);
+int session_create(const char *player1, SOCKET sock1, const char *player2, SOCKET sock2, int variant);
 int session_find_by_player(int sessions[], const char *player_name);
-void session_destroy(int session_id);
-int session_handle_move(int session_id, const char *player_name, int hole);
-void session_broadcast_state(int session_id);
-void session_notify_game_over(int session_id);
 const char *session_get_opponent_name(int session_id, const char *player_name);
+void session_play(int session_id, const char *player_name, int hole, uint32_t request_id);
 int session_give_up(int session_id, const char *player_name);
+void session_bot_move(int session_id, unsigned int serial, const char *bot_name, int hole);
 int session_add_observer(int session_id, const char *observer_name, SOCKET sock);
 int session_remove_observer(int session_id, SOCKET sock);
 void session_list_games(char *buffer, int size);
 int session_get_players(int session_id, char *p1, int p1_size, char *p2, int p2_size);
+unsigned int session_get_serial(int session_id);
+int session_set_analysis(int session_id, SOCKET sock, int on);
+void session_analysis_ready(uint64_t key);
+int session_analysis_wanted(uint64_t key);
+
+//for the thread running the game
+int session_move_here(int session_id, SOCKET sock, int hole);
+int session_give_up_here(int session_id, SOCKET sock);
+int session_handle_move(int session_id, const char *player_name, int hole);
+void session_broadcast_state(int session_id);
+void session_notify_game_over(int session_id);
+void session_destroy(int session_id);
 
 #endif
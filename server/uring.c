@@ -0,0 +1,464 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+
+#include "../common/protocol.h"
+#include "uring.h"
+
+#ifdef __linux__
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/select.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+/* Raw system calls: the ring is small enough not to need liburing. The
+ * submission queue maps slot i to entry i once and for all, so submitting is
+ * filling entries and moving the tail. */
+
+#define URING_ENTRIES 1024          /* submission queue */
+#define URING_CQ_ENTRIES 4096
+#define URING_BUFFERS 256           /* provided receive buffers, a power of two */
+#define URING_BUFFER_SIZE 4096
+#define URING_GROUP 1               /* buffer group of the receives */
+/* Completions set aside while uring_flush waits for its sends: room for
+ * this many at first, doubled whenever it runs out, since a lost completion
+ * would leave its receive or poll unarmed */
+#define URING_STASH 256
+
+/* What a completion is for: user_data packs the operation, the socket and,
+ * for receives, the socket's generation when the receive was armed, so that
+ * the completions of a forgotten socket are told from those of a new one
+ * reusing its descriptor. */
+enum { OP_ACCEPT = 1, OP_RECV, OP_SEND, OP_POLL, OP_CANCEL };
+#define GENERATION_MASK 0xffffffu
+
+/* One ring per thread: each reactor runs its own */
+static __thread struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask;
+    unsigned sq_entries;
+    unsigned sq_local_tail;         /* entries filled, published on submit */
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *rings;
+    size_t rings_size, sqes_size;
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_size;
+    unsigned short buf_tail;
+    char *buffers;
+    int sends;                      /* sends submitted and not completed */
+} ring = { .fd = -1 };
+
+static __thread uint32_t generation[FD_SETSIZE];
+static __thread unsigned char releasing[FD_SETSIZE];   /* uring_release waits for the end of the receive */
+static __thread struct io_uring_cqe *stash = NULL;
+static __thread int num_stash = 0, stash_size = 0;
+static __thread SOCKET flushing[FD_SETSIZE];
+
+static uint64_t pack(int op, uint32_t gen, int fd)
+{
+    return (uint64_t)op << 56 | (uint64_t)(gen & GENERATION_MASK) << 32 | (uint32_t)fd;
+}
+
+static int submit(unsigned wait)
+{
+    __atomic_store_n(ring.sq_tail, ring.sq_local_tail, __ATOMIC_RELEASE);
+    unsigned pending = ring.sq_local_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+    for (;;) {
+        long ret = syscall(__NR_io_uring_enter, ring.fd, pending, wait,
+                           wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (ret >= 0) return 0;
+        /* EBUSY: completions are backed up, reaping them makes room */
+        if (errno == EBUSY || errno == EAGAIN) return 0;
+        if (errno != EINTR) {
+            perror("io_uring_enter");
+            return -1;
+        }
+    }
+}
+
+// Next free submission entry, cleared; submits the queue first when it is full.
+static struct io_uring_sqe *get_sqe(void)
+{
+    while (ring.sq_local_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE) >= ring.sq_entries) {
+        if (submit(0) < 0) return NULL;
+    }
+    struct io_uring_sqe *sqe = &ring.sqes[ring.sq_local_tail & *ring.sq_mask];
+    ring.sq_local_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+static unsigned sq_space(void)
+{
+    return ring.sq_entries - (ring.sq_local_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE));
+}
+
+// Hand a receive buffer back to the kernel.
+static void recycle(unsigned bid)
+{
+    struct io_uring_buf *buf = &ring.buf_ring->bufs[ring.buf_tail & (URING_BUFFERS - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(ring.buffers + (size_t)bid * URING_BUFFER_SIZE);
+    buf->len = URING_BUFFER_SIZE;
+    buf->bid = (unsigned short)bid;
+    ring.buf_tail++;
+    __atomic_store_n(&ring.buf_ring->tail, ring.buf_tail, __ATOMIC_RELEASE);
+}
+
+static int arm_accept(SOCKET listen_sock)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_sock;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = pack(OP_ACCEPT, 0, listen_sock);
+    return 0;
+}
+
+static int arm_recv(SOCKET sock)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = sock;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_GROUP;
+    sqe->user_data = pack(OP_RECV, generation[sock], sock);
+    return 0;
+}
+
+static int arm_poll(int fd)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = pack(OP_POLL, 0, fd);
+    return 0;
+}
+
+/* Set up the ring and the receive buffers. Needs Linux 6.0 for a single
+ * issuer ring, which also brings multishot receives, multishot accepts (5.19)
+ * and provided buffer rings (5.19). Returns 0, or -1 with errno set. */
+int uring_init(void)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_CQSIZE;
+    params.cq_entries = URING_CQ_ENTRIES;
+    ring.fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (ring.fd < 0) return -1;
+
+    int err = ENOTSUP;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) goto fail;
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring.rings_size = sq_size > cq_size ? sq_size : cq_size;
+    ring.rings = mmap(NULL, ring.rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring.fd, IORING_OFF_SQ_RING);
+    if (ring.rings == MAP_FAILED) {
+        ring.rings = NULL;
+        err = errno;
+        goto fail;
+    }
+    ring.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sqes = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring.fd, IORING_OFF_SQES);
+    if (ring.sqes == MAP_FAILED) {
+        ring.sqes = NULL;
+        err = errno;
+        goto fail;
+    }
+
+    char *base = (char*)ring.rings;
+    ring.sq_head = (unsigned*)(base + params.sq_off.head);
+    ring.sq_tail = (unsigned*)(base + params.sq_off.tail);
+    ring.sq_mask = (unsigned*)(base + params.sq_off.ring_mask);
+    ring.sq_entries = params.sq_entries;
+    ring.sq_local_tail = *ring.sq_tail;
+    unsigned *array = (unsigned*)(base + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; i++) array[i] = i;
+    ring.cq_head = (unsigned*)(base + params.cq_off.head);
+    ring.cq_tail = (unsigned*)(base + params.cq_off.tail);
+    ring.cq_mask = (unsigned*)(base + params.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe*)(base + params.cq_off.cqes);
+
+    ring.buf_ring_size = URING_BUFFERS * sizeof(struct io_uring_buf);
+    ring.buf_ring = mmap(NULL, ring.buf_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring.buf_ring == MAP_FAILED) {
+        ring.buf_ring = NULL;
+        err = errno;
+        goto fail;
+    }
+    ring.buffers = (char*)malloc((size_t)URING_BUFFERS * URING_BUFFER_SIZE);
+    if (!ring.buffers) {
+        err = ENOMEM;
+        goto fail;
+    }
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring.buf_ring;
+    reg.ring_entries = URING_BUFFERS;
+    reg.bgid = URING_GROUP;
+    if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        err = errno;
+        goto fail;
+    }
+    ring.buf_tail = 0;
+    for (unsigned bid = 0; bid < URING_BUFFERS; bid++) recycle(bid);
+
+    ring.sends = 0;
+    num_stash = 0;
+    return 0;
+
+fail:
+    uring_shutdown();
+    errno = err;
+    return -1;
+}
+
+void uring_shutdown(void)
+{
+    if (ring.fd < 0) return;
+    if (ring.sqes) munmap(ring.sqes, ring.sqes_size);
+    if (ring.rings) munmap(ring.rings, ring.rings_size);
+    close(ring.fd);
+    if (ring.buf_ring) munmap(ring.buf_ring, ring.buf_ring_size);
+    free(ring.buffers);
+    free(stash);
+    stash = NULL;
+    num_stash = stash_size = 0;
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = -1;
+}
+
+/* Accept connections on the listening socket until shutdown; each listening
+ * socket of the loop gets its own multishot accept */
+int uring_accept(SOCKET listen_sock)
+{
+    return arm_accept(listen_sock);
+}
+
+/* Receive from the socket until it closes or is forgotten */
+int uring_recv(SOCKET sock)
+{
+    if (sock < 0 || sock >= FD_SETSIZE) return -1;
+    return arm_recv(sock);
+}
+
+static void cancel_recv(SOCKET sock)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = sock;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = pack(OP_CANCEL, 0, sock);
+    submit(0);
+}
+
+/* Cancel the socket's receive, before it is closed: its late completions no
+ * longer match the socket's generation and are dropped. The cancellation is
+ * submitted at once so that closing the socket really closes it. A socket
+ * being released is left to finish its release. */
+void uring_forget(SOCKET sock)
+{
+    if (ring.fd < 0 || sock < 0 || sock >= FD_SETSIZE || releasing[sock]) return;
+    generation[sock]++;
+    cancel_recv(sock);
+}
+
+/* Cancel the socket's receive, before another thread's ring reads it. Data
+ * the kernel already received still goes to the `received` handler; the
+ * `released` handler is called once the receive is over, after which this
+ * ring no longer touches the socket. */
+void uring_release(SOCKET sock)
+{
+    if (ring.fd < 0 || sock < 0 || sock >= FD_SETSIZE || releasing[sock]) return;
+    releasing[sock] = 1;
+    cancel_recv(sock);
+}
+
+/* Call the `ready` handler each time `fd` becomes readable */
+int uring_poll(int fd)
+{
+    return arm_poll(fd);
+}
+
+// Take one completion off the queue; returns 0 when there is none.
+static int reap(struct io_uring_cqe *cqe)
+{
+    unsigned head = *ring.cq_head;
+    if (head == __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) return 0;
+    *cqe = ring.cqes[head & *ring.cq_mask];
+    __atomic_store_n(ring.cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+// Keep a completion for uring_wait. Running out of memory here leaves no way
+// to keep the ring consistent, so it ends the process.
+static void stash_push(const struct io_uring_cqe *cqe)
+{
+    if (num_stash == stash_size) {
+        int size = stash_size ? 2 * stash_size : URING_STASH;
+        struct io_uring_cqe *grown = (struct io_uring_cqe*)realloc(stash, (size_t)size * sizeof(*stash));
+        if (!grown) {
+            perror("io_uring completion stash");
+            exit(EXIT_FAILURE);
+        }
+        stash = grown;
+        stash_size = size;
+    }
+    stash[num_stash++] = *cqe;
+}
+
+/* Send every queued frame: per socket, a chain of sends linked so that they
+ * go out in order, and all the chains in one submission. The queues stay in
+ * place until the kernel is done with them, so this waits for the sends;
+ * other completions arriving meanwhile are kept for uring_wait. */
+void uring_flush(void)
+{
+    int n = protocol_pending(flushing);
+    for (int i = 0; i < n; i++) {
+        struct iovec iov[PROTOCOL_QUEUE_FRAMES];
+        int frames = protocol_queued(flushing[i], iov);
+        /* A chain must not be split across submissions */
+        if ((unsigned)frames > sq_space()) submit(0);
+        for (int f = 0; f < frames; f++) {
+            struct io_uring_sqe *sqe = get_sqe();
+            if (!sqe) break;
+            sqe->opcode = IORING_OP_SEND;
+            sqe->fd = flushing[i];
+            sqe->addr = (uint64_t)(uintptr_t)iov[f].iov_base;
+            sqe->len = (unsigned)iov[f].iov_len;
+            sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+            if (f + 1 < frames) sqe->flags = IOSQE_IO_LINK;
+            sqe->user_data = pack(OP_SEND, 0, flushing[i]);
+            ring.sends++;
+        }
+    }
+
+    while (ring.sends > 0) {
+        if (submit((unsigned)ring.sends) < 0) break;
+        struct io_uring_cqe cqe;
+        while (reap(&cqe)) {
+            if ((int)(cqe.user_data >> 56) == OP_SEND) {
+                ring.sends--;
+                /* A failed send cancels the rest of its chain; the receive
+                 * side then sees the connection go */
+                if (cqe.res < 0 && cqe.res != -ECANCELED) {
+                    fprintf(stderr, "send: %s\n", strerror(-cqe.res));
+                }
+            } else {
+                stash_push(&cqe);
+            }
+        }
+    }
+    ring.sends = 0;
+    for (int i = 0; i < n; i++) protocol_sent(flushing[i]);
+}
+
+static void handle(const struct io_uring_cqe *cqe, const uring_handlers_t *handlers)
+{
+    int op = (int)(cqe->user_data >> 56);
+    uint32_t gen = (uint32_t)(cqe->user_data >> 32) & GENERATION_MASK;
+    int fd = (int)(uint32_t)cqe->user_data;
+    int more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+
+    switch (op) {
+    case OP_ACCEPT:
+        if (cqe->res >= 0) {
+            handlers->accepted(cqe->res);
+        } else {
+            fprintf(stderr, "accept: %s\n", strerror(-cqe->res));
+        }
+        if (!more) arm_accept(fd);
+        break;
+    case OP_RECV: {
+        int current = gen == (generation[fd] & GENERATION_MASK);
+        if (cqe->res > 0) {
+            unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+            if (current) {
+                handlers->received(fd, ring.buffers + (size_t)bid * URING_BUFFER_SIZE, (size_t)cqe->res);
+            }
+            recycle(bid);
+        }
+        if (more) break;
+        if (releasing[fd]) {
+            releasing[fd] = 0;
+            generation[fd]++;
+            handlers->released(fd);
+            break;
+        }
+        /* The handler may have dropped the connection */
+        current = current && gen == (generation[fd] & GENERATION_MASK);
+        if (!current) break;
+        if (cqe->res > 0 || cqe->res == -ENOBUFS) {
+            arm_recv(fd);           /* out of buffers for a moment, or ended early */
+        } else {
+            handlers->received(fd, NULL, 0);
+        }
+        break;
+    }
+    case OP_SEND:
+        ring.sends--;
+        break;
+    case OP_POLL:
+        handlers->ready(fd);
+        arm_poll(fd);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Submit what is queued, wait for at least one completion and hand every
+ * available one to the handlers. Returns 0, or -1 if the ring failed. */
+int uring_wait(const uring_handlers_t *handlers)
+{
+    struct io_uring_cqe cqe;
+    if (num_stash > 0) {
+        /* Handlers only queue new work, they never reap: the stash is stable */
+        int n = num_stash;
+        num_stash = 0;
+        for (int i = 0; i < n; i++) handle(&stash[i], handlers);
+        if (submit(0) < 0) return -1;
+    } else if (submit(1) < 0) {
+        return -1;
+    }
+    while (reap(&cqe)) handle(&cqe, handlers);
+    return 0;
+}
+
+#else /* !__linux__ */
+
+int uring_init(void)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+void uring_shutdown(void) {}
+int uring_accept(SOCKET listen_sock) { (void)listen_sock; return -1; }
+int uring_recv(SOCKET sock) { (void)sock; return -1; }
+void uring_forget(SOCKET sock) { (void)sock; }
+void uring_release(SOCKET sock) { (void)sock; }
+int uring_poll(int fd) { (void)fd; return -1; }
+void uring_flush(void) {}
+int uring_wait(const uring_handlers_t *handlers) { (void)handlers; return -1; }
+
+#endif
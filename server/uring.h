@@ -0,0 +1,39 @@
+#ifndef SERVER_URING_H
+#define SERVER_URING_H
+
+#include <stddef.h>
+#include "../common/net.h"
+
+/* io_uring network backend for the event loop (Linux 6.0 or later).
+ *
+ * Connections are accepted by one multishot accept and read by one multishot
+ * receive each, into a ring of buffers provided to the kernel, so a busy
+ * server no longer pays a select scan and a read per ready socket. Queued
+ * frames are sent by uring_flush as linked sends, one chain per socket, all
+ * in a single submission. Completions are handed to the handlers on the
+ * thread that called uring_init, which is the only one to use the ring; each
+ * thread running an event loop sets up its own.
+ *
+ * uring_init fails when the kernel lacks a required feature (or io_uring is
+ * disabled); the caller then keeps its select loop. */
+
+typedef struct {
+    void (*accepted)(SOCKET sock);                                  /* new connection */
+    void (*received)(SOCKET sock, const char *data, size_t len);    /* len 0: closed */
+    void (*ready)(int fd);                                          /* uring_poll fired */
+    void (*released)(SOCKET sock);                                  /* uring_release done */
+} uring_handlers_t;
+
+int uring_init(void);
+void uring_shutdown(void);
+
+int uring_accept(SOCKET listen_sock);
+int uring_recv(SOCKET sock);
+void uring_forget(SOCKET sock);     /* stop receiving, before closing `sock` */
+void uring_release(SOCKET sock);    /* stop receiving, before another ring takes `sock` */
+int uring_poll(int fd);
+
+void uring_flush(void);
+int uring_wait(const uring_handlers_t *handlers);
+
+#endif
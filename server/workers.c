@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "workers.h"
+
+typedef struct work_item {
+    work_fn_t run;
+    work_fn_t done;
+    void *arg;
+    struct work_item *next;
+} work_item_t;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+static work_item_t *queue_head = NULL, *queue_tail = NULL;   /* waiting to run */
+static work_item_t *done_head = NULL, *done_tail = NULL;     /* waiting for the event loop */
+static pthread_t *threads = NULL;
+static int num_workers = 0;
+static int shutting_down = 0;
+static int notify_pipe[2] = {-1, -1};
+
+static void append(work_item_t **head, work_item_t **tail, work_item_t *item)
+{
+    item->next = NULL;
+    if (*tail) (*tail)->next = item;
+    else *head = item;
+    *tail = item;
+}
+
+// Worker thread body: pop jobs, run them, queue the completions for the event loop.
+static void *worker_main(void *unused)
+{
+    (void)unused;
+    for (;;) {
+        pthread_mutex_lock(&pool_lock);
+        while (!queue_head && !shutting_down) {
+            pthread_cond_wait(&pool_cond, &pool_lock);
+        }
+        if (shutting_down) {
+            pthread_mutex_unlock(&pool_lock);
+            return NULL;
+        }
+        work_item_t *item = queue_head;
+        queue_head = item->next;
+        if (!queue_head) queue_tail = NULL;
+        pthread_mutex_unlock(&pool_lock);
+
+        item->run(item->arg);
+
+        pthread_mutex_lock(&pool_lock);
+        int wake = (done_head == NULL);
+        append(&done_head, &done_tail, item);
+        pthread_mutex_unlock(&pool_lock);
+
+        /* One byte per batch is enough: the loop drains the whole done list */
+        if (wake) {
+            char b = 1;
+            if (write(notify_pipe[1], &b, 1) < 0 && errno != EAGAIN) perror("write");
+        }
+    }
+}
+
+// Start `num_threads` workers (at least one). Returns 0 on success.
+int workers_init(int num_threads)
+{
+    if (num_workers > 0) return 0;
+    if (num_threads < 1) num_threads = 1;
+
+    if (pipe(notify_pipe) < 0) {
+        perror("pipe");
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        int flags = fcntl(notify_pipe[i], F_GETFL, 0);
+        fcntl(notify_pipe[i], F_SETFL, flags | O_NONBLOCK);
+    }
+
+    threads = (pthread_t*)calloc(num_threads, sizeof(pthread_t));
+    if (!threads) return -1;
+    shutting_down = 0;
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_create(&threads[num_workers], NULL, worker_main, NULL) != 0) {
+            perror("pthread_create");
+            break;
+        }
+        num_workers++;
+    }
+    return num_workers > 0 ? 0 : -1;
+}
+
+// Stop and join all workers. Jobs that never ran are dropped without callbacks.
+void workers_shutdown(void)
+{
+    if (num_workers == 0) return;
+
+    pthread_mutex_lock(&pool_lock);
+    shutting_down = 1;
+    pthread_cond_broadcast(&pool_cond);
+    pthread_mutex_unlock(&pool_lock);
+    for (int i = 0; i < num_workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    threads = NULL;
+    num_workers = 0;
+
+    work_item_t *lists[2] = {queue_head, done_head};
+    for (int l = 0; l < 2; l++) {
+        while (lists[l]) {
+            work_item_t *next = lists[l]->next;
+            free(lists[l]);
+            lists[l] = next;
+        }
+    }
+    queue_head = queue_tail = done_head = done_tail = NULL;
+    close(notify_pipe[0]);
+    close(notify_pipe[1]);
+    notify_pipe[0] = notify_pipe[1] = -1;
+}
+
+int workers_count(void)
+{
+    return num_workers;
+}
+
+// Queue a job. Returns 0 on success, -1 if the pool is not running.
+int workers_submit(work_fn_t run, work_fn_t done, void *arg)
+{
+    if (num_workers == 0 || !run) return -1;
+    work_item_t *item = (work_item_t*)malloc(sizeof(work_item_t));
+    if (!item) return -1;
+    item->run = run;
+    item->done = done;
+    item->arg = arg;
+
+    pthread_mutex_lock(&pool_lock);
+    append(&queue_head, &queue_tail, item);
+    pthread_cond_signal(&pool_cond);
+    pthread_mutex_unlock(&pool_lock);
+    return 0;
+}
+
+// Queue a completion directly, skipping the worker queue. Returns 0 on success.
+int workers_defer(work_fn_t done, void *arg)
+{
+    if (num_workers == 0 || !done) return -1;
+    work_item_t *item = (work_item_t*)malloc(sizeof(work_item_t));
+    if (!item) return -1;
+    item->run = NULL;
+    item->done = done;
+    item->arg = arg;
+
+    pthread_mutex_lock(&pool_lock);
+    int wake = (done_head == NULL);
+    append(&done_head, &done_tail, item);
+    pthread_mutex_unlock(&pool_lock);
+
+    if (wake) {
+        char b = 1;
+        if (write(notify_pipe[1], &b, 1) < 0 && errno != EAGAIN) perror("write");
+    }
+    return 0;
+}
+
+int workers_fd(void)
+{
+    return notify_pipe[0];
+}
+
+// Run the completion callbacks of finished jobs. Call from the event loop thread only.
+void workers_dispatch(void)
+{
+    char buf[64];
+    while (read(notify_pipe[0], buf, sizeof(buf)) > 0) {
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    work_item_t *item = done_head;
+    done_head = done_tail = NULL;
+    pthread_mutex_unlock(&pool_lock);
+
+    while (item) {
+        work_item_t *next = item->next;
+        if (item->done) item->done(item->arg);
+        free(item);
+        item = next;
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef SERVER_WORKERS_H
+#define SERVER_WORKERS_H
+
+/* Background worker pool. Jobs run on worker threads; their completion
+ * callbacks are handed back to the event loop through a notification pipe
+ * so that all session/player state is still only touched by run_server. */
+
+typedef void (*work_fn_t)(void *arg);
+
+int workers_init(int num_threads);
+void workers_shutdown(void);
+int workers_count(void);
+
+/* `run` executes on a worker thread, `done` (optional) later on the event loop */
+int workers_submit(work_fn_t run, work_fn_t done, void *arg);
+
+/* Run `done` on the event loop's next dispatch, without going through a worker */
+int workers_defer(work_fn_t done, void *arg);
+
+/* Event loop integration: select on workers_fd(), then call workers_dispatch() */
+int workers_fd(void);
+void workers_dispatch(void);
+
+#endif
@@ -0,0 +1,308 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../game/awale.h"
+#include "../game/archive.h"
+#include "../game/nn.h"
+
+/* Trainer for the neural evaluation.
+ * Usage: awale_nntrain [-d dir] [-e epochs] [-r rate] [-o file]
+ *
+ * Every position of the saved_games archive is a sample: the inputs are the
+ * board seen by the side to move, the target the seeds that side still gained
+ * by the end of the game. The float network mirrors the quantized one (clipped
+ * ReLU on [0, 1], weights clipped to the int8 range) and is trained with Adam. */
+
+#define BATCH_SIZE 256
+#define WEIGHT_CLIP (127.0f / NN_QUANT)
+#define TARGET_CLIP 4.0f            /* in units of NN_OUTPUT_SEEDS */
+
+typedef struct {
+    uint8_t features[TOTAL_HOLES];  /* one active input per hole */
+    float target;                   /* future seed gain / NN_OUTPUT_SEEDS */
+} sample_t;
+
+typedef struct {
+    sample_t *items;
+    size_t count;
+    size_t capacity;
+} sample_list_t;
+
+/* Float parameters in one block, so Adam walks them as a flat array */
+typedef struct {
+    float w1[NN_INPUTS][NN_L1];
+    float b1[NN_L1];
+    float w2[NN_L2][NN_L1];
+    float b2[NN_L2];
+    float w3[NN_L2];
+    float b3;
+} params_t;
+
+#define NUM_PARAMS (sizeof(params_t) / sizeof(float))
+
+static int collect_sample(const archive_game_t *info, const awale_game_t *before, int hole, void *ctx)
+{
+    (void)hole;
+    sample_list_t *list = (sample_list_t*)ctx;
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 4096;
+        sample_t *items = (sample_t*)realloc(list->items, capacity * sizeof(sample_t));
+        if (!items) return -1;
+        list->items = items;
+        list->capacity = capacity;
+    }
+
+    int me = before->current_player;
+    sample_t *s = &list->items[list->count++];
+    for (int h = 0; h < TOTAL_HOLES; h++) s->features[h] = (uint8_t)nn_feature(me, h, before->holes[h]);
+    int gain = (info->scores[me] - info->scores[1 - me]) - (before->scores[me] - before->scores[1 - me]);
+    float target = (float)gain / NN_OUTPUT_SEEDS;
+    s->target = target > TARGET_CLIP ? TARGET_CLIP : (target < -TARGET_CLIP ? -TARGET_CLIP : target);
+    return 0;
+}
+
+static float clampf(float x, float lo, float hi)
+{
+    return x < lo ? lo : (x > hi ? hi : x);
+}
+
+// Forward pass; keeps the activations needed by backprop when `a1`/`a2` are given.
+static float forward(const params_t *p, const sample_t *s, float *a1, float *a2)
+{
+    float h1[NN_L1], h2[NN_L2];
+    for (int i = 0; i < NN_L1; i++) h1[i] = p->b1[i];
+    for (int h = 0; h < TOTAL_HOLES; h++) {
+        for (int i = 0; i < NN_L1; i++) h1[i] += p->w1[s->features[h]][i];
+    }
+    for (int i = 0; i < NN_L1; i++) h1[i] = clampf(h1[i], 0.0f, 1.0f);
+
+    float y = p->b3;
+    for (int j = 0; j < NN_L2; j++) {
+        float z = p->b2[j];
+        for (int i = 0; i < NN_L1; i++) z += p->w2[j][i] * h1[i];
+        h2[j] = clampf(z, 0.0f, 1.0f);
+        y += p->w3[j] * h2[j];
+    }
+    if (a1) memcpy(a1, h1, sizeof(h1));
+    if (a2) memcpy(a2, h2, sizeof(h2));
+    return y;
+}
+
+// Accumulate the squared-error gradient of one sample into `g`.
+static float backward(const params_t *p, const sample_t *s, params_t *g)
+{
+    float a1[NN_L1], a2[NN_L2], d1[NN_L1];
+    float err = forward(p, s, a1, a2) - s->target;
+
+    g->b3 += err;
+    memset(d1, 0, sizeof(d1));
+    for (int j = 0; j < NN_L2; j++) {
+        g->w3[j] += err * a2[j];
+        /* Clipped ReLU passes gradient only strictly inside (0, 1) */
+        if (a2[j] <= 0.0f || a2[j] >= 1.0f) continue;
+        float d2 = err * p->w3[j];
+        g->b2[j] += d2;
+        for (int i = 0; i < NN_L1; i++) {
+            g->w2[j][i] += d2 * a1[i];
+            d1[i] += d2 * p->w2[j][i];
+        }
+    }
+    for (int i = 0; i < NN_L1; i++) {
+        if (a1[i] <= 0.0f || a1[i] >= 1.0f) continue;
+        g->b1[i] += d1[i];
+        for (int h = 0; h < TOTAL_HOLES; h++) g->w1[s->features[h]][i] += d1[i];
+    }
+    return err * err;
+}
+
+static float rand_uniform(unsigned int *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return ((*seed >> 8) & 0xFFFF) / 65536.0f;
+}
+
+static void init_params(params_t *p, unsigned int seed)
+{
+    memset(p, 0, sizeof(*p));
+    /* Small positive first-layer biases keep the clipped ReLUs alive at start */
+    for (int i = 0; i < NN_L1; i++) p->b1[i] = 0.25f;
+    for (int f = 0; f < NN_INPUTS; f++) {
+        for (int i = 0; i < NN_L1; i++) p->w1[f][i] = (rand_uniform(&seed) - 0.5f) * 0.2f;
+    }
+    for (int j = 0; j < NN_L2; j++) {
+        p->b2[j] = 0.25f;
+        for (int i = 0; i < NN_L1; i++) p->w2[j][i] = (rand_uniform(&seed) - 0.5f) * 0.25f;
+        p->w3[j] = (rand_uniform(&seed) - 0.5f) * 0.5f;
+    }
+}
+
+static void clip_params(params_t *p)
+{
+    for (int f = 0; f < NN_INPUTS; f++) {
+        for (int i = 0; i < NN_L1; i++) p->w1[f][i] = clampf(p->w1[f][i], -WEIGHT_CLIP, WEIGHT_CLIP);
+    }
+    for (int j = 0; j < NN_L2; j++) {
+        for (int i = 0; i < NN_L1; i++) p->w2[j][i] = clampf(p->w2[j][i], -WEIGHT_CLIP, WEIGHT_CLIP);
+        p->w3[j] = clampf(p->w3[j], -WEIGHT_CLIP, WEIGHT_CLIP);
+    }
+}
+
+static int quantize(float x, int lo, int hi)
+{
+    long v = lroundf(x);
+    return v < lo ? lo : (v > hi ? hi : (int)v);
+}
+
+// Convert to the inference format (see the fixed-point units in nn.h).
+static void export_weights(const params_t *p, nn_weights_t *w)
+{
+    const float q = NN_QUANT, qq = (float)NN_QUANT * NN_QUANT;
+    for (int f = 0; f < NN_INPUTS; f++) {
+        for (int i = 0; i < NN_L1; i++) w->w1[f][i] = (int8_t)quantize(p->w1[f][i] * q, -127, 127);
+    }
+    for (int i = 0; i < NN_L1; i++) w->b1[i] = (int16_t)quantize(p->b1[i] * q, -32767, 32767);
+    for (int j = 0; j < NN_L2; j++) {
+        for (int i = 0; i < NN_L1; i++) w->w2[j][i] = (int8_t)quantize(p->w2[j][i] * q, -127, 127);
+        w->b2[j] = quantize(p->b2[j] * qq, -(1 << 30), 1 << 30);
+        w->w3[j] = (int8_t)quantize(p->w3[j] * q, -127, 127);
+    }
+    w->b3 = quantize(p->b3 * qq, -(1 << 30), 1 << 30);
+}
+
+// Mean squared error in seeds^2 over `samples`, for the network and for the
+// classic evaluation (which predicts no further gain).
+static void evaluate_set(const params_t *p, const sample_t *samples, size_t n, double *net_mse, double *base_mse)
+{
+    double net = 0.0, base = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double e = (forward(p, &samples[i], NULL, NULL) - samples[i].target) * NN_OUTPUT_SEEDS;
+        double b = samples[i].target * NN_OUTPUT_SEEDS;
+        net += e * e;
+        base += b * b;
+    }
+    *net_mse = n ? net / n : 0.0;
+    *base_mse = n ? base / n : 0.0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-d dir] [-e epochs] [-r rate] [-o file]\n", prog);
+    fprintf(stderr, "  -d  directory of saved games (default saved_games)\n");
+    fprintf(stderr, "  -e  training epochs (default 30)\n");
+    fprintf(stderr, "  -r  Adam learning rate (default 0.001)\n");
+    fprintf(stderr, "  -o  output file (default %s)\n", NN_DEFAULT_FILE);
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = "saved_games";
+    const char *path = NN_DEFAULT_FILE;
+    int epochs = 30;
+    float rate = 0.001f;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            epochs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rate = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (epochs < 1 || rate <= 0.0f) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char **files = NULL;
+    int num_files = archive_list(dir, &files);
+    if (num_files < 0) {
+        perror(dir);
+        return EXIT_FAILURE;
+    }
+    sample_list_t samples = { NULL, 0, 0 };
+    int games = 0;
+    for (int i = 0; i < num_files; i++) {
+        if (archive_replay(files[i], 0, collect_sample, &samples) > 0) games++;
+    }
+    archive_free_list(files, num_files);
+    if (samples.count < 2 * BATCH_SIZE) {
+        fprintf(stderr, "Not enough positions in %s (%zu from %d games)\n", dir, samples.count, games);
+        free(samples.items);
+        return EXIT_FAILURE;
+    }
+
+    /* Shuffle once; the last tenth is held out for validation */
+    unsigned int seed = 12345;
+    for (size_t i = samples.count - 1; i > 0; i--) {
+        seed = seed * 1103515245u + 12345u;
+        size_t j = ((size_t)(seed >> 4) * 4099u + i) % (i + 1);
+        sample_t tmp = samples.items[i];
+        samples.items[i] = samples.items[j];
+        samples.items[j] = tmp;
+    }
+    size_t n_valid = samples.count / 10;
+    size_t n_train = samples.count - n_valid;
+    sample_t *valid = samples.items + n_train;
+    printf("%zu positions from %d games (%zu for training)\n", samples.count, games, n_train);
+
+    params_t *p = (params_t*)malloc(sizeof(params_t));
+    params_t *g = (params_t*)malloc(sizeof(params_t));
+    params_t *m = (params_t*)calloc(1, sizeof(params_t));
+    params_t *v = (params_t*)calloc(1, sizeof(params_t));
+    nn_weights_t *w = (nn_weights_t*)malloc(sizeof(nn_weights_t));
+    if (!p || !g || !m || !v || !w) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+    init_params(p, 42);
+
+    const float beta1 = 0.9f, beta2 = 0.999f, eps = 1e-8f;
+    long step = 0;
+    for (int epoch = 1; epoch <= epochs; epoch++) {
+        double loss = 0.0;
+        for (size_t start = 0; start < n_train; start += BATCH_SIZE) {
+            size_t end = start + BATCH_SIZE < n_train ? start + BATCH_SIZE : n_train;
+            memset(g, 0, sizeof(*g));
+            for (size_t i = start; i < end; i++) loss += backward(p, &samples.items[i], g);
+
+            step++;
+            float *pp = (float*)p, *gg = (float*)g, *mm = (float*)m, *vv = (float*)v;
+            float scale = 1.0f / (float)(end - start);
+            float c1 = 1.0f - powf(beta1, (float)step), c2 = 1.0f - powf(beta2, (float)step);
+            for (size_t k = 0; k < NUM_PARAMS; k++) {
+                float grad = gg[k] * scale;
+                mm[k] = beta1 * mm[k] + (1.0f - beta1) * grad;
+                vv[k] = beta2 * vv[k] + (1.0f - beta2) * grad * grad;
+                pp[k] -= rate * (mm[k] / c1) / (sqrtf(vv[k] / c2) + eps);
+            }
+            clip_params(p);
+        }
+        double net_mse, base_mse;
+        evaluate_set(p, valid, n_valid, &net_mse, &base_mse);
+        printf("epoch %2d: train %.3f, validation %.3f seeds^2 (score difference alone: %.3f)\n", epoch,
+               loss / n_train * NN_OUTPUT_SEEDS * NN_OUTPUT_SEEDS, net_mse, base_mse);
+    }
+
+    export_weights(p, w);
+    int rc = nn_save(path, w);
+    if (rc == 0) printf("Network written to %s\n", path);
+    else perror(path);
+    free(p);
+    free(g);
+    free(m);
+    free(v);
+    free(w);
+    free(samples.items);
+    return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,317 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../game/awale.h"
+
+/* Perft: count the positions reached after exactly N moves.
+ * Usage: awale_perft [-d depth] [-t threads] [-f file] [-r rules] [-v]
+ *
+ * Without -f, counts from the initial position for every depth up to N. With
+ * -f, runs each position of the file; a line holds the 12 holes, both scores
+ * and the side to move, optionally followed by "; depth nodes" expectations:
+ *
+ *   4 4 4 4 4 4 4 4 4 4 4 4 0 0 0 ; 1 6 ; 2 36 ; 3 190
+ *
+ * Expectations up to -d are checked and any mismatch fails the run, so the
+ * suite guards the sowing and capture rules against optimizations. -r counts
+ * under a rule variant instead of the standard rules; in a suite, a line
+ * "rules <name>" switches the variant for the positions that follow. The work
+ * is split two plies below the root and shared out among the threads. */
+
+#define SPLIT_PLIES 2
+#define MAX_TASKS 64                /* 6 moves x 6 replies at most */
+#define MAX_EXPECTED 32
+
+typedef struct {
+    awale_game_t game;
+    int root_move;
+    uint64_t nodes;
+} perft_task_t;
+
+typedef struct {
+    perft_task_t tasks[MAX_TASKS];
+    int num_tasks;
+    int depth;                      /* remaining below the tasks */
+    int next;
+} perft_job_t;
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Collect the positions `plies` moves below `game`; a game that ends early
+// becomes a task of its own (it counts nothing below).
+static void collect_tasks(perft_job_t *job, const awale_game_t *game, int plies, int root_move)
+{
+    if (plies == 0 || game->game_over) {
+        perft_task_t *task = &job->tasks[job->num_tasks++];
+        task->game = *game;
+        task->root_move = root_move;
+        task->nodes = 0;
+        return;
+    }
+    int holes = awale_variant_info(game->variant)->holes_per_player;
+    int start = game->current_player * holes;
+    for (int hole = start; hole < start + holes; hole++) {
+        if (!awale_is_valid_move(game, hole)) continue;
+        awale_game_t child = *game;
+        awale_play_move(&child, hole);
+        collect_tasks(job, &child, plies - 1, root_move < 0 ? hole : root_move);
+    }
+}
+
+static void *perft_worker(void *arg)
+{
+    perft_job_t *job = (perft_job_t*)arg;
+    for (;;) {
+        int i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (i >= job->num_tasks) break;
+        perft_task_t *task = &job->tasks[i];
+        /* Tasks cut short by the end of the game are leaves only at the exact depth */
+        task->nodes = task->game.game_over ? 0 : awale_perft(&task->game, job->depth);
+    }
+    return NULL;
+}
+
+// Perft with the root split among `nthreads`; fills per-root-move counts when asked.
+static uint64_t perft_split(const awale_game_t *game, int depth, int nthreads, uint64_t divide[TOTAL_HOLES])
+{
+    if (divide) memset(divide, 0, TOTAL_HOLES * sizeof(uint64_t));
+    if (depth <= SPLIT_PLIES) {
+        uint64_t total = 0;
+        int holes = awale_variant_info(game->variant)->holes_per_player;
+        int start = game->current_player * holes;
+        for (int hole = start; hole < start + holes; hole++) {
+            if (!awale_is_valid_move(game, hole)) continue;
+            awale_game_t child = *game;
+            awale_play_move(&child, hole);
+            uint64_t nodes = awale_perft(&child, depth - 1);
+            if (divide) divide[hole] = nodes;
+            total += nodes;
+        }
+        return total;
+    }
+
+    perft_job_t *job = (perft_job_t*)calloc(1, sizeof(perft_job_t));
+    if (!job) return 0;
+    collect_tasks(job, game, SPLIT_PLIES, -1);
+    job->depth = depth - SPLIT_PLIES;
+
+    pthread_t tids[MAX_TASKS];
+    int started = 0;
+    if (nthreads > job->num_tasks) nthreads = job->num_tasks;
+    for (int i = 1; i < nthreads; i++) {
+        if (pthread_create(&tids[started], NULL, perft_worker, job) == 0) started++;
+    }
+    perft_worker(job);
+    for (int i = 0; i < started; i++) pthread_join(tids[i], NULL);
+
+    uint64_t total = 0;
+    for (int i = 0; i < job->num_tasks; i++) {
+        total += job->tasks[i].nodes;
+        if (divide) divide[job->tasks[i].root_move] += job->tasks[i].nodes;
+    }
+    free(job);
+    return total;
+}
+
+static void print_divide(const awale_game_t *game, const uint64_t divide[TOTAL_HOLES])
+{
+    int holes = awale_variant_info(game->variant)->holes_per_player;
+    int start = game->current_player * holes;
+    for (int hole = start; hole < start + holes; hole++) {
+        if (awale_is_valid_move(game, hole)) {
+            printf("    move %2d: %llu\n", hole, (unsigned long long)divide[hole]);
+        }
+    }
+}
+
+static void print_count(int depth, uint64_t nodes, double elapsed)
+{
+    printf("  depth %2d  %14llu nodes  %9.3f s  %12.0f nodes/s\n", depth,
+           (unsigned long long)nodes, elapsed, elapsed > 0.0 ? (double)nodes / elapsed : 0.0);
+}
+
+// Parse "h0..h11 s0 s1 side [; depth nodes]...". Returns the number of
+// expectations, or -1 if the line is not a valid position.
+static int parse_position(char *line, int variant, awale_game_t *game, int *depths, uint64_t *counts)
+{
+    int v[TOTAL_HOLES + 3];
+    int used = 0, n;
+    memset(game, 0, sizeof(*game));
+    game->variant = variant;
+    for (int i = 0; i < TOTAL_HOLES + 3; i++) {
+        if (sscanf(line + used, "%d%n", &v[i], &n) != 1 || v[i] < 0) return -1;
+        used += n;
+    }
+    int seeds = 0;
+    for (int h = 0; h < TOTAL_HOLES; h++) {
+        game->holes[h] = v[h];
+        seeds += v[h];
+    }
+    game->scores[0] = v[TOTAL_HOLES];
+    game->scores[1] = v[TOTAL_HOLES + 1];
+    game->current_player = v[TOTAL_HOLES + 2];
+    game->winner = -1;
+    const awale_variant_info_t *rules = awale_variant_info(variant);
+    if (game->current_player > 1 ||
+        seeds + game->scores[0] + game->scores[1] != 2 * rules->holes_per_player * rules->initial_seeds) {
+        return -1;
+    }
+
+    int expected = 0;
+    char *p = line + used;
+    while ((p = strchr(p, ';')) != NULL && expected < MAX_EXPECTED) {
+        unsigned long long count;
+        p++;
+        if (sscanf(p, "%d %llu", &depths[expected], &count) != 2) return -1;
+        counts[expected++] = count;
+    }
+    return expected;
+}
+
+// Run every position of a suite file. Returns the number of mismatches, or -1.
+static int run_suite(const char *path, int variant, int max_depth, int nthreads, int verbose)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char line[512];
+    int line_no = 0, positions = 0, checked = 0, failures = 0;
+    uint64_t total_nodes = 0;
+    double total_time = 0.0;
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        line[strcspn(line, "#\r\n")] = '\0';
+        if (strspn(line, " \t") == strlen(line)) continue;
+
+        char name[32];
+        if (sscanf(line, " rules %31s", name) == 1) {
+            variant = awale_variant_by_name(name);
+            if (variant < 0) {
+                fprintf(stderr, "%s:%d: unknown rules '%s'\n", path, line_no, name);
+                fclose(f);
+                return -1;
+            }
+            printf("%s:%d: %s rules\n", path, line_no, name);
+            continue;
+        }
+
+        awale_game_t game;
+        int depths[MAX_EXPECTED];
+        uint64_t counts[MAX_EXPECTED];
+        int expected = parse_position(line, variant, &game, depths, counts);
+        if (expected < 0) {
+            fprintf(stderr, "%s:%d: bad position\n", path, line_no);
+            fclose(f);
+            return -1;
+        }
+        positions++;
+        printf("%s:%d:", path, line_no);
+        for (int h = 0; h < TOTAL_HOLES; h++) printf(" %d", game.holes[h]);
+        printf("  (%d-%d, player %d to move)\n", game.scores[0], game.scores[1], game.current_player);
+
+        for (int depth = 1; depth <= max_depth; depth++) {
+            int want = -1;
+            for (int i = 0; i < expected; i++) {
+                if (depths[i] == depth) want = i;
+            }
+            /* Past the recorded depths only the deepest count is worth the time */
+            if (want < 0 && expected > 0 && depth != max_depth) continue;
+
+            uint64_t divide[TOTAL_HOLES];
+            double start = now_seconds();
+            uint64_t nodes = perft_split(&game, depth, nthreads, verbose ? divide : NULL);
+            double elapsed = now_seconds() - start;
+            total_nodes += nodes;
+            total_time += elapsed;
+            print_count(depth, nodes, elapsed);
+            if (verbose) print_divide(&game, divide);
+            if (want >= 0) {
+                checked++;
+                if (nodes != counts[want]) {
+                    printf("  MISMATCH at depth %d: expected %llu\n", depth, (unsigned long long)counts[want]);
+                    failures++;
+                }
+            }
+        }
+    }
+    fclose(f);
+
+    printf("%d positions, %d counts checked, %d mismatches, %llu nodes in %.3f s (%.0f nodes/s)\n",
+           positions, checked, failures, (unsigned long long)total_nodes, total_time,
+           total_time > 0.0 ? (double)total_nodes / total_time : 0.0);
+    return failures;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-d depth] [-t threads] [-f file] [-r rules] [-v]\n", prog);
+    fprintf(stderr, "  -d  maximum depth (default 10, or 8 with -f)\n");
+    fprintf(stderr, "  -t  threads (default: all cores)\n");
+    fprintf(stderr, "  -f  position suite, checked against its expected counts\n");
+    fprintf(stderr, "  -r  rule variant (default standard)\n");
+    fprintf(stderr, "  -v  show the count below each root move\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *suite = NULL;
+    int depth = 0, verbose = 0;
+    int variant = AWALE_VARIANT_STANDARD;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = cores > 0 ? (int)cores : 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            nthreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            suite = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            variant = awale_variant_by_name(argv[++i]);
+            if (variant < 0) {
+                fprintf(stderr, "Unknown rules '%s'\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (depth == 0) depth = suite ? 8 : 10;
+    if (depth < 1 || nthreads < 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (nthreads > MAX_TASKS) nthreads = MAX_TASKS;
+
+    if (suite) return run_suite(suite, variant, depth, nthreads, verbose) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    awale_game_t game;
+    awale_reset_variant(&game, variant);
+    printf("Initial position, %s rules, %d threads\n", awale_variant_info(variant)->name, nthreads);
+    for (int d = 1; d <= depth; d++) {
+        uint64_t divide[TOTAL_HOLES];
+        double start = now_seconds();
+        uint64_t nodes = perft_split(&game, d, nthreads, verbose ? divide : NULL);
+        print_count(d, nodes, now_seconds() - start);
+        if (verbose) print_divide(&game, divide);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,581 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../game/awale.h"
+#include "../game/ai.h"
+#include "../game/nn.h"
+
+/* Self-play tournaments and evaluation tuning.
+ * Usage: awale_selfplay [-a spec] [-b spec] [-g games] [-t threads] [-r plies]
+ *                       [-s seed] [-l log] [-c every] [-R]
+ *        awale_selfplay -T log [-o file]
+ *
+ * Engine A plays engine B; games come in pairs that share a random opening
+ * with the colors swapped. Every position after the opening is streamed into
+ * a binary log (16-byte header, then 16-byte records) in game order, and a
+ * checkpoint next to the log lets a killed run continue with -R.
+ *
+ * -T fits the linear evaluation weights (ai_eval_features) to the logged
+ * results, Texel style: a logistic of the evaluation should predict the game
+ * outcome, and each weight is nudged while the squared error drops. */
+
+#define LOG_MAGIC "AWPL"
+#define LOG_VERSION 1
+#define MAX_GAME_PLIES 400          /* adjudicated on the score after this */
+#define DEFAULT_GAMES 1000
+#define DEFAULT_CHECKPOINT 100
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t reserved;
+} log_header_t;
+
+/* One position: the board, the side to move and how the game ended */
+typedef struct {
+    uint8_t holes[TOTAL_HOLES];
+    uint8_t scores[2];
+    uint8_t side;
+    int8_t result;                  /* for player 0: 1 win, 0 draw, -1 loss */
+} log_record_t;
+
+typedef struct {
+    const char *spec;
+    ai_config_t cfg;
+    ai_weights_t weights;
+} engine_t;
+
+typedef struct {
+    log_record_t *records;
+    int count;
+    int result;                     /* for engine A */
+} game_log_t;
+
+/* Tournament state shared by the player threads */
+typedef struct {
+    engine_t engines[2];
+    int games;
+    int opening_plies;
+    unsigned int seed;
+    int checkpoint_every;
+    const char *log_path;
+    FILE *log;
+
+    pthread_mutex_t lock;
+    int next_game;                  /* next index to hand out */
+    int written;                    /* games flushed to the log, in order */
+    game_log_t **pending;           /* finished games waiting for their turn */
+    long long records;
+    int wins[2];
+    int draws;
+    struct timespec start;
+} tournament_t;
+
+// Parse "depth=N,ms=N,eval=classic|nn|<weights file>".
+static int parse_engine(const char *spec, engine_t *e, uint64_t salt)
+{
+    ai_config_default(&e->cfg);
+    e->cfg.max_depth = 8;
+    e->cfg.tt_salt = salt;
+    e->spec = spec;
+
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        if (strncmp(tok, "depth=", 6) == 0) {
+            e->cfg.max_depth = atoi(tok + 6);
+        } else if (strncmp(tok, "ms=", 3) == 0) {
+            e->cfg.time_ms = atoi(tok + 3);
+        } else if (strcmp(tok, "eval=classic") == 0) {
+            e->cfg.use_nn = 0;
+            e->cfg.weights = NULL;
+        } else if (strcmp(tok, "eval=nn") == 0) {
+            if (!nn_loaded() && nn_load(NN_DEFAULT_FILE) != 0) {
+                fprintf(stderr, "Cannot load %s\n", NN_DEFAULT_FILE);
+                return -1;
+            }
+            e->cfg.use_nn = 1;
+        } else if (strncmp(tok, "eval=", 5) == 0) {
+            if (ai_weights_load(tok + 5, &e->weights) != 0) {
+                perror(tok + 5);
+                return -1;
+            }
+            e->cfg.weights = &e->weights;
+        } else {
+            fprintf(stderr, "Unknown engine option '%s'\n", tok);
+            return -1;
+        }
+    }
+    if (e->cfg.max_depth < 1 || e->cfg.max_depth >= AI_MAX_DEPTH || e->cfg.time_ms < 0) {
+        fprintf(stderr, "Bad engine spec '%s'\n", spec);
+        return -1;
+    }
+    return 0;
+}
+
+static unsigned int next_random(unsigned int *state)
+{
+    *state = *state * 1103515245u + 12345u;
+    return *state >> 16;
+}
+
+// Play game `index`: engine A has player 0 in even games, player 1 in odd ones.
+static game_log_t *play_game(const tournament_t *t, int index)
+{
+    game_log_t *g = (game_log_t*)calloc(1, sizeof(game_log_t));
+    if (!g) return NULL;
+    g->records = (log_record_t*)malloc(MAX_GAME_PLIES * sizeof(log_record_t));
+    if (!g->records) {
+        free(g);
+        return NULL;
+    }
+
+    awale_game_t game;
+    awale_reset(&game);
+    unsigned int rng = t->seed ^ (unsigned int)(index / 2) * 2654435761u;
+    for (int ply = 0; ply < t->opening_plies && !game.game_over; ply++) {
+        int moves[HOLES_PER_PLAYER], n = 0;
+        for (int i = 0; i < HOLES_PER_PLAYER; i++) {
+            int hole = game.current_player * HOLES_PER_PLAYER + i;
+            if (awale_is_valid_move(&game, hole)) moves[n++] = hole;
+        }
+        if (n == 0) break;
+        awale_play_move(&game, moves[next_random(&rng) % n]);
+    }
+
+    int a_player = index % 2;
+    for (int ply = 0; ply < MAX_GAME_PLIES && !game.game_over; ply++) {
+        log_record_t *r = &g->records[g->count++];
+        for (int h = 0; h < TOTAL_HOLES; h++) r->holes[h] = (uint8_t)game.holes[h];
+        r->scores[0] = (uint8_t)game.scores[0];
+        r->scores[1] = (uint8_t)game.scores[1];
+        r->side = (uint8_t)game.current_player;
+
+        const engine_t *e = &t->engines[game.current_player == a_player ? 0 : 1];
+        ai_result_t result;
+        if (ai_search(&game, &e->cfg, &result) != 0 || result.best_move < 0) break;
+        awale_play_move(&game, result.best_move);
+    }
+
+    /* Unfinished games go to whoever is ahead */
+    int winner = game.game_over ? game.winner
+               : (game.scores[0] > game.scores[1] ? 0 : (game.scores[1] > game.scores[0] ? 1 : -1));
+    int result0 = winner < 0 ? 0 : (winner == 0 ? 1 : -1);
+    for (int i = 0; i < g->count; i++) g->records[i].result = (int8_t)result0;
+    g->result = a_player == 0 ? result0 : -result0;
+    return g;
+}
+
+static double elapsed_seconds(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void checkpoint_path(const char *log_path, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s.ckpt", log_path);
+}
+
+// Record how far the log is valid; written aside and renamed so it is never torn.
+static int write_checkpoint(const tournament_t *t)
+{
+    char path[512], tmp[520];
+    checkpoint_path(t->log_path, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if (fflush(t->log) != 0 || fsync(fileno(t->log)) != 0) return -1;
+
+    FILE *f = fopen(tmp, "w");
+    if (!f) return -1;
+    fprintf(f, "a %s\nb %s\ngames %d\nrecords %lld\nwins %d %d\ndraws %d\n",
+            t->engines[0].spec, t->engines[1].spec, t->written, t->records,
+            t->wins[0], t->wins[1], t->draws);
+    if (fflush(f) != 0 || fsync(fileno(f)) != 0) {
+        fclose(f);
+        return -1;
+    }
+    if (fclose(f) != 0) return -1;
+    return rename(tmp, path);
+}
+
+static int read_checkpoint(tournament_t *t)
+{
+    char path[512], line[512];
+    checkpoint_path(t->log_path, path, sizeof(path));
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int fields = 0;
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (strncmp(line, "a ", 2) == 0 && strcmp(line + 2, t->engines[0].spec) != 0) {
+            fprintf(stderr, "Warning: checkpoint was made with -a %s\n", line + 2);
+        } else if (strncmp(line, "b ", 2) == 0 && strcmp(line + 2, t->engines[1].spec) != 0) {
+            fprintf(stderr, "Warning: checkpoint was made with -b %s\n", line + 2);
+        }
+        fields += sscanf(line, "games %d", &t->written);
+        fields += sscanf(line, "records %lld", &t->records);
+        fields += sscanf(line, "wins %d %d", &t->wins[0], &t->wins[1]) == 2;
+        fields += sscanf(line, "draws %d", &t->draws);
+    }
+    fclose(f);
+    return fields == 4 ? 0 : -1;
+}
+
+static void print_progress(const tournament_t *t)
+{
+    int n = t->wins[0] + t->wins[1] + t->draws;
+    double score = n ? (t->wins[0] + 0.5 * t->draws) / n : 0.5;
+    printf("%d/%d games  A %d  B %d  draws %d  score %.1f%%", t->written, t->games,
+           t->wins[0], t->wins[1], t->draws, 100.0 * score);
+    if (score > 0.0 && score < 1.0) printf("  Elo %+.0f", -400.0 * log10(1.0 / score - 1.0));
+    printf("  %.0f s\n", elapsed_seconds(&t->start));
+    fflush(stdout);
+}
+
+// Called with the lock held: append every finished game that is next in order.
+static int flush_games(tournament_t *t)
+{
+    while (t->written < t->games && t->pending[t->written]) {
+        game_log_t *g = t->pending[t->written];
+        t->pending[t->written] = NULL;
+        if (fwrite(g->records, sizeof(log_record_t), (size_t)g->count, t->log) != (size_t)g->count) {
+            perror("write");
+            return -1;
+        }
+        t->records += g->count;
+        if (g->result > 0) t->wins[0]++;
+        else if (g->result < 0) t->wins[1]++;
+        else t->draws++;
+        t->written++;
+        free(g->records);
+        free(g);
+
+        if (t->written % t->checkpoint_every == 0 || t->written == t->games) {
+            if (write_checkpoint(t) != 0) {
+                perror("checkpoint");
+                return -1;
+            }
+            print_progress(t);
+        }
+    }
+    return 0;
+}
+
+static void *player_main(void *arg)
+{
+    tournament_t *t = (tournament_t*)arg;
+    for (;;) {
+        pthread_mutex_lock(&t->lock);
+        int index = t->next_game < t->games ? t->next_game++ : -1;
+        pthread_mutex_unlock(&t->lock);
+        if (index < 0) break;
+
+        game_log_t *g = play_game(t, index);
+        pthread_mutex_lock(&t->lock);
+        int failed = !g;
+        if (g) {
+            t->pending[index] = g;
+            failed = flush_games(t) != 0;
+        }
+        if (failed) t->next_game = t->games;
+        pthread_mutex_unlock(&t->lock);
+        if (failed) break;
+    }
+    return NULL;
+}
+
+// Open the log for appending, fresh or cut back to the last checkpoint.
+static int open_log(tournament_t *t, int resume)
+{
+    log_header_t header;
+    if (resume) {
+        if (read_checkpoint(t) != 0) {
+            fprintf(stderr, "No usable checkpoint for %s\n", t->log_path);
+            return -1;
+        }
+        t->log = fopen(t->log_path, "r+b");
+        if (!t->log) {
+            perror(t->log_path);
+            return -1;
+        }
+        if (fread(&header, sizeof(header), 1, t->log) != 1 || memcmp(header.magic, LOG_MAGIC, 4) != 0 ||
+            header.record_size != sizeof(log_record_t)) {
+            fprintf(stderr, "%s is not a position log\n", t->log_path);
+            return -1;
+        }
+        /* Games finished after the checkpoint are played again */
+        long end = (long)(sizeof(header) + t->records * sizeof(log_record_t));
+        if (ftruncate(fileno(t->log), end) != 0 || fseek(t->log, end, SEEK_SET) != 0) {
+            perror(t->log_path);
+            return -1;
+        }
+        t->next_game = t->written;
+        printf("Resuming after game %d (%lld positions)\n", t->written, t->records);
+        return 0;
+    }
+
+    t->log = fopen(t->log_path, "wb");
+    if (!t->log) {
+        perror(t->log_path);
+        return -1;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LOG_MAGIC, 4);
+    header.version = LOG_VERSION;
+    header.record_size = sizeof(log_record_t);
+    if (fwrite(&header, sizeof(header), 1, t->log) != 1) {
+        perror(t->log_path);
+        return -1;
+    }
+    return 0;
+}
+
+static int run_tournament(tournament_t *t, int nthreads, int resume)
+{
+    if (open_log(t, resume) != 0) return -1;
+    if (t->written >= t->games) {
+        printf("All %d games already played\n", t->games);
+        fclose(t->log);
+        return 0;
+    }
+    t->pending = (game_log_t**)calloc((size_t)t->games, sizeof(game_log_t*));
+    if (!t->pending || ai_init(0) != 0) {
+        fclose(t->log);
+        return -1;
+    }
+    pthread_mutex_init(&t->lock, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t->start);
+    printf("A: %s\nB: %s\n%d games on %d threads, log %s\n",
+           t->engines[0].spec, t->engines[1].spec, t->games - t->written, nthreads, t->log_path);
+
+    pthread_t tids[AI_MAX_THREADS];
+    int started = 0;
+    for (int i = 0; i < nthreads; i++) {
+        if (pthread_create(&tids[started], NULL, player_main, t) == 0) started++;
+    }
+    if (started == 0) player_main(t);
+    for (int i = 0; i < started; i++) pthread_join(tids[i], NULL);
+
+    int ok = t->written == t->games;
+    for (int i = 0; i < t->games; i++) {
+        if (t->pending[i]) {
+            free(t->pending[i]->records);
+            free(t->pending[i]);
+        }
+    }
+    free(t->pending);
+    pthread_mutex_destroy(&t->lock);
+    ai_cleanup();
+    if (fclose(t->log) != 0) ok = 0;
+    if (ok) printf("%lld positions written to %s\n", t->records, t->log_path);
+    return ok ? 0 : -1;
+}
+
+/* Tuning sample: features from the side to move, outcome in [0, 1] for it */
+typedef struct {
+    int8_t f[AI_EVAL_TERMS];
+    float outcome;
+} sample_t;
+
+static double tuning_error(const sample_t *samples, size_t n, const ai_weights_t *w, double k)
+{
+    double total = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        int sum = 0;
+        for (int j = 0; j < AI_EVAL_TERMS; j++) sum += w->w[j] * samples[i].f[j];
+        double p = 1.0 / (1.0 + exp(-k * sum / AI_WEIGHT_SCALE));
+        double e = samples[i].outcome - p;
+        total += e * e;
+    }
+    return n ? total / n : 0.0;
+}
+
+static sample_t *load_samples(const char *path, size_t *count)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    log_header_t header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, LOG_MAGIC, 4) != 0 ||
+        header.version != LOG_VERSION || header.record_size != sizeof(log_record_t)) {
+        fprintf(stderr, "%s is not a position log\n", path);
+        fclose(f);
+        return NULL;
+    }
+
+    size_t capacity = 0, n = 0;
+    sample_t *samples = NULL;
+    log_record_t r;
+    while (fread(&r, sizeof(r), 1, f) == 1) {
+        if (n == capacity) {
+            capacity = capacity ? capacity * 2 : 65536;
+            sample_t *grown = (sample_t*)realloc(samples, capacity * sizeof(sample_t));
+            if (!grown) break;
+            samples = grown;
+        }
+        awale_game_t game;
+        memset(&game, 0, sizeof(game));
+        for (int h = 0; h < TOTAL_HOLES; h++) game.holes[h] = r.holes[h];
+        game.scores[0] = r.scores[0];
+        game.scores[1] = r.scores[1];
+        game.current_player = r.side;
+
+        int f_all[AI_EVAL_TERMS];
+        ai_eval_features(&game, f_all);
+        sample_t *s = &samples[n++];
+        for (int j = 0; j < AI_EVAL_TERMS; j++) s->f[j] = (int8_t)f_all[j];
+        int result = r.side == 0 ? r.result : -r.result;
+        s->outcome = (float)(result + 1) / 2.0f;
+    }
+    fclose(f);
+    *count = n;
+    return samples;
+}
+
+static int run_tuning(const char *log_path, const char *out_path)
+{
+    size_t n = 0;
+    sample_t *samples = load_samples(log_path, &n);
+    if (!samples) return -1;
+    if (n == 0) {
+        fprintf(stderr, "No positions in %s\n", log_path);
+        free(samples);
+        return -1;
+    }
+
+    ai_weights_t w;
+    if (ai_weights_load(out_path, &w) != 0) ai_weights_default(&w);
+
+    /* Scale of the logistic, fitted once to the starting weights */
+    double k = 0.0, best = 1e9;
+    for (double step = 0.1, lo = 0.0; step > 0.0005; step /= 10.0) {
+        for (double c = lo; c <= lo + 20 * step; c += step) {
+            double e = tuning_error(samples, n, &w, c);
+            if (e < best) {
+                best = e;
+                k = c;
+            }
+        }
+        lo = k > step ? k - step : 0.0;
+    }
+    printf("%zu positions, K = %.3f, error %.6f\n", n, k, best);
+
+    for (int pass = 1, improved = 1; improved; pass++) {
+        improved = 0;
+        for (int j = 0; j < AI_EVAL_TERMS; j++) {
+            for (int dir = 1; dir >= -1; dir -= 2) {
+                w.w[j] += dir;
+                double e = tuning_error(samples, n, &w, k);
+                if (e < best) {
+                    best = e;
+                    improved = 1;
+                    break;
+                }
+                w.w[j] -= dir;
+            }
+        }
+        printf("pass %d: error %.6f", pass, best);
+        for (int j = 0; j < AI_EVAL_TERMS; j++) printf("  %s %d", ai_eval_term_names[j], w.w[j]);
+        printf("\n");
+        fflush(stdout);
+    }
+    free(samples);
+
+    if (ai_weights_save(out_path, &w) != 0) {
+        perror(out_path);
+        return -1;
+    }
+    printf("Weights written to %s\n", out_path);
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-a spec] [-b spec] [-g games] [-t threads] [-r plies] [-s seed] [-l log] [-c every] [-R]\n", prog);
+    fprintf(stderr, "       %s -T log [-o file]\n", prog);
+    fprintf(stderr, "  -a, -b  engines: depth=N,ms=N,eval=classic|nn|<weights file> (default depth=8)\n");
+    fprintf(stderr, "  -g  games, played in color-swapped pairs (default %d)\n", DEFAULT_GAMES);
+    fprintf(stderr, "  -t  threads (default: all cores)\n");
+    fprintf(stderr, "  -r  random opening plies (default 4)\n");
+    fprintf(stderr, "  -s  opening seed (default 1)\n");
+    fprintf(stderr, "  -l  position log (default selfplay.log)\n");
+    fprintf(stderr, "  -c  checkpoint every N games (default %d)\n", DEFAULT_CHECKPOINT);
+    fprintf(stderr, "  -R  resume from the log's checkpoint\n");
+    fprintf(stderr, "  -T  tune the evaluation weights on a position log\n");
+    fprintf(stderr, "  -o  weights file, read as the starting point (default %s)\n", AI_WEIGHTS_FILE);
+}
+
+int main(int argc, char **argv)
+{
+    const char *spec_a = "depth=8", *spec_b = "depth=8";
+    const char *tune_log = NULL;
+    const char *out_path = AI_WEIGHTS_FILE;
+    int resume = 0;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = cores > 0 ? (int)cores : 1;
+
+    tournament_t t;
+    memset(&t, 0, sizeof(t));
+    t.games = DEFAULT_GAMES;
+    t.opening_plies = 4;
+    t.seed = 1;
+    t.checkpoint_every = DEFAULT_CHECKPOINT;
+    t.log_path = "selfplay.log";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            spec_a = argv[++i];
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            spec_b = argv[++i];
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            t.games = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            nthreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            t.opening_plies = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            t.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            t.log_path = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            t.checkpoint_every = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-R") == 0) {
+            resume = 1;
+        } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            tune_log = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (tune_log) return run_tuning(tune_log, out_path) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    if (t.games < 1 || nthreads < 1 || t.opening_plies < 0 || t.checkpoint_every < 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (nthreads > AI_MAX_THREADS) nthreads = AI_MAX_THREADS;
+    /* Salted hash keys keep the two evaluations apart in the shared table */
+    if (parse_engine(spec_a, &t.engines[0], 0x9e3779b97f4a7c15ULL) != 0 ||
+        parse_engine(spec_b, &t.engines[1], 0xc2b2ae3d27d4eb4fULL) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    int rc = run_tournament(&t, nthreads, resume);
+    nn_unload();
+    return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,56 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../game/tablebase.h"
+
+/* Offline endgame tablebase generator.
+ * Usage: awale_tbgen [-n max_seeds] [-t threads] [-o file] */
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-n max_seeds] [-t threads] [-o file]\n", prog);
+    fprintf(stderr, "  -n  solve positions with up to this many seeds on the board (default 12, max %d)\n", TB_MAX_SEEDS);
+    fprintf(stderr, "  -t  worker threads (default: all cores)\n");
+    fprintf(stderr, "  -o  output file (default %s)\n", TB_DEFAULT_FILE);
+}
+
+int main(int argc, char **argv)
+{
+    int max_seeds = 12;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cores > 0 ? (int)cores : 1;
+    const char *path = TB_DEFAULT_FILE;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            max_seeds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (max_seeds < 0 || max_seeds > TB_MAX_SEEDS || threads < 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("Generating tablebase up to %d seeds with %d threads\n", max_seeds, threads);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (tb_generate(path, max_seeds, threads) != 0) {
+        fprintf(stderr, "Tablebase generation failed\n");
+        return EXIT_FAILURE;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Wrote %s in %.1f s\n", path, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    return EXIT_SUCCESS;
+}